@@ -0,0 +1,236 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+// Counts the heap allocations made while parsing a generated HSPICE netlist,
+// with the lists of tokens Spirit builds for each line on the heap or in a
+// parse_arena (the way the dialect parsers do it), and checks that both give
+// the same tokens. The tokens of each line end up in a plain vector, like
+// those of a NetlistLine.
+//
+// Usage: allocation_benchmark [number of lines]
+
+
+#include "boost_adm_parser_common.h"
+#include "HSPICEGrammar.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// every allocation of the program goes through these
+static long long num_allocations = 0;
+
+void * operator new(std::size_t size) {
+    num_allocations++;
+    void * p = std::malloc(size > 0 ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void * operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+// The sized and array forms as well, so that every delete matches the new above. free() is
+// kept out of line: once GCC inlines it into a caller of the replaced new, it reports the pair
+// as mismatched (-Wmismatched-new-delete).
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void release(void * p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void * p) noexcept {
+    release(p);
+}
+
+void operator delete[](void * p) noexcept {
+    release(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept {
+    release(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept {
+    release(p);
+}
+
+
+// Builds a netlist of the common devices, with a parameter line and a source.
+std::vector<std::string> generate_netlist(int num_lines) {
+    std::vector<std::string> lines;
+    lines.reserve(num_lines);
+
+    for(int i = 0; i < num_lines; i++) {
+        std::ostringstream line;
+        switch(i % 6) {
+            case 0:
+                line << "R" << i << " n" << i << " n" << i+1 << " 1.5k";
+                break;
+            case 1:
+                line << "C" << i << " n" << i << " 0 2.3f";
+                break;
+            case 2:
+                line << "M" << i << " d" << i << " g" << i << " s" << i << " b" << i << " nch w=0.2u l=0.05u";
+                break;
+            case 3:
+                line << "Xinv" << i << " in" << i << " out" << i << " vdd vss inv_x1";
+                break;
+            case 4:
+                line << ".param p" << i << "=1 q" << i << "='p" << i << "*2+sqrt(3)'";
+                break;
+            case 5:
+                line << "V" << i << " in" << i << " 0 PULSE(0 1 0 1n 1n 5n 10n)";
+                break;
+        }
+        lines.push_back(line.str());
+    }
+
+    return lines;
+}
+
+
+typedef std::vector<std::vector<netlist_statement_object> > parse_results;
+
+
+// Parses a line into tokens, which are left empty if it does not parse completely.
+void parse_line(const std::string & line, hspice_parser<iterator_type> const& g, std::vector<netlist_statement_object> & tokens) {
+    std::string::const_iterator start = line.begin();
+    std::string::const_iterator end = line.end();
+    netlist_statement_list netlist_parse_results;
+
+    bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
+
+    if(r && start == end) {
+        take_statements(netlist_parse_results, tokens);
+    }
+}
+
+
+// Parses every line, with the lists of tokens on the heap or in this thread's arena.
+parse_results parse_lines(const std::vector<std::string> & lines, hspice_parser<iterator_type> const& g, bool use_arena) {
+    parse_results results(lines.size());
+
+    for(size_t i = 0; i < lines.size(); i++) {
+        if(use_arena) {
+            parse_arena::scope arena_scope;
+            parse_line(lines[i], g, results[i]);
+        } else {
+            parse_line(lines[i], g, results[i]);
+        }
+    }
+
+    return results;
+}
+
+
+bool same_results(const parse_results & a, const parse_results & b) {
+    if(a.size() != b.size())
+        return false;
+
+    for(size_t i = 0; i < a.size(); i++) {
+        if(a[i].size() != b[i].size())
+            return false;
+
+        for(size_t j = 0; j < a[i].size(); j++) {
+            if(a[i][j].value != b[i][j].value || a[i][j].candidate_types != b[i][j].candidate_types)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+int num_parsed(const parse_results & results) {
+    int parsed = 0;
+    for(size_t i = 0; i < results.size(); i++) {
+        if(!results[i].empty())
+            parsed++;
+    }
+    return parsed;
+}
+
+
+// Token values too long for the small string buffer of std::string, which each
+// take an allocation of their own
+long long num_long_values(const parse_results & results) {
+    long long num_long = 0;
+    for(size_t i = 0; i < results.size(); i++) {
+        for(size_t j = 0; j < results[i].size(); j++) {
+            if(results[i][j].value.size() > std::string().capacity())
+                num_long++;
+        }
+    }
+    return num_long;
+}
+
+
+int main(int argc, char ** argv) {
+    int num_lines = 20000;
+    if(argc > 1) {
+        num_lines = std::atoi(argv[1]);
+    }
+
+    std::vector<std::string> lines = generate_netlist(num_lines);
+    hspice_parser<iterator_type> g;
+
+    // the first parse sizes the arena, as the first lines of a file would
+    parse_lines(lines, g, true);
+
+    long long a0 = num_allocations;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    parse_results heap_results = parse_lines(lines, g, false);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    long long a1 = num_allocations;
+    parse_results arena_results = parse_lines(lines, g, true);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    long long a2 = num_allocations;
+
+    // what is left once the results themselves are accounted for: the vector of lines,
+    // the tokens vector of each parsed line, and the long values
+    long long arena_rest = (a2 - a1) - 1 - num_parsed(arena_results) - num_long_values(arena_results);
+
+    double heap_sec = std::chrono::duration<double>(t1 - t0).count();
+    double arena_sec = std::chrono::duration<double>(t2 - t1).count();
+
+    std::cout << "Lines:                      " << num_lines << " (" << num_parsed(arena_results) << " parsed)" << std::endl;
+    std::cout << "Token lists on the heap:    " << heap_sec << " s, "
+              << static_cast<double>(a1 - a0) / num_lines << " allocations/line" << std::endl;
+    std::cout << "Token lists in the arena:   " << arena_sec << " s, "
+              << static_cast<double>(a2 - a1) / num_lines << " allocations/line" << std::endl;
+    std::cout << "  kept in the results:      " << static_cast<double>(a2 - a1 - arena_rest) / num_lines
+              << " allocations/line" << std::endl;
+    std::cout << "  spent on parsing:         " << static_cast<double>(arena_rest) / num_lines
+              << " allocations/line" << std::endl;
+    std::cout << "Same results:               " << (same_results(heap_results, arena_results) ? "yes" : "no") << std::endl;
+
+    return same_results(heap_results, arena_results) ? 0 : 1;
+}
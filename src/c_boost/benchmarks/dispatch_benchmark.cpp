@@ -0,0 +1,173 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+// Compares parsing a generated HSPICE netlist with the device and directive
+// rules dispatched on the start of each line against trying them all in
+// order, and checks that both give the same results.
+//
+// Usage: dispatch_benchmark [number of lines]
+
+
+#include "boost_adm_parser_common.h"
+#include "HSPICEGrammar.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// Builds a netlist mixing the common devices with a few directives.
+std::vector<std::string> generate_netlist(int num_lines) {
+    std::vector<std::string> lines;
+    lines.reserve(num_lines);
+
+    for(int i = 0; i < num_lines; i++) {
+        std::ostringstream line;
+        switch(i % 10) {
+            case 0:
+                line << "R" << i << " n" << i << " n" << i+1 << " 1.5k";
+                break;
+            case 1:
+                line << "C" << i << " n" << i << " 0 2.3f";
+                break;
+            case 2:
+            case 3:
+                line << "M" << i << " d" << i << " g" << i << " s" << i << " b" << i << " nch w=0.2u l=0.05u";
+                break;
+            case 4:
+                line << "Xinv" << i << " in" << i << " out" << i << " vdd vss inv_x1";
+                break;
+            case 5:
+                line << "V" << i << " n" << i << " 0 DC 1.2";
+                break;
+            case 6:
+                line << "D" << i << " a" << i << " k" << i << " dmod";
+                break;
+            case 7:
+                line << "Q" << i << " c" << i << " b" << i << " e" << i << " npn";
+                break;
+            case 8:
+                line << ".param p" << i << "=" << i;
+                break;
+            case 9:
+                line << ".tran 1n " << i << "n";
+                break;
+        }
+        lines.push_back(line.str());
+    }
+
+    return lines;
+}
+
+
+typedef std::vector<netlist_statement_list> parse_results;
+
+
+// Parses every line, returning the objects parsed from each (empty if the
+// line did not parse completely).
+parse_results parse_lines(const std::vector<std::string> & lines, hspice_parser<iterator_type> const& g) {
+    parse_results results(lines.size());
+
+    for(size_t i = 0; i < lines.size(); i++) {
+        std::string::const_iterator start = lines[i].begin();
+        std::string::const_iterator end = lines[i].end();
+        netlist_statement_list netlist_parse_results;
+
+        bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
+
+        if(r && start == end) {
+            results[i].swap(netlist_parse_results);
+        }
+    }
+
+    return results;
+}
+
+
+int num_parsed(const parse_results & results) {
+    int parsed = 0;
+    for(size_t i = 0; i < results.size(); i++) {
+        if(!results[i].empty())
+            parsed++;
+    }
+    return parsed;
+}
+
+
+bool same_results(const parse_results & a, const parse_results & b) {
+    if(a.size() != b.size())
+        return false;
+
+    for(size_t i = 0; i < a.size(); i++) {
+        if(a[i].size() != b[i].size())
+            return false;
+
+        for(size_t j = 0; j < a[i].size(); j++) {
+            if(a[i][j].value != b[i][j].value || a[i][j].candidate_types != b[i][j].candidate_types)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+int main(int argc, char ** argv) {
+    int num_lines = 20000;
+    if(argc > 1) {
+        num_lines = std::atoi(argv[1]);
+    }
+
+    std::vector<std::string> lines = generate_netlist(num_lines);
+    hspice_parser<iterator_type> g;
+
+    g.set_statement_dispatch(false);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    parse_results in_order = parse_lines(lines, g);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    std::size_t in_order_attempted = g.alternatives_attempted();
+
+    g.set_statement_dispatch(true);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    parse_results dispatched = parse_lines(lines, g);
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+    std::size_t dispatched_attempted = g.alternatives_attempted() - in_order_attempted;
+
+    double in_order_sec = std::chrono::duration<double>(t1 - t0).count();
+    double dispatched_sec = std::chrono::duration<double>(t3 - t2).count();
+    bool same = same_results(in_order, dispatched);
+
+    std::cout << "Lines:                      " << num_lines << std::endl;
+    std::cout << "Rules tried in order:       " << in_order_sec << " s ("
+              << 1e6*in_order_sec/num_lines << " us/line, "
+              << double(in_order_attempted)/num_lines << " rules/line, " << num_parsed(in_order) << " parsed)" << std::endl;
+    std::cout << "Rules dispatched:           " << dispatched_sec << " s ("
+              << 1e6*dispatched_sec/num_lines << " us/line, "
+              << double(dispatched_attempted)/num_lines << " rules/line, " << num_parsed(dispatched) << " parsed)" << std::endl;
+    std::cout << "Speedup:                    " << in_order_sec/dispatched_sec << "x" << std::endl;
+    std::cout << "Same results:               " << (same ? "yes" : "no") << std::endl;
+
+    return same ? 0 : 1;
+}
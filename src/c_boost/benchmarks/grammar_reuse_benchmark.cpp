@@ -0,0 +1,123 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+// Compares parsing a generated HSPICE netlist with a grammar constructed for
+// every line (the old behavior of HSPICENetlistBoostParser::next()) against
+// a single grammar reused for the whole file.
+//
+// Usage: grammar_reuse_benchmark [number of lines]
+
+
+#include "boost_adm_parser_common.h"
+#include "HSPICEGrammar.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// Builds a flat post-layout style netlist of short device lines.
+std::vector<std::string> generate_netlist(int num_lines) {
+    std::vector<std::string> lines;
+    lines.reserve(num_lines);
+
+    for(int i = 0; i < num_lines; i++) {
+        std::ostringstream line;
+        switch(i % 4) {
+            case 0:
+                line << "R" << i << " n" << i << " n" << i+1 << " 1.5k";
+                break;
+            case 1:
+                line << "C" << i << " n" << i << " 0 2.3f";
+                break;
+            case 2:
+                line << "M" << i << " d" << i << " g" << i << " s" << i << " b" << i << " nch w=0.2u l=0.05u";
+                break;
+            case 3:
+                line << "Xinv" << i << " in" << i << " out" << i << " vdd vss inv_x1";
+                break;
+        }
+        lines.push_back(line.str());
+    }
+
+    return lines;
+}
+
+
+// Parses every line, either with one grammar or with one grammar per line.
+// Returns the number of lines that parsed completely.
+int parse_lines(const std::vector<std::string> & lines, bool reuse_grammar) {
+    typedef hspice_parser<iterator_type> hspice_parser;
+    hspice_parser shared_grammar;
+    int num_parsed = 0;
+
+    for(size_t i = 0; i < lines.size(); i++) {
+        std::string::const_iterator start = lines[i].begin();
+        std::string::const_iterator end = lines[i].end();
+        netlist_statement_list netlist_parse_results;
+        bool r;
+
+        if(reuse_grammar) {
+            r = phrase_parse(start, end, shared_grammar, boost::spirit::ascii::space, netlist_parse_results);
+        } else {
+            hspice_parser g;
+            r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
+        }
+
+        if(r && start == end) {
+            num_parsed++;
+        }
+    }
+
+    return num_parsed;
+}
+
+
+int main(int argc, char ** argv) {
+    int num_lines = 20000;
+    if(argc > 1) {
+        num_lines = std::atoi(argv[1]);
+    }
+
+    std::vector<std::string> lines = generate_netlist(num_lines);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    int per_line_parsed = parse_lines(lines, false);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    int reused_parsed = parse_lines(lines, true);
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    double per_line_sec = std::chrono::duration<double>(t1 - t0).count();
+    double reused_sec = std::chrono::duration<double>(t2 - t1).count();
+
+    std::cout << "Lines:                      " << num_lines << std::endl;
+    std::cout << "Grammar per line:           " << per_line_sec << " s ("
+              << 1e6*per_line_sec/num_lines << " us/line, " << per_line_parsed << " parsed)" << std::endl;
+    std::cout << "Grammar reused:             " << reused_sec << " s ("
+              << 1e6*reused_sec/num_lines << " us/line, " << reused_parsed << " parsed)" << std::endl;
+    std::cout << "Speedup:                    " << per_line_sec/reused_sec << "x" << std::endl;
+
+    return per_line_parsed == reused_parsed ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+// Compares evaluating the parameters of a model card for many Monte Carlo samples one
+// sample at a time, with the scalar evaluator and the statistical parameters set before
+// each sample, against evaluating blocks of samples with the sample evaluator. Both take
+// their random numbers from the same streams, and the results have to be the same.
+//
+// Usage: monte_carlo_benchmark [number of samples]
+
+
+#include "hspice_arithmetic_grammar.hpp"
+#include "monte_carlo.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+typedef std::string::const_iterator iterator_type;
+typedef HSPICEArithmeticGrammar<iterator_type> grammar;
+
+static const unsigned long long seed = 1;
+
+
+// The statistical parameters, and the normal (or uniform) deviation of each.
+struct random_parameter {
+    const char * name;
+    const char * statement;
+    bool gaussian;
+    double nominal;
+    double variation;
+};
+
+static const random_parameter random_parameters[] = {
+    { "dvth", "dvth=agauss(0,0.03,3)", true, 0, 0.01 },
+    { "du0", "du0=agauss(0,0.06,3)", true, 0, 0.02 },
+    { "dl", "dl=aunif(0,5n)", false, 0, 5e-9 },
+};
+
+static const char * statements[] = {
+    "vth0=0.42+dvth",
+    "u0=0.035*(1+du0)",
+    "l=90n+dl",
+    "w=1u",
+    "leff=l-2*8n",
+    "weff=w-2*10n",
+    "tox=2n*(1+0.2*du0)",
+    "cox=3.9*8.854e-12/tox",
+    "beta=u0*cox*weff/leff",
+    "vov=1.2-vth0",
+    "id=0.5*beta*vov**2",
+    "gm=sqrt(2*beta*id)",
+    "ro=1/(0.1*id)",
+    "gain=gm*ro",
+    "ft=gm/(2*pi*weff*leff*cox)",
+    "ioff=1e-7*exp(-vth0/(1.5*0.0259))",
+    "rs=max(100,200*(1+dvth))",
+    "sat=vov>0.8?id:0.9*id",
+    "wide=weff/leff>10?1:0",
+    "gdb=20*log10(abs(gain))",
+};
+
+
+// What agauss() or aunif() draws for sample s, the way the sample evaluator does.
+double draw(const random_parameter & p, size_t s) {
+    ast_common::random_stream numbers = ast_common::random_stream(seed, p.statement).draw(0);
+    double u1 = numbers.uniform(2*s);
+    double u2 = numbers.uniform(2*s + 1);
+
+    double deviation = p.gaussian ? sqrt(-2*log(u1)) * cos(2*M_PI*u2) : 2*u1 - 1;
+    return p.nominal + p.variation*deviation;
+}
+
+
+int main(int argc, char ** argv) {
+    int num_samples = 100000;
+    if(argc > 1) {
+        num_samples = std::atoi(argv[1]);
+    }
+
+    const size_t num_random = sizeof(random_parameters)/sizeof(random_parameters[0]);
+    const size_t num_statements = sizeof(statements)/sizeof(statements[0]);
+
+    ast_common::symbol_table variables;
+    ast_common::function_table functions;
+    std::unordered_map<std::string, std::map<int, std::string> > function_variable_map;
+    std::unordered_map<std::string, std::string> function_map;
+    grammar g;
+    ast_common::compiler<grammar> compile(variables, functions, function_variable_map, function_map, g);
+
+    std::vector<int> random_slots;
+    std::vector<ast_common::compiled_expr> random_compiled;
+    std::vector<ast_common::random_stream> random_streams;
+    for(size_t j = 0; j < num_random; j++) {
+        random_slots.push_back(variables.slot(random_parameters[j].name));
+        random_compiled.push_back(compile.compile(random_parameters[j].statement));
+        random_streams.push_back(ast_common::random_stream(seed, random_parameters[j].statement));
+    }
+
+    std::vector<ast_common::compiled_expr> compiled;
+    std::vector<ast_common::random_stream> streams;
+    for(size_t k = 0; k < num_statements; k++) {
+        compiled.push_back(compile.compile(statements[k]));
+        streams.push_back(ast_common::random_stream(seed, statements[k]));
+    }
+
+    std::vector<double> one_by_one(num_statements * num_samples);
+    std::vector<double> in_blocks(num_statements * num_samples);
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    ast_common::evaluator eval(variables, functions);
+    for(int s = 0; s < num_samples; s++) {
+        for(size_t j = 0; j < num_random; j++) {
+            variables.values[random_slots[j]] = draw(random_parameters[j], s);
+        }
+        for(size_t k = 0; k < num_statements; k++) {
+            one_by_one[k * num_samples + s] = eval(compiled[k]);
+        }
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    // forget what the scalar evaluator stored, so the block evaluator works it all out
+    for(size_t i = 0; i < variables.size(); i++) {
+        variables.values[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    const int block = 512;
+    ast_common::sample_evaluator sample_eval(variables, functions);
+    std::vector<double> discarded(block);
+    for(int first = 0; first < num_samples; first += block) {
+        int n = std::min(block, num_samples - first);
+        sample_eval.start(first, n);
+        for(size_t j = 0; j < num_random; j++) {
+            sample_eval(random_compiled[j], random_streams[j], discarded.data());
+        }
+        for(size_t k = 0; k < num_statements; k++) {
+            sample_eval(compiled[k], streams[k], in_blocks.data() + k * num_samples + first);
+        }
+    }
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+
+    bool same_results = one_by_one == in_blocks;
+
+    double one_by_one_sec = std::chrono::duration<double>(t1 - t0).count();
+    double in_blocks_sec = std::chrono::duration<double>(t3 - t2).count();
+    double num_values = double(num_samples) * num_statements;
+
+    std::cout << "Samples:                    " << num_samples << std::endl;
+    std::cout << "Statements:                 " << num_statements << " (" << num_random << " random parameters)" << std::endl;
+    std::cout << "One sample at a time:       " << one_by_one_sec << " s (" << 1e9*one_by_one_sec/num_values << " ns/value)" << std::endl;
+    std::cout << "Blocks of " << block << " samples:     " << in_blocks_sec << " s (" << 1e9*in_blocks_sec/num_values << " ns/value)" << std::endl;
+    std::cout << "Speedup:                    " << one_by_one_sec/in_blocks_sec << "x" << std::endl;
+    std::cout << "Same results:               " << (same_results ? "yes" : "no") << std::endl;
+
+    return same_results ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+// Compares the SPICE numeric lexer with the code it replaced: converting
+// literals by rewriting the scale factor and reading them back through an
+// istringstream, and recognizing them with the six backtracking alternatives
+// of the old netlist grammar rule. Checks that both give the same results.
+//
+// Usage: number_benchmark [number of literals]
+
+
+#include "spice_number.hpp"
+#include <boost/spirit/include/qi.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace qi = boost::spirit::qi;
+namespace ascii = boost::spirit::ascii;
+
+typedef std::string::const_iterator iterator_type;
+
+
+// Literals of the kinds found in model cards, with the single-letter scale
+// factors both conversions understand.
+std::vector<std::string> generate_literals(int num_literals) {
+    static const char * scales[] = { "", "k", "m", "u", "n", "p", "f", "a", "x", "g", "K", "U" };
+    std::vector<std::string> literals;
+    literals.reserve(num_literals);
+
+    for(int i = 0; i < num_literals; i++) {
+        std::ostringstream literal;
+        switch(i % 5) {
+            case 0:
+                literal << i % 1000;
+                break;
+            case 1:
+                literal << i % 97 << "." << i % 1013;
+                break;
+            case 2:
+                literal << "." << i % 311;
+                break;
+            case 3:
+                literal << i % 53 << "." << i % 7 << "e" << (i % 2 ? "-" : "+") << i % 19;
+                break;
+            case 4:
+                literal << i % 211 << "." << i % 89 << "e" << i % 11;
+                break;
+        }
+        if(i % 5 < 3) {
+            literal << scales[i % 12];
+        }
+        literals.push_back(literal.str());
+    }
+
+    return literals;
+}
+
+
+// The conversion the expression evaluator used before the lexer.
+double stream_value(std::string value) {
+    switch(value.back()) {
+        case 'u': case 'U': value.pop_back(); value += "e-6"; break;
+        case 'n': case 'N': value.pop_back(); value += "e-9"; break;
+        case 'p': case 'P': value.pop_back(); value += "e-12"; break;
+        case 'f': case 'F': value.pop_back(); value += "e-15"; break;
+        case 'a': case 'A': value.pop_back(); value += "e-18"; break;
+        case 'm': case 'M': value.pop_back(); value += "e-3"; break;
+        case 'k': case 'K': value.pop_back(); value += "e3"; break;
+        case 'x': case 'X': value.pop_back(); value += "e6"; break;
+        case 'g': case 'G': value.pop_back(); value += "e9"; break;
+    }
+
+    std::istringstream in_value(value);
+    double v;
+    in_value >> v;
+
+    return v;
+}
+
+
+// The number rule of the netlist grammar before the lexer.
+struct alternatives_grammar : qi::grammar<iterator_type, std::string(), ascii::space_type> {
+    qi::rule<iterator_type, std::string(), ascii::space_type> number, numeric;
+
+    alternatives_grammar() : alternatives_grammar::base_type(number) {
+        using qi::char_;
+        using qi::hold;
+        using qi::lit;
+        using ascii::no_case;
+
+        numeric =
+            +char_("0-9")
+            ;
+
+        number =
+            hold[-lit("-") >> numeric >> -(char_(".") >> -numeric) >> no_case[char_("e") >> -(char_("-") | char_("+")) >> numeric]] |
+            hold[-lit("-") >> numeric >> -(char_(".") >> -numeric) >> no_case[char_("afpnumkxg")]] |
+            hold[-lit("-") >> numeric >> -(char_(".") >> -numeric)] |
+            hold[-lit("-") >> char_(".") >> numeric >> no_case[char_("e") >> -(char_("-") | char_("+")) >> numeric]] |
+            hold[-lit("-") >> char_(".") >> numeric >> no_case[char_("afpnumkxg")]] |
+            hold[-lit("-") >> char_(".") >> numeric]
+            ;
+    }
+};
+
+
+struct lexer_grammar : qi::grammar<iterator_type, std::string(), ascii::space_type> {
+    qi::rule<iterator_type, std::string(), ascii::space_type> number;
+
+    lexer_grammar() : lexer_grammar::base_type(number) {
+        number =
+            spice_number::parser(spice_number::SINGLE_LETTER, true)
+            ;
+    }
+};
+
+
+template <typename Grammar>
+std::vector<std::string> recognize(const std::vector<std::string> & literals, const Grammar & g) {
+    std::vector<std::string> results(literals.size());
+
+    for(size_t i = 0; i < literals.size(); i++) {
+        iterator_type start = literals[i].begin();
+        iterator_type end = literals[i].end();
+
+        if(!qi::phrase_parse(start, end, g, ascii::space, results[i]) || start != end) {
+            results[i] = "<no match>";
+        }
+    }
+
+    return results;
+}
+
+
+int main(int argc, char ** argv) {
+    int num_literals = 200000;
+    if(argc > 1) {
+        num_literals = std::atoi(argv[1]);
+    }
+
+    std::vector<std::string> literals = generate_literals(num_literals);
+    std::vector<double> streamed(literals.size());
+    std::vector<double> lexed(literals.size());
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < literals.size(); i++) {
+        streamed[i] = stream_value(literals[i]);
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < literals.size(); i++) {
+        lexed[i] = spice_number::to_double(literals[i]);
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    alternatives_grammar alternatives;
+    lexer_grammar lexer;
+
+    std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
+    std::vector<std::string> by_alternatives = recognize(literals, alternatives);
+    std::chrono::steady_clock::time_point t4 = std::chrono::steady_clock::now();
+    std::vector<std::string> by_lexer = recognize(literals, lexer);
+    std::chrono::steady_clock::time_point t5 = std::chrono::steady_clock::now();
+
+    bool same_values = streamed == lexed;
+    bool same_matches = by_alternatives == by_lexer;
+
+    double stream_sec = std::chrono::duration<double>(t1 - t0).count();
+    double lexer_sec = std::chrono::duration<double>(t2 - t1).count();
+    double alternatives_sec = std::chrono::duration<double>(t4 - t3).count();
+    double lexer_rule_sec = std::chrono::duration<double>(t5 - t4).count();
+
+    std::cout << "Literals:                   " << num_literals << std::endl;
+    std::cout << "istringstream conversion:   " << stream_sec << " s (" << 1e9*stream_sec/num_literals << " ns/literal)" << std::endl;
+    std::cout << "Lexer conversion:           " << lexer_sec << " s (" << 1e9*lexer_sec/num_literals << " ns/literal)" << std::endl;
+    std::cout << "Speedup:                    " << stream_sec/lexer_sec << "x" << std::endl;
+    std::cout << "Same values:                " << (same_values ? "yes" : "no") << std::endl;
+    std::cout << "Alternatives rule:          " << alternatives_sec << " s (" << 1e9*alternatives_sec/num_literals << " ns/literal)" << std::endl;
+    std::cout << "Lexer rule:                 " << lexer_rule_sec << " s (" << 1e9*lexer_rule_sec/num_literals << " ns/literal)" << std::endl;
+    std::cout << "Speedup:                    " << alternatives_sec/lexer_rule_sec << "x" << std::endl;
+    std::cout << "Same matches:               " << (same_matches ? "yes" : "no") << std::endl;
+
+    return same_values && same_matches ? 0 : 1;
+}
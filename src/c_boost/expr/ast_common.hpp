@@ -145,130 +145,115 @@ namespace ast_common
         std::string constant_number;
     };
 
-    template <typename Grammar>
-    struct evaluator;
-
-    template <typename Grammar>
+    // Walks a parsed expression and appends its tokens to a token_stream: operands before
+    // the operation on them, and calls and ternaries as the text of their parts. Nothing
+    // is allocated per token, so the same stream can be cleared and reused.
     struct printer
     {
-        printer(std::unordered_map<std::string, double> & variable_map, std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map, std::unordered_map<std::string, std::string> & function_map, const Grammar & g, std::vector<expr_boost_common::expr_object> & expr_parse_results)
-            : variable_map(variable_map), function_variable_map(function_variable_map), function_map(function_map), g(g), expr_parse_results(expr_parse_results) { }
+        printer(expr_boost_common::token_stream & tokens)
+            : tokens(tokens) { }
 
         typedef void result_type;
-        std::unordered_map<std::string, double> & variable_map;
-        std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map;
-        std::unordered_map<std::string, std::string> & function_map;
-        const Grammar & g;
-        std::vector<expr_boost_common::expr_object> & expr_parse_results;
+        expr_boost_common::token_stream & tokens;
 
         void operator()(nil) {}
 
         void operator()(variable const& x) 
         {
-            expr_boost_common::expr_object obj;
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::PARAM_NAME);
-            obj.value = x.var_name;
-            expr_parse_results.push_back(obj);
+            tokens.append(expr_boost_common::PARAM_NAME, x.var_name);
         }
 
         void operator()(number const& x) 
         {
-            expr_boost_common::expr_object obj;
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::NUMBER);
-            obj.value = x.constant_number;
-            expr_parse_results.push_back(obj);
+            tokens.append(expr_boost_common::NUMBER, x.constant_number);
         }
 
         void operator()(operation const& x) 
         {
             boost::apply_visitor(*this, x.operand_);
 
-            expr_boost_common::expr_object obj;
-            obj.value = x.op;
-
+            int type = -1;
             if(x.op == "+")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::ADD);
+                type = expr_boost_common::ADD;
             }
             else if(x.op == "-")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::SUBTRACT);
+                type = expr_boost_common::SUBTRACT;
             }
             else if(x.op == "*")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::MULTIPLY);
+                type = expr_boost_common::MULTIPLY;
             }
             else if(x.op == "/")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::DIVIDE);
+                type = expr_boost_common::DIVIDE;
             }
             else if(x.op == "**" || x.op == "^")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::POWER);
+                type = expr_boost_common::POWER;
             }
 
-            expr_parse_results.push_back(obj);
+            tokens.append(type, x.op);
         }
 
         void operator()(boolOperation const& x) 
         {
             boost::apply_visitor(*this, x.operand_);
 
-            expr_boost_common::expr_object obj;
-            obj.value = x.op;
+            int type = -1;
             if(x.op == "||")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::LOGICAL_OR);
+                type = expr_boost_common::LOGICAL_OR;
             }
             else if(x.op == "&&")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::LOGICAL_AND);
+                type = expr_boost_common::LOGICAL_AND;
             }
             else if(x.op == "!=")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::INEQUALITY);
+                type = expr_boost_common::INEQUALITY;
             }
             else if(x.op == "==")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::EQUALITY);
+                type = expr_boost_common::EQUALITY;
             }
             else if(x.op == ">=")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::GREATER_THAN_OR_EQUAL);
+                type = expr_boost_common::GREATER_THAN_OR_EQUAL;
             }
             else if(x.op == "<=")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::LESS_THAN_OR_EQUAL);
+                type = expr_boost_common::LESS_THAN_OR_EQUAL;
             }
             else if(x.op == ">")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::GREATER_THAN);
+                type = expr_boost_common::GREATER_THAN;
             }
             else if(x.op == "<")
             {
-                obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::LESS_THAN);
+                type = expr_boost_common::LESS_THAN;
             }
 
-            expr_parse_results.push_back(obj);
+            tokens.append(type, x.op);
         }
 
         void operator()(unary const& x) 
         {
             boost::apply_visitor(*this, x.operand_);
 
-            expr_boost_common::expr_object obj;
-            obj.value = x.sign;
+            int type = -1;
             switch (x.sign)
             {
                 case '-':
-                    obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::UNARY_NEG);
+                    type = expr_boost_common::UNARY_NEG;
                     break;
                 case '+':
-                    obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::UNARY_POS);
+                    type = expr_boost_common::UNARY_POS;
                     break;
             }
 
-            expr_parse_results.push_back(obj);
+            tokens.append(type, &x.sign, 1);
         }
 
         void operator()(expr const& x) 
@@ -300,678 +285,103 @@ namespace ast_common
 
         void operator()(funcEval const& x) 
         {
-            std::string identifier = x.func_name;
-            std::vector<std::string> args;
-            std::string curr_func_name;
-            std::string arguments;
-            std::string curr_arg;
-            int arg_num = 0;
-            size_t open_parenthesis_count = 0;
-            size_t close_parenthesis_count = 0;
-            bool embedded_func = false;
-
-            // isolate the function name from it's arguments
-            boost::trim_if(identifier, boost::is_any_of("\r\n\t "));
-            size_t equals_idx = identifier.find_first_of("(");
-            curr_func_name = identifier.substr(0, equals_idx);
-            arguments = identifier.substr(equals_idx+1);
-            arguments = arguments.substr(0, arguments.length()-1);
-
-            expr_boost_common::expr_object obj;
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::FUNC_NAME);
-            obj.value = curr_func_name;
-            expr_parse_results.push_back(obj);
-            obj.candidate_types.pop_back();
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::FUNC_BEGIN);
-            obj.value = "(";
-            expr_parse_results.push_back(obj);
-
-            boost::split(args, arguments, boost::is_any_of(","), boost::token_compress_on);
-            for(int i = 0; i < args.size(); i++)
-            {
-                // check if argument is actually a function with multiple inputs (which would 
-                // of been split because the delimiter is ","), re-construct the function 
-                // string if it is
-                expr_boost_common::expr_object arg_obj;
-
-                if(curr_arg.empty())
-                {
-                    curr_arg = args[i];
-                    embedded_func = false;
-                }
-                else
-                {
-                    curr_arg += ",";
-                    curr_arg += args[i];
-                }
-
-                open_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), '(');
-                if(open_parenthesis_count > 0)
-                {
-                    embedded_func = true;
-                    close_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), ')');
-                    if(open_parenthesis_count != close_parenthesis_count)
-                    {
-                        continue;
-                    }
-                }
-                else
-                {
-                    curr_arg = args[i];
-                }
-
-                arg_obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::FUNC_ARG);
-                arg_obj.value = curr_arg;
-                expr_parse_results.push_back(arg_obj);
-
-                curr_arg = "";
-                arg_num++;
-            }
-
-            obj.candidate_types.pop_back();
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::FUNC_END);
-            obj.value = ")";
-            expr_parse_results.push_back(obj);
-
+            call(x.func_name);
         }
 
         void operator()(builtIn const& x) 
         {
-            funcEval y;
-            y.func_name = x.func_name;
-
-            printer<Grammar> print(variable_map, function_variable_map, function_map, g, expr_parse_results);
-            print(y);
-        }
-
-        void operator()(ternary const& x) 
-        {
-            expr_boost_common::expr_object obj;
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::TERNARY_CONDITION);
-            obj.value = x.conditional;
-            expr_parse_results.push_back(obj);
-
-            obj.candidate_types.pop_back();
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::TERNARY_LEFT);
-            obj.value = x.left;
-            expr_parse_results.push_back(obj);
-
-            obj.candidate_types.pop_back();
-            obj.candidate_types.push_back(expr_boost_common::expr_data_model_type::TERNARY_RIGHT);
-            obj.value = x.right;
-            expr_parse_results.push_back(obj);
-        }
-
-        void operator()(root const& x) 
-        {
-            boost::apply_visitor(*this, x.first);
-        }
-    };
-
-    template <typename Grammar>
-    struct evaluator
-    {
-        evaluator(std::unordered_map<std::string, double> & variable_map, std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map, std::unordered_map<std::string, std::string> & function_map, const Grammar & g)
-            : variable_map(variable_map), function_variable_map(function_variable_map), function_map(function_map), g(g) { }
-
-        typedef double result_type;
-        std::unordered_map<std::string, double> & variable_map;
-        std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map;
-        std::unordered_map<std::string, std::string> & function_map;
-        const Grammar & g;
-
-        double operator()(nil) { BOOST_ASSERT(0); return 0; }
-
-        double operator()(variable const& x) 
-        {
-            if(variable_map.find(x.var_name) == variable_map.end())
-            {
-                return std::numeric_limits<double>::quiet_NaN();
-            }
-            else
-            {
-                return variable_map[x.var_name];
-            }
-        }
-
-        double operator()(number const& x) 
-        { 
-            std::string value = x.constant_number;
-
-            switch(value.back())
-            {
-                case 'u': case 'U':
-                    value.pop_back();
-                    value += "e-6";
-                    break;
-                case 'n': case 'N':
-                    value.pop_back();
-                    value += "e-9";
-                    break;
-                case 'p': case 'P':
-                    value.pop_back();
-                    value += "e-12";
-                    break;
-                case 'f': case 'F':
-                    value.pop_back();
-                    value += "e-15";
-                    break;
-                case 'a': case 'A':
-                    value.pop_back();
-                    value += "e-18";
-                    break;
-                case 'm': case 'M':
-                    value.pop_back();
-                    value += "e-3";
-                    break;
-                case 'k': case 'K':
-                    value.pop_back();
-                    value += "e3";
-                    break;
-                case 'x': case 'X':
-                    value.pop_back();
-                    value += "e6";
-                    break;
-                case 'g': case 'G':
-                    value.pop_back();
-                    value += "e9";
-                    break;
-            }
-
-            std::istringstream in_value(value);
-            double v;
-            in_value >> v;
-
-            return v; 
-        }
-
-        double operator()(operation const& x, double lhs)
-        {
-            double rhs = boost::apply_visitor(*this, x.operand_);
-            if(x.op == "+")
-            {
-                return lhs + rhs;
-            }
-            else if(x.op == "-")
-            {
-                return lhs - rhs;
-            }
-            else if(x.op == "*")
-            {
-                return lhs * rhs;
-            }
-            else if(x.op == "/")
-            {
-                return lhs / rhs;
-            }
-            else if(x.op == "**" || x.op == "^")
-            {
-                return pow(lhs, rhs);
-            }
-
-            BOOST_ASSERT(0);
-            return 0;
-        }
-
-        double operator()(boolOperation const& x, double lhs)
-        {
-            if(isnan(lhs))
-            {
-                return std::numeric_limits<double>::quiet_NaN();
-            }
-
-            double rhs = boost::apply_visitor(*this, x.operand_);
-
-            if(isnan(rhs))
-            {
-                return std::numeric_limits<double>::quiet_NaN();
-            }
-
-            if(x.op == "||")
-            {
-                return lhs || rhs;
-            }
-            else if(x.op == "&&")
-            {
-                return lhs && rhs;
-            }
-            else if(x.op == "!=")
-            {
-                return lhs != rhs;
-            }
-            else if(x.op == "==")
-            {
-                return lhs == rhs;
-            }
-            else if(x.op == ">=")
-            {
-                return lhs >= rhs;
-            }
-            else if(x.op == "<=")
-            {
-                return lhs <= rhs;
-            }
-            else if(x.op == ">")
-            {
-                return lhs > rhs;
-            }
-            else if(x.op == "<")
-            {
-                return lhs < rhs;
-            }
-            BOOST_ASSERT(0);
-            return 0;
+            call(x.func_name);
         }
 
-        double operator()(unary const& x)
+        // The grammar keeps a call as its text, the name then the arguments in
+        // parentheses. The arguments are found by splitting on commas, a run of commas
+        // counting as one, and putting back together the pieces of an argument that is
+        // itself a call with several arguments, until its parentheses balance. An
+        // argument whose parentheses never balance is left out.
+        void call(const std::string & text)
         {
-            double rhs = boost::apply_visitor(*this, x.operand_);
-            switch (x.sign)
-            {
-                case '-': return -rhs;
-                case '+': return +rhs;
-            }
-            BOOST_ASSERT(0);
-            return 0;
-        }
-
-        double operator()(expr const& x) 
-        {
-            double state = boost::apply_visitor(*this, x.first);
-            BOOST_FOREACH(operation const& oper, x.rest)
-            {
-                state = (*this)(oper, state);
-            }
-            return state;
-        }
-
-        double operator()(boolExpr const& x) 
-        {
-            double state = boost::apply_visitor(*this, x.first);
-            BOOST_FOREACH(boolOperation const& oper, x.rest)
-            {
-                state = (*this)(oper, state);
-            }
-            return state;
-        }
-
-        double operator()(assignment const& x) 
-        {
-            double state = boost::apply_visitor(*this, x.rhs);
-
-            variable_map[x.name] = state;
-
-            return state;
-        }
-
-        double operator()(funcAssignment const& x) 
-        {
-            std::vector<std::string> args;
-            boost::split(args, x.func_name, boost::is_any_of("(),"), boost::token_compress_on);
-            function_map[args[0]] = x.func_expr;
-            for(int i = 1; i < args.size()-1; i++)
-            {
-                function_variable_map[args[0]][i-1] = args[i];
-            }
-
-            return 0;
-        }
-
-        double operator()(funcEval const& x) 
-        {
-            std::string identifier = x.func_name;
-            std::vector<std::string> args;
-            std::unordered_map<std::string, double> global_variable_map;
-            std::string curr_func_name;
-            std::string arguments;
-            std::string curr_arg;
-            int arg_num = 0;
-            size_t open_parenthesis_count = 0;
-            size_t close_parenthesis_count = 0;
-            typedef root ast_root;
-
-            // isolate the function name from it's arguments
-            boost::trim_if(identifier, boost::is_any_of("\r\n\t "));
-            size_t equals_idx = identifier.find_first_of("(");
-            curr_func_name = identifier.substr(0, equals_idx);
-            arguments = identifier.substr(equals_idx+1);
-            arguments = arguments.substr(0, arguments.length()-1);
-
-            boost::split(args, arguments, boost::is_any_of(","), boost::token_compress_on);
-            for(int i = 0; i < args.size(); i++)
-            {
-                // check if argument is actually a function with multiple inputs (which would 
-                // of been split because the delimiter is ","), re-construct the function 
-                // string if it is
-                if(curr_arg.empty())
+            const char * whitespace = "\r\n\t ";
+            size_t first = text.find_first_not_of(whitespace);
+            size_t last = first == std::string::npos ? first : text.find_last_not_of(whitespace) + 1;
+            if(first == std::string::npos)
+            {
+                first = last = 0;
+            }
+
+            // the name runs up to the first parenthesis, and the arguments from after it to
+            // before the last character
+            size_t open = text.find('(', first);
+            open = open < last ? open : std::string::npos;
+            size_t name_end = open == std::string::npos ? last : open;
+            size_t args_first = open == std::string::npos ? first : open + 1;
+            size_t args_last = args_first < last ? last - 1 : last;
+
+            tokens.append(expr_boost_common::FUNC_NAME, text.data() + first, name_end - first);
+            tokens.append(expr_boost_common::FUNC_BEGIN, "(", 1);
+
+            // the argument being put together starts at arg in the text of the stream
+            size_t arg = 0;
+            bool in_argument = false;
+            size_t num_open = 0, num_close = 0;
+            size_t piece = args_first;
+            while(true)
+            {
+                size_t comma = std::min(text.find(',', piece), args_last);
+                if(!in_argument)
                 {
-                    curr_arg = args[i];
+                    arg = tokens.text.size();
+                    num_open = num_close = 0;
                 }
                 else
                 {
-                    curr_arg += ",";
-                    curr_arg += args[i];
+                    tokens.text += ',';
                 }
 
-                open_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), '(');
-                if(open_parenthesis_count > 0)
-                {
-                    close_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), ')');
-                    if(open_parenthesis_count != close_parenthesis_count)
-                    {
-                        continue;
-                    }
-                }
-                else
-                {
-                    curr_arg = args[i];
-                }
+                tokens.text.append(text, piece, comma - piece);
+                num_open += std::count(text.begin() + piece, text.begin() + comma, '(');
+                num_close += std::count(text.begin() + piece, text.begin() + comma, ')');
 
-                // Evaluate each argument's value by running the phrase_parse on the argument (which is
-                // stored as a string.
-                evaluator<Grammar> eval(variable_map, function_variable_map, function_map, g);
-                ast_root arg_top;
-                boost::spirit::ascii::space_type space;
-
-                phrase_parse_routine(curr_arg, g, space, arg_top);
-
-                // Set the value of each argument for the scope of the function. These may be different
-                // from a variable's global value. For example, globally there may be a variable defined
-                // as "x=7". A function declaration may also use the same variable name, i.e. "f(x)=x+1".
-                // The variable "x" may be set to a different number in the scope of the function, but 
-                // this should not affect the global definition
-                double eval_result = eval(arg_top);
-                global_variable_map [function_variable_map[curr_func_name][arg_num]] = variable_map[function_variable_map[curr_func_name][arg_num]];
-                variable_map[function_variable_map[curr_func_name][arg_num]] = eval_result;
-
-                // check if any of the arguments are NaN. If so, restore variable map and return NaN as result
-                if(isnan(eval_result))
+                in_argument = num_open > 0 && num_open != num_close;
+                if(!in_argument)
                 {
-                    for(auto const & elem:global_variable_map)
-                    {
-                        variable_map[elem.first] = elem.second;
-                    }
-
-                    return std::numeric_limits<double>::quiet_NaN();
+                    tokens.offsets.push_back(arg);
+                    tokens.lengths.push_back(tokens.text.size() - arg);
+                    tokens.types.push_back(expr_boost_common::FUNC_ARG);
                 }
 
-                curr_arg = "";
-                arg_num++;
-            }
-
-            // Evaluate function's value by running the phrase_parse on the function string
-            evaluator<Grammar> eval(variable_map, function_variable_map, function_map, g);
-            ast_root top;
-            boost::spirit::ascii::space_type space;
-
-            phrase_parse_routine(function_map[curr_func_name], g, space, top);
-
-            double v = eval(top);
-
-            for(auto const & elem:global_variable_map)
-            {
-                variable_map[elem.first] = elem.second;
-            }
-
-            return v;
-        }
-
-        double operator()(builtIn const& x) 
-        {
-            std::string identifier = x.func_name;
-            std::vector<std::string> args;
-            std::vector<double> built_in_function_arguments;
-            std::string curr_func_name;
-            typedef root ast_root;
-
-            // isolate the function name from it's arguments
-            boost::trim_if(identifier, boost::is_any_of("\r\n\t "));
-
-            if(identifier.find("(") != std::string::npos)
-            {
-                size_t equals_idx = identifier.find_first_of("(");
-                std::string curr_arg;
-                std::string arguments;
-                size_t open_parenthesis_count = 0;
-                size_t close_parenthesis_count = 0;
-                curr_func_name = identifier.substr(0, equals_idx);
-                arguments = identifier.substr(equals_idx+1);
-                arguments = arguments.substr(0, arguments.length()-1);
-
-                boost::split(args, arguments, boost::is_any_of(","), boost::token_compress_on);
-                for(int i = 0; i < args.size(); i++)
+                if(comma == args_last)
                 {
-                    // check if argument is actually a function with multiple inputs (which would 
-                    // of been split because the delimiter is ","), re-construct the function 
-                    // string if it is
-                    if(curr_arg.empty())
-                    {
-                        curr_arg = args[i];
-                    }
-                    else
-                    {
-                        curr_arg += ",";
-                        curr_arg += args[i];
-                    }
-
-                    open_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), '(');
-                    if(open_parenthesis_count > 0)
-                    {
-                        close_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), ')');
-                        if(open_parenthesis_count != close_parenthesis_count)
-                        {
-                            continue;
-                        }
-                    }
-                    else
-                    {
-                        curr_arg = args[i];
-                    }
-
-                    // Evaluate each argument's value by running the phrase_parse on the argument (which is
-                    // stored as a string.
-                    evaluator<Grammar> eval(variable_map, function_variable_map, function_map, g);
-                    ast_root arg_top;
-                    boost::spirit::ascii::space_type space;
-
-                    phrase_parse_routine(curr_arg, g, space, arg_top);
-
-                    double eval_result = eval(arg_top);
-
-                    // check if any of the arguments are NaN. If so, return NaN as result
-                    if(isnan(eval_result))
-                    {
-                        return std::numeric_limits<double>::quiet_NaN();
-                    }
-
-                    built_in_function_arguments.push_back(eval_result);
-
-                    curr_arg = "";
+                    break;
                 }
-            }
-            else
-            {
-                curr_func_name = identifier;
-            }
 
-            if(boost::iequals("pi", curr_func_name))
-            {
-                return M_PI;
-            }
-            else if(boost::iequals("exp", curr_func_name))
-            {
-                return exp(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("log", curr_func_name))
-            {
-                return log(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("log10", curr_func_name))
-            {
-                return log10(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("cos", curr_func_name))
-            {
-                return cos(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("sin", curr_func_name))
-            {
-                return sin(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("tan", curr_func_name))
-            {
-                return tan(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("acos", curr_func_name))
-            {
-                return acos(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("asin", curr_func_name))
-            {
-                return asin(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("atan", curr_func_name))
-            {
-                return atan(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("cosh", curr_func_name))
-            {
-                return cosh(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("sinh", curr_func_name))
-            {
-                return sinh(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("tanh", curr_func_name))
-            {
-                return tanh(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("sqrt", curr_func_name))
-            {
-                return sqrt(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("agauss", curr_func_name))
-            {
-                double nominal = built_in_function_arguments[0];
-                double variation;
-
-                if(built_in_function_arguments.size() == 2)
-                {
-                    variation = built_in_function_arguments[1];
-                }
-                else
+                piece = comma;
+                while(piece < args_last && text[piece] == ',')
                 {
-                    variation = built_in_function_arguments[1]/built_in_function_arguments[2];
+                    piece++;
                 }
-
-                std::default_random_engine generator;
-                std::normal_distribution<double> distribution(nominal, variation);
-
-                return 0*distribution(generator);
             }
-            else if(boost::iequals("aunif", curr_func_name))
-            {
-                double nominal = built_in_function_arguments[0];
-                double variation;
 
-                if(built_in_function_arguments.size() == 2)
-                {
-                    variation = built_in_function_arguments[1];
-                }
-                else
-                {
-                    variation = built_in_function_arguments[1]/built_in_function_arguments[2];
-                }
-
-                std::default_random_engine generator;
-                std::uniform_real_distribution<double> distribution(-variation, variation);
-
-                return 0*(distribution(generator)+nominal);
-            }
-            else if(boost::iequals("max", curr_func_name))
-            {
-                return std::max(built_in_function_arguments[0], built_in_function_arguments[1]);
-            }
-            else if(boost::iequals("min", curr_func_name))
-            {
-                return std::min(built_in_function_arguments[0], built_in_function_arguments[1]);
-            }
-            else if(boost::iequals("int", curr_func_name))
-            {
-                return int(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("abs", curr_func_name))
-            {
-                return std::abs(built_in_function_arguments[0]);
-            }
-            else if(boost::iequals("sgn", curr_func_name))
-            {
-                if(built_in_function_arguments[0] < 0)
-                    return -1;
-                else if(built_in_function_arguments[0] > 0)
-                    return 1;
-                else
-                    return 0;
-            }
-            else if(boost::iequals("pow", curr_func_name))
+            if(in_argument)
             {
-                return pow(built_in_function_arguments[0], int(built_in_function_arguments[1]));
-            }
-            else if(boost::iequals("pwr", curr_func_name))
-            {
-                if(built_in_function_arguments[0] < 0)
-                    return -1*pow(std::abs(built_in_function_arguments[0]), built_in_function_arguments[1]);
-                else 
-                    return pow(std::abs(built_in_function_arguments[0]), built_in_function_arguments[1]);
+                tokens.text.resize(arg);
             }
 
-            BOOST_ASSERT(0);
-            return 0;
+            tokens.append(expr_boost_common::FUNC_END, ")", 1);
         }
 
-        double operator()(ternary const& x)
+        void operator()(ternary const& x) 
         {
-            typedef root ast_root;
-
-            evaluator<Grammar> eval(variable_map, function_variable_map, function_map, g);
-            ast_root top;
-            boost::spirit::ascii::space_type space;
-
-            phrase_parse_routine(x.conditional, g, space, top);
-
-            double conditional = eval(top);
-
-            // check if conditional is NaN. if so, discontinue and return NaN
-            if(isnan(conditional))
-            {
-                return std::numeric_limits<double>::quiet_NaN();
-            }
-
-            if(conditional == 0)
-            {
-                phrase_parse_routine(x.right, g, space, top);
-
-                return eval(top);
-            }
-            else 
-            {
-                phrase_parse_routine(x.left, g, space, top);
-
-                return eval(top);
-            }
-            BOOST_ASSERT(0);
-            return 0;
+            tokens.append(expr_boost_common::TERNARY_CONDITION, x.conditional);
+            tokens.append(expr_boost_common::TERNARY_LEFT, x.left);
+            tokens.append(expr_boost_common::TERNARY_RIGHT, x.right);
         }
 
-        double operator()(root const& x) 
+        void operator()(root const& x) 
         {
-            double state = boost::apply_visitor(*this, x.first);
-
-            return state;
+            boost::apply_visitor(*this, x.first);
         }
     };
 
-
     template <typename Grammar, typename Skipper, typename ... Args>
     void phrase_parse_routine(const std::string& input, const Grammar& g, const Skipper& s, Args&& ... args)
     {
@@ -987,29 +397,6 @@ namespace ast_common
             // throw std::runtime_error("Parse error");
         }
     }
-
-
-    template <typename Grammar>
-    void process_input(const std::string& input, const Grammar& g, std::unordered_map<std::string, double> & variable_map, std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map, std::unordered_map<std::string, std::string> & function_map, double & out_val)
-    {
-        try 
-        {
-            typedef root ast_root;
-            evaluator<Grammar> eval(variable_map, function_variable_map, function_map, g);
-            ast_root top;
-            boost::spirit::ascii::space_type space;
-
-            phrase_parse_routine(input, g, space, top);
-
-            out_val = eval(top);
-        }
-        catch (std::exception& e) 
-        {
-            // std::cout << "EXCEPTION: " << e.what() << std::endl;
-        }
-
-        return;
-    }
 }
 
 BOOST_FUSION_ADAPT_STRUCT(
@@ -32,6 +32,7 @@
 #include <boost/spirit/include/phoenix_stl.hpp>
 #include <boost/spirit/include/phoenix_object.hpp>
 
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -56,6 +57,43 @@ namespace expr_boost_common
         std::string value;
     };
     
+    // The tokens of an expression, with their text kept in one string rather than a
+    // string each. Token i is text[offsets[i], offsets[i] + lengths[i]), and its type is
+    // types[i], an expr_data_model_type, or -1 if it has none.
+    struct token_stream
+    {
+        std::string text;
+        std::vector<int> offsets;
+        std::vector<int> lengths;
+        std::vector<int> types;
+
+        void append(int type, const char * value, size_t length)
+        {
+            offsets.push_back(text.size());
+            lengths.push_back(length);
+            types.push_back(type);
+            text.append(value, length);
+        }
+
+        void append(int type, const std::string & value)
+        {
+            append(type, value.data(), value.size());
+        }
+
+        size_t size() const
+        {
+            return types.size();
+        }
+
+        void clear()
+        {
+            text.clear();
+            offsets.clear();
+            lengths.clear();
+            types.clear();
+        }
+    };
+
     inline std::ostream& operator<< (std::ostream& os, const expr_object eo) 
     {
         std::cout << "{" << eo.value << ", [";
@@ -0,0 +1,1135 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef COMPILED_EXPR_HPP
+#define COMPILED_EXPR_HPP
+
+#include "ast_common.hpp"
+#include "parse_cache.hpp"
+#include "spice_number.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ast_common
+{
+    // Variables known to the evaluator. Each name is given a slot the first time it is
+    // seen, and compiled expressions refer to variables by slot only. A variable that
+    // has never been assigned holds NaN.
+    struct symbol_table
+    {
+        std::unordered_map<std::string, int> slots;
+        std::vector<std::string> names;
+        std::vector<double> values;
+
+        int slot(const std::string & name)
+        {
+            std::unordered_map<std::string, int>::const_iterator it = slots.find(name);
+            if(it != slots.end())
+            {
+                return it->second;
+            }
+
+            int s = names.size();
+            slots[name] = s;
+            names.push_back(name);
+            values.push_back(std::numeric_limits<double>::quiet_NaN());
+            return s;
+        }
+
+        double & operator[](const std::string & name)
+        {
+            return values[slot(name)];
+        }
+
+        size_t size() const
+        {
+            return names.size();
+        }
+    };
+
+    // An expression lowered from the AST. Nodes are stored with their operands before
+    // them, and the operands of a node are the entries [first, first+count) of
+    // operands. The meaning of index depends on the opcode: the variable slot for
+    // OP_VARIABLE and OP_ASSIGN, the position of the parameter in the call frame for
+    // OP_ARGUMENT, the built-in function for OP_BUILT_IN and the entry in the
+    // function_table for OP_CALL.
+    struct compiled_expr
+    {
+        enum opcode
+        {
+            OP_CONSTANT, OP_VARIABLE, OP_ARGUMENT, OP_NEGATE, OP_ADD, OP_SUBTRACT, OP_MULTIPLY, OP_DIVIDE, OP_POWER,
+            OP_LOGICAL_OR, OP_LOGICAL_AND, OP_INEQUALITY, OP_EQUALITY, OP_GREATER_THAN_OR_EQUAL,
+            OP_LESS_THAN_OR_EQUAL, OP_GREATER_THAN, OP_LESS_THAN, OP_TERNARY, OP_BUILT_IN, OP_CALL, OP_ASSIGN
+        };
+
+        enum built_in_function
+        {
+            FN_PI, FN_EXP, FN_LOG, FN_LOG10, FN_COS, FN_SIN, FN_TAN, FN_ACOS, FN_ASIN, FN_ATAN, FN_COSH,
+            FN_SINH, FN_TANH, FN_SQRT, FN_AGAUSS, FN_AUNIF, FN_MAX, FN_MIN, FN_INT, FN_ABS, FN_SGN, FN_POW,
+            FN_PWR, FN_UNKNOWN
+        };
+
+        struct node
+        {
+            opcode op;
+            int index;
+            double value;
+            int first;
+            int count;
+        };
+
+        std::vector<node> nodes;
+        std::vector<int> operands;
+        int root = -1;
+
+        int add(opcode op, int index = 0, double value = 0)
+        {
+            node n = { op, index, value, int(operands.size()), 0 };
+            nodes.push_back(n);
+            return nodes.size() - 1;
+        }
+
+        int add(opcode op, const std::vector<int> & args, int index = 0)
+        {
+            node n = { op, index, 0, int(operands.size()), int(args.size()) };
+            operands.insert(operands.end(), args.begin(), args.end());
+            nodes.push_back(n);
+            return nodes.size() - 1;
+        }
+
+        int operand(const node & n, int i) const
+        {
+            return operands[n.first + i];
+        }
+    };
+
+    // The user-defined functions, compiled on first use. The body reads its parameters
+    // from the frame of the call, with OP_ARGUMENT, and everything else from the symbol
+    // table, so a parameter hides a global variable of the same name only in the body.
+    struct user_function
+    {
+        std::string name;
+        int num_parameters = 0;
+        compiled_expr body;
+        bool defined = false;
+        bool compiled = false;
+        int times_compiled = 0;
+    };
+
+    struct function_table
+    {
+        std::unordered_map<std::string, int> index;
+        std::vector<user_function> functions;
+
+        // changes whenever a function is defined or compiled, so that what was worked out
+        // from the bodies can be worked out again
+        int version = 0;
+
+        int find_or_add(const std::string & name)
+        {
+            std::unordered_map<std::string, int>::const_iterator it = index.find(name);
+            if(it != index.end())
+            {
+                return it->second;
+            }
+
+            int f = functions.size();
+            index[name] = f;
+            functions.push_back(user_function());
+            functions.back().name = name;
+            return f;
+        }
+
+        // The definitions have changed, so every function has to be compiled again.
+        // Expressions already compiled keep calling the same entries.
+        void invalidate()
+        {
+            for(size_t i = 0; i < functions.size(); i++)
+            {
+                functions[i].compiled = false;
+            }
+            version++;
+        }
+    };
+
+    // Splits "name(arg1,arg2,...)" into the name and its arguments, keeping commas that
+    // are inside an argument's own parentheses. Returns false if there is no argument
+    // list at all.
+    inline bool split_call(std::string identifier, std::string & name, std::vector<std::string> & call_args)
+    {
+        boost::trim_if(identifier, boost::is_any_of("\r\n\t "));
+
+        size_t equals_idx = identifier.find_first_of("(");
+        name = identifier.substr(0, equals_idx);
+        if(equals_idx == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string arguments = identifier.substr(equals_idx+1);
+        arguments = arguments.substr(0, arguments.length()-1);
+
+        std::vector<std::string> args;
+        std::string curr_arg;
+        boost::split(args, arguments, boost::is_any_of(","), boost::token_compress_on);
+        for(size_t i = 0; i < args.size(); i++)
+        {
+            if(curr_arg.empty())
+            {
+                curr_arg = args[i];
+            }
+            else
+            {
+                curr_arg += ",";
+                curr_arg += args[i];
+            }
+
+            size_t open_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), '(');
+            if(open_parenthesis_count > 0)
+            {
+                size_t close_parenthesis_count = std::count(curr_arg.begin(), curr_arg.end(), ')');
+                if(open_parenthesis_count != close_parenthesis_count)
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                curr_arg = args[i];
+            }
+
+            call_args.push_back(curr_arg);
+            curr_arg = "";
+        }
+
+        return true;
+    }
+
+    inline compiled_expr::built_in_function built_in_id(const std::string & name)
+    {
+        static const char * names[] =
+        {
+            "pi", "exp", "log", "log10", "cos", "sin", "tan", "acos", "asin", "atan", "cosh",
+            "sinh", "tanh", "sqrt", "agauss", "aunif", "max", "min", "int", "abs", "sgn", "pow",
+            "pwr"
+        };
+
+        for(int i = 0; i < compiled_expr::FN_UNKNOWN; i++)
+        {
+            if(boost::iequals(names[i], name))
+            {
+                return compiled_expr::built_in_function(i);
+            }
+        }
+
+        return compiled_expr::FN_UNKNOWN;
+    }
+
+    inline void fold_constant(compiled_expr & e, int n);
+
+    // Lowers a parsed expression into a compiled_expr. The strings the grammar keeps for
+    // function arguments, ternary branches and function bodies are parsed here, once,
+    // rather than every time the expression is evaluated, and the trees are taken from
+    // the parse_cache when the same text has been parsed before. Operations on constants
+    // are folded as they are compiled.
+    template <typename Grammar>
+    struct compiler
+    {
+        compiler(symbol_table & variables, function_table & functions, std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map, std::unordered_map<std::string, std::string> & function_map, const Grammar & g)
+            : variables(variables), functions(functions), function_variable_map(function_variable_map), function_map(function_map), g(g), out(0), parameters(0), num_definitions(0) { }
+
+        typedef int result_type;
+        symbol_table & variables;
+        function_table & functions;
+        std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map;
+        std::unordered_map<std::string, std::string> & function_map;
+        const Grammar & g;
+        compiled_expr * out;
+
+        // the parameters of the function whose body is being compiled, if any
+        const std::vector<std::string> * parameters;
+
+        // how many function definitions have been compiled
+        int num_definitions;
+
+        compiled_expr compile(const std::string & input)
+        {
+            std::shared_ptr<const root> top = parse_cache<Grammar>::shared().parse(input, g);
+
+            return compile(*top);
+        }
+
+        compiled_expr compile(const root & top)
+        {
+            compiled_expr result;
+            compiled_expr * outer = out;
+
+            out = &result;
+            result.root = (*this)(top);
+            out = outer;
+
+            return result;
+        }
+
+        // Copies an expression compiled against other tables into this compiler's
+        // tables. Variables and functions are looked up by name in the order of the
+        // nodes referring to them, which is the order compiling the expression here
+        // would have looked them up in, so both ways end up with the same slots.
+        compiled_expr adopt(const compiled_expr & e, const symbol_table & their_variables, const function_table & their_functions)
+        {
+            compiled_expr result = e;
+            for(size_t n = 0; n < result.nodes.size(); n++)
+            {
+                compiled_expr::node & x = result.nodes[n];
+                if(x.op == compiled_expr::OP_VARIABLE || x.op == compiled_expr::OP_ASSIGN)
+                {
+                    x.index = variables.slot(their_variables.names[x.index]);
+                }
+                else if(x.op == compiled_expr::OP_CALL)
+                {
+                    x.index = functions.find_or_add(their_functions.functions[x.index].name);
+                    compile_function(x.index);
+                }
+            }
+            return result;
+        }
+
+        // Compiles every function invalidated since it was last compiled, so that the
+        // expressions already calling it see its new definition.
+        void compile_functions()
+        {
+            for(size_t f = 0; f < functions.functions.size(); f++)
+            {
+                compile_function(f);
+            }
+        }
+
+        // Compiles a user-defined function's body, if it has a definition and has not
+        // been compiled yet. A function is marked compiled before its body is compiled,
+        // so that a call to itself does not recurse here.
+        void compile_function(int f)
+        {
+            std::string name = functions.functions[f].name;
+            if(functions.functions[f].compiled)
+            {
+                return;
+            }
+
+            // expressions compiled against an earlier body may read other variables now
+            if(functions.functions[f].times_compiled++ > 0)
+            {
+                functions.version++;
+            }
+
+            functions.functions[f].compiled = true;
+            functions.functions[f].defined = function_map.find(name) != function_map.end();
+            if(!functions.functions[f].defined)
+            {
+                return;
+            }
+
+            std::vector<std::string> names;
+            std::map<int, std::string> & arg_names = function_variable_map[name];
+            for(std::map<int, std::string>::const_iterator it = arg_names.begin(); it != arg_names.end(); ++it)
+            {
+                names.push_back(it->second);
+            }
+
+            const std::vector<std::string> * outer = parameters;
+            parameters = &names;
+            compiled_expr body = compile(function_map[name]);
+            parameters = outer;
+
+            // compiling the body may have added functions, so the entry is looked up again
+            functions.functions[f].num_parameters = names.size();
+            functions.functions[f].body = body;
+        }
+
+        int operator()(nil)
+        {
+            return -1;
+        }
+
+        int operator()(variable const& x)
+        {
+            if(parameters)
+            {
+                std::vector<std::string>::const_iterator it = std::find(parameters->begin(), parameters->end(), x.var_name);
+                if(it != parameters->end())
+                {
+                    return out->add(compiled_expr::OP_ARGUMENT, it - parameters->begin());
+                }
+            }
+
+            return out->add(compiled_expr::OP_VARIABLE, variables.slot(x.var_name));
+        }
+
+        int operator()(number const& x)
+        {
+            return out->add(compiled_expr::OP_CONSTANT, 0, spice_number::to_double(x.constant_number));
+        }
+
+        int operator()(operation const& x, int lhs)
+        {
+            std::vector<int> args(1, lhs);
+            args.push_back(boost::apply_visitor(*this, x.operand_));
+
+            if(x.op == "+")
+            {
+                return fold(out->add(compiled_expr::OP_ADD, args));
+            }
+            else if(x.op == "-")
+            {
+                return fold(out->add(compiled_expr::OP_SUBTRACT, args));
+            }
+            else if(x.op == "*")
+            {
+                return fold(out->add(compiled_expr::OP_MULTIPLY, args));
+            }
+            else if(x.op == "/")
+            {
+                return fold(out->add(compiled_expr::OP_DIVIDE, args));
+            }
+            else if(x.op == "**" || x.op == "^")
+            {
+                return fold(out->add(compiled_expr::OP_POWER, args));
+            }
+
+            BOOST_ASSERT(0);
+            return -1;
+        }
+
+        int operator()(boolOperation const& x, int lhs)
+        {
+            std::vector<int> args(1, lhs);
+            args.push_back(boost::apply_visitor(*this, x.operand_));
+
+            if(x.op == "||")
+            {
+                return fold(out->add(compiled_expr::OP_LOGICAL_OR, args));
+            }
+            else if(x.op == "&&")
+            {
+                return fold(out->add(compiled_expr::OP_LOGICAL_AND, args));
+            }
+            else if(x.op == "!=")
+            {
+                return fold(out->add(compiled_expr::OP_INEQUALITY, args));
+            }
+            else if(x.op == "==")
+            {
+                return fold(out->add(compiled_expr::OP_EQUALITY, args));
+            }
+            else if(x.op == ">=")
+            {
+                return fold(out->add(compiled_expr::OP_GREATER_THAN_OR_EQUAL, args));
+            }
+            else if(x.op == "<=")
+            {
+                return fold(out->add(compiled_expr::OP_LESS_THAN_OR_EQUAL, args));
+            }
+            else if(x.op == ">")
+            {
+                return fold(out->add(compiled_expr::OP_GREATER_THAN, args));
+            }
+            else if(x.op == "<")
+            {
+                return fold(out->add(compiled_expr::OP_LESS_THAN, args));
+            }
+
+            BOOST_ASSERT(0);
+            return -1;
+        }
+
+        int operator()(unary const& x)
+        {
+            int rhs = boost::apply_visitor(*this, x.operand_);
+            if(x.sign == '-')
+            {
+                return fold(out->add(compiled_expr::OP_NEGATE, std::vector<int>(1, rhs)));
+            }
+
+            return rhs;
+        }
+
+        int operator()(expr const& x)
+        {
+            int state = boost::apply_visitor(*this, x.first);
+            BOOST_FOREACH(operation const& oper, x.rest)
+            {
+                state = (*this)(oper, state);
+            }
+            return state;
+        }
+
+        int operator()(boolExpr const& x)
+        {
+            int state = boost::apply_visitor(*this, x.first);
+            BOOST_FOREACH(boolOperation const& oper, x.rest)
+            {
+                state = (*this)(oper, state);
+            }
+            return state;
+        }
+
+        int operator()(assignment const& x)
+        {
+            int rhs = boost::apply_visitor(*this, x.rhs);
+
+            return out->add(compiled_expr::OP_ASSIGN, std::vector<int>(1, rhs), variables.slot(x.name));
+        }
+
+        int operator()(funcAssignment const& x)
+        {
+            std::vector<std::string> args;
+            boost::split(args, x.func_name, boost::is_any_of("(),"), boost::token_compress_on);
+            function_map[args[0]] = x.func_expr;
+            for(int i = 1; i < args.size()-1; i++)
+            {
+                function_variable_map[args[0]][i-1] = args[i];
+            }
+
+            int f = functions.find_or_add(args[0]);
+            functions.functions[f].compiled = false;
+            functions.version++;
+            num_definitions++;
+            compile_function(f);
+
+            return out->add(compiled_expr::OP_CONSTANT);
+        }
+
+        int operator()(funcEval const& x)
+        {
+            std::string func_name;
+            std::vector<std::string> call_args;
+            split_call(x.func_name, func_name, call_args);
+
+            std::vector<int> args = compile_arguments(call_args);
+            int f = functions.find_or_add(func_name);
+            compile_function(f);
+
+            return out->add(compiled_expr::OP_CALL, args, f);
+        }
+
+        int operator()(builtIn const& x)
+        {
+            std::string func_name;
+            std::vector<std::string> call_args;
+            split_call(x.func_name, func_name, call_args);
+
+            std::vector<int> args = compile_arguments(call_args);
+
+            return fold(out->add(compiled_expr::OP_BUILT_IN, args, built_in_id(func_name)));
+        }
+
+        int operator()(ternary const& x)
+        {
+            std::vector<int> args;
+            args.push_back(compile_part(x.conditional));
+            args.push_back(compile_part(x.left));
+            args.push_back(compile_part(x.right));
+
+            // with a constant condition only the branch taken is needed
+            if(args[0] >= 0 && out->nodes[args[0]].op == compiled_expr::OP_CONSTANT && !std::isnan(out->nodes[args[0]].value))
+            {
+                return out->nodes[args[0]].value == 0 ? args[2] : args[1];
+            }
+
+            return fold(out->add(compiled_expr::OP_TERNARY, args));
+        }
+
+        int operator()(root const& x)
+        {
+            return boost::apply_visitor(*this, x.first);
+        }
+
+        // Parses a piece of the expression kept as a string and compiles it into the
+        // current expression.
+        int compile_part(const std::string & input)
+        {
+            std::shared_ptr<const root> top = parse_cache<Grammar>::shared().parse(input, g);
+
+            return (*this)(*top);
+        }
+
+        int fold(int n)
+        {
+            fold_constant(*out, n);
+            return n;
+        }
+
+        std::vector<int> compile_arguments(const std::vector<std::string> & call_args)
+        {
+            std::vector<int> args;
+            for(size_t i = 0; i < call_args.size(); i++)
+            {
+                args.push_back(compile_part(call_args[i]));
+            }
+            return args;
+        }
+    };
+
+    // Adds the slots of the variables an expression reads to slots, including the ones
+    // read by the bodies of the user functions it calls. expanded marks the functions already looked at, and must have an entry for each
+    // function in the table.
+    inline void variables_read(const compiled_expr & e, const function_table & functions, std::vector<int> & slots, std::vector<bool> & expanded)
+    {
+        for(size_t n = 0; n < e.nodes.size(); n++)
+        {
+            const compiled_expr::node & x = e.nodes[n];
+            if(x.op == compiled_expr::OP_VARIABLE)
+            {
+                slots.push_back(x.index);
+            }
+            else if(x.op == compiled_expr::OP_CALL && !expanded[x.index])
+            {
+                expanded[x.index] = true;
+
+                variables_read(functions.functions[x.index].body, functions, slots, expanded);
+            }
+        }
+    }
+
+    // The slot an expression assigns to, or -1 if it is not an assignment.
+    inline int assigned_slot(const compiled_expr & e)
+    {
+        if(e.root >= 0 && e.nodes[e.root].op == compiled_expr::OP_ASSIGN)
+        {
+            return e.nodes[e.root].index;
+        }
+        return -1;
+    }
+
+    // The value of built-in function fn for its first num_args arguments, of which a holds
+    // up to three. None of them is NaN.
+    inline double apply_built_in(int fn, size_t num_args, const double * a)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+
+        switch(fn)
+        {
+            case compiled_expr::FN_PI:
+                return M_PI;
+            case compiled_expr::FN_EXP:
+                return num_args < 1 ? nan : exp(a[0]);
+            case compiled_expr::FN_LOG:
+                return num_args < 1 ? nan : log(a[0]);
+            case compiled_expr::FN_LOG10:
+                return num_args < 1 ? nan : log10(a[0]);
+            case compiled_expr::FN_COS:
+                return num_args < 1 ? nan : cos(a[0]);
+            case compiled_expr::FN_SIN:
+                return num_args < 1 ? nan : sin(a[0]);
+            case compiled_expr::FN_TAN:
+                return num_args < 1 ? nan : tan(a[0]);
+            case compiled_expr::FN_ACOS:
+                return num_args < 1 ? nan : acos(a[0]);
+            case compiled_expr::FN_ASIN:
+                return num_args < 1 ? nan : asin(a[0]);
+            case compiled_expr::FN_ATAN:
+                return num_args < 1 ? nan : atan(a[0]);
+            case compiled_expr::FN_COSH:
+                return num_args < 1 ? nan : cosh(a[0]);
+            case compiled_expr::FN_SINH:
+                return num_args < 1 ? nan : sinh(a[0]);
+            case compiled_expr::FN_TANH:
+                return num_args < 1 ? nan : tanh(a[0]);
+            case compiled_expr::FN_SQRT:
+                return num_args < 1 ? nan : sqrt(a[0]);
+            case compiled_expr::FN_AGAUSS:
+            {
+                if(num_args < 2)
+                {
+                    return nan;
+                }
+
+                double nominal = a[0];
+                double variation = num_args == 2 ? a[1] : a[1]/a[2];
+
+                std::default_random_engine generator;
+                std::normal_distribution<double> distribution(nominal, variation);
+
+                return 0*distribution(generator);
+            }
+            case compiled_expr::FN_AUNIF:
+            {
+                if(num_args < 2)
+                {
+                    return nan;
+                }
+
+                double nominal = a[0];
+                double variation = num_args == 2 ? a[1] : a[1]/a[2];
+
+                std::default_random_engine generator;
+                std::uniform_real_distribution<double> distribution(-variation, variation);
+
+                return 0*(distribution(generator)+nominal);
+            }
+            case compiled_expr::FN_MAX:
+                return num_args < 2 ? nan : std::max(a[0], a[1]);
+            case compiled_expr::FN_MIN:
+                return num_args < 2 ? nan : std::min(a[0], a[1]);
+            case compiled_expr::FN_INT:
+                return num_args < 1 ? nan : int(a[0]);
+            case compiled_expr::FN_ABS:
+                return num_args < 1 ? nan : std::abs(a[0]);
+            case compiled_expr::FN_SGN:
+                if(num_args < 1)
+                    return nan;
+                else if(a[0] < 0)
+                    return -1;
+                else if(a[0] > 0)
+                    return 1;
+                else
+                    return 0;
+            case compiled_expr::FN_POW:
+                return num_args < 2 ? nan : pow(a[0], int(a[1]));
+            case compiled_expr::FN_PWR:
+                if(num_args < 2)
+                    return nan;
+                else if(a[0] < 0)
+                    return -1*pow(std::abs(a[0]), a[1]);
+                else
+                    return pow(std::abs(a[0]), a[1]);
+        }
+
+        return nan;
+    }
+
+    // Evaluates compiled expressions against the symbol table. Anything that cannot be
+    // evaluated, such as an undefined variable or function, a missing argument or a
+    // part that failed to parse, gives NaN.
+    //
+    // The arguments of function calls live on a stack owned by the evaluator. A call
+    // pushes its arguments and makes them the current frame, which the body reads with
+    // OP_ARGUMENT, so calling a function never writes to the symbol table.
+    //
+    // Given a const symbol table, the evaluator leaves it alone altogether: assignments
+    // give the assigned value without storing it. Any number of such evaluators can
+    // then share the symbol table and the functions, as long as nothing else changes
+    // them meanwhile.
+    struct evaluator
+    {
+        evaluator(symbol_table & variables, const function_table & functions)
+            : variables(variables), assignments(&variables), functions(functions), depth(0), frame(0), frame_size(0) { }
+
+        evaluator(const symbol_table & variables, const function_table & functions)
+            : variables(variables), assignments(0), functions(functions), depth(0), frame(0), frame_size(0) { }
+
+        // deeper calls than this are taken to be unbounded recursion
+        static const int max_call_depth = 256;
+
+        const symbol_table & variables;
+        symbol_table * assignments;
+        const function_table & functions;
+        int depth;
+
+        std::vector<double> stack;
+        size_t frame;
+        int frame_size;
+
+        double operator()(const compiled_expr & e)
+        {
+            return eval(e, e.root);
+        }
+
+        double eval(const compiled_expr & e, int n)
+        {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+
+            if(n < 0)
+            {
+                return nan;
+            }
+
+            const compiled_expr::node & x = e.nodes[n];
+            switch(x.op)
+            {
+                case compiled_expr::OP_CONSTANT:
+                    return x.value;
+                case compiled_expr::OP_VARIABLE:
+                    return variables.values[x.index];
+                case compiled_expr::OP_ARGUMENT:
+                    return x.index < frame_size ? stack[frame + x.index] : nan;
+                case compiled_expr::OP_NEGATE:
+                    return -eval(e, e.operand(x, 0));
+                case compiled_expr::OP_ADD:
+                    return eval(e, e.operand(x, 0)) + eval(e, e.operand(x, 1));
+                case compiled_expr::OP_SUBTRACT:
+                    return eval(e, e.operand(x, 0)) - eval(e, e.operand(x, 1));
+                case compiled_expr::OP_MULTIPLY:
+                    return eval(e, e.operand(x, 0)) * eval(e, e.operand(x, 1));
+                case compiled_expr::OP_DIVIDE:
+                    return eval(e, e.operand(x, 0)) / eval(e, e.operand(x, 1));
+                case compiled_expr::OP_POWER:
+                {
+                    double lhs = eval(e, e.operand(x, 0));
+                    return pow(lhs, eval(e, e.operand(x, 1)));
+                }
+                case compiled_expr::OP_LOGICAL_OR:
+                case compiled_expr::OP_LOGICAL_AND:
+                case compiled_expr::OP_INEQUALITY:
+                case compiled_expr::OP_EQUALITY:
+                case compiled_expr::OP_GREATER_THAN_OR_EQUAL:
+                case compiled_expr::OP_LESS_THAN_OR_EQUAL:
+                case compiled_expr::OP_GREATER_THAN:
+                case compiled_expr::OP_LESS_THAN:
+                    return compare(e, x);
+                case compiled_expr::OP_TERNARY:
+                {
+                    double conditional = eval(e, e.operand(x, 0));
+                    if(std::isnan(conditional))
+                    {
+                        return nan;
+                    }
+                    return eval(e, e.operand(x, conditional == 0 ? 2 : 1));
+                }
+                case compiled_expr::OP_BUILT_IN:
+                    return built_in(e, x);
+                case compiled_expr::OP_CALL:
+                    return call(e, x);
+                case compiled_expr::OP_ASSIGN:
+                {
+                    double state = eval(e, e.operand(x, 0));
+                    if(assignments)
+                    {
+                        assignments->values[x.index] = state;
+                    }
+                    return state;
+                }
+            }
+
+            BOOST_ASSERT(0);
+            return nan;
+        }
+
+        double compare(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            double lhs = eval(e, e.operand(x, 0));
+            if(std::isnan(lhs))
+            {
+                return lhs;
+            }
+
+            double rhs = eval(e, e.operand(x, 1));
+            if(std::isnan(rhs))
+            {
+                return rhs;
+            }
+
+            switch(x.op)
+            {
+                case compiled_expr::OP_LOGICAL_OR:
+                    return lhs || rhs;
+                case compiled_expr::OP_LOGICAL_AND:
+                    return lhs && rhs;
+                case compiled_expr::OP_INEQUALITY:
+                    return lhs != rhs;
+                case compiled_expr::OP_EQUALITY:
+                    return lhs == rhs;
+                case compiled_expr::OP_GREATER_THAN_OR_EQUAL:
+                    return lhs >= rhs;
+                case compiled_expr::OP_LESS_THAN_OR_EQUAL:
+                    return lhs <= rhs;
+                case compiled_expr::OP_GREATER_THAN:
+                    return lhs > rhs;
+                case compiled_expr::OP_LESS_THAN:
+                    return lhs < rhs;
+                default:
+                    break;
+            }
+
+            BOOST_ASSERT(0);
+            return 0;
+        }
+
+        double call(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            const user_function & f = functions.functions[x.index];
+            if(!f.defined || depth >= max_call_depth)
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+
+            // the arguments are evaluated in the caller's frame, and any calls they make
+            // have popped their own frames by the time the next one is pushed
+            size_t base = stack.size();
+            if(!push_arguments(e, x))
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+
+            size_t outer_frame = frame;
+            int outer_frame_size = frame_size;
+            frame = base;
+            frame_size = std::min(x.count, f.num_parameters);
+
+            depth++;
+            double v = eval(f.body, f.body.root);
+            depth--;
+
+            frame = outer_frame;
+            frame_size = outer_frame_size;
+            stack.resize(base);
+
+            return v;
+        }
+
+        // Evaluates the operands of x onto the stack. Returns false, leaving the stack as
+        // it was, if any of them is NaN.
+        bool push_arguments(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            size_t base = stack.size();
+            for(int i = 0; i < x.count; i++)
+            {
+                double arg = eval(e, e.operand(x, i));
+                if(std::isnan(arg))
+                {
+                    stack.resize(base);
+                    return false;
+                }
+                stack.push_back(arg);
+            }
+            return true;
+        }
+
+        double built_in(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+
+            size_t base = stack.size();
+            if(!push_arguments(e, x))
+            {
+                return nan;
+            }
+
+            size_t num_args = x.count;
+            double a[3] = { nan, nan, nan };
+            std::copy(stack.begin() + base, stack.begin() + base + std::min<size_t>(num_args, 3), a);
+            stack.resize(base);
+
+            return apply_built_in(x.index, num_args, a);
+        }
+    };
+
+
+    // Replaces node n with the constant it evaluates to, if all its operands are
+    // constants and it gives the same result every time. Calls to user functions are
+    // left alone, since the function could be defined differently by the time the
+    // expression is evaluated.
+    inline void fold_constant(compiled_expr & e, int n)
+    {
+        compiled_expr::node & x = e.nodes[n];
+        if(x.op == compiled_expr::OP_CALL || x.op == compiled_expr::OP_ASSIGN ||
+                (x.op == compiled_expr::OP_BUILT_IN && (x.index == compiled_expr::FN_AGAUSS || x.index == compiled_expr::FN_AUNIF)))
+        {
+            return;
+        }
+
+        for(int i = 0; i < x.count; i++)
+        {
+            int operand = e.operand(x, i);
+            if(operand < 0 || e.nodes[operand].op != compiled_expr::OP_CONSTANT)
+            {
+                return;
+            }
+        }
+
+        symbol_table no_variables;
+        function_table no_functions;
+        double value = evaluator(static_cast<const symbol_table &>(no_variables), no_functions).eval(e, n);
+
+        compiled_expr::node constant = { compiled_expr::OP_CONSTANT, 0, value, x.first, 0 };
+        e.nodes[n] = constant;
+    }
+
+    // Results of statements, kept by what they were computed from: the expression, and the
+    // values of the variables it reads. Statements with the same expression share an id,
+    // so that, for example, parameters of many instances defined by the same call are
+    // worked out once for each set of values the call sees.
+    //
+    // Only expressions that call a function, built-in or user-defined, or raise to a
+    // power are kept, as the others cost less to evaluate than to look up. Neither are
+    // expressions that draw random numbers, directly or in a user function. Everything
+    // is forgotten when the user functions change.
+    struct evaluation_memo
+    {
+        // once there are this many results, they are all forgotten
+        static const size_t max_results = 1 << 20;
+
+        std::unordered_map<std::string, int> ids;
+        std::unordered_map<std::string, double> results;
+        int functions_version = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+
+        // Forgets the results if the functions have changed since they were kept, and
+        // returns whether it did, in which case the ids of expressions calling functions
+        // have to be looked up again.
+        bool reset(const function_table & functions)
+        {
+            if(functions.version == functions_version)
+            {
+                return false;
+            }
+
+            results.clear();
+            functions_version = functions.version;
+            return true;
+        }
+
+        // The id of an expression, or -1 if its results are not kept. Structurally equal
+        // expressions always get the same id.
+        int id(const compiled_expr & e, const function_table & functions)
+        {
+            std::vector<bool> expanded(functions.functions.size(), false);
+            bool worth_keeping = false;
+            if(draws_random_numbers(e, functions, expanded, worth_keeping) || !worth_keeping)
+            {
+                return -1;
+            }
+
+            // the slot an assignment stores into does not change the result
+            std::string key;
+            for(size_t n = 0; n < e.nodes.size(); n++)
+            {
+                compiled_expr::node x = e.nodes[n];
+                if(x.op == compiled_expr::OP_ASSIGN)
+                {
+                    x.index = -1;
+                }
+                append(key, x.op);
+                append(key, x.index);
+                append(key, x.value);
+                for(int i = 0; i < x.count; i++)
+                {
+                    append(key, e.operand(x, i));
+                }
+            }
+            append(key, e.root);
+
+            std::unordered_map<std::string, int>::const_iterator it = ids.find(key);
+            if(it != ids.end())
+            {
+                return it->second;
+            }
+
+            int new_id = ids.size();
+            ids[key] = new_id;
+            return new_id;
+        }
+
+        // Looks up the result of expression id over the current values of slots, which
+        // are all the variables it reads. key is set for keep() if there is none yet.
+        bool find(int id, const std::vector<int> & slots, const symbol_table & variables, std::string & key, double & value)
+        {
+            key.clear();
+            append(key, id);
+            for(size_t i = 0; i < slots.size(); i++)
+            {
+                append(key, variables.values[slots[i]]);
+            }
+
+            std::unordered_map<std::string, double>::const_iterator it = results.find(key);
+            if(it == results.end())
+            {
+                misses++;
+                return false;
+            }
+
+            hits++;
+            value = it->second;
+            return true;
+        }
+
+        void keep(const std::string & key, double value)
+        {
+            if(results.size() >= max_results)
+            {
+                results.clear();
+            }
+            results[key] = value;
+        }
+
+        template <typename T>
+        static void append(std::string & key, T t)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &t, sizeof(T));
+            key.append(bytes, sizeof(T));
+        }
+
+        static bool draws_random_numbers(const compiled_expr & e, const function_table & functions, std::vector<bool> & expanded, bool & worth_keeping)
+        {
+            for(size_t n = 0; n < e.nodes.size(); n++)
+            {
+                const compiled_expr::node & x = e.nodes[n];
+                if(x.op == compiled_expr::OP_BUILT_IN && (x.index == compiled_expr::FN_AGAUSS || x.index == compiled_expr::FN_AUNIF))
+                {
+                    return true;
+                }
+
+                worth_keeping = worth_keeping || x.op == compiled_expr::OP_BUILT_IN || x.op == compiled_expr::OP_CALL || x.op == compiled_expr::OP_POWER;
+                if(x.op == compiled_expr::OP_CALL && !expanded[x.index])
+                {
+                    expanded[x.index] = true;
+                    if(draws_random_numbers(functions.functions[x.index].body, functions, expanded, worth_keeping))
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+    };
+
+    template <typename Grammar>
+    void process_input(const std::string& input, const Grammar& g, symbol_table & variable_map, function_table & functions, std::unordered_map<std::string, std::map<int, std::string>> & function_variable_map, std::unordered_map<std::string, std::string> & function_map, double & out_val)
+    {
+        try
+        {
+            compiler<Grammar> compile(variable_map, functions, function_variable_map, function_map, g);
+            evaluator eval(variable_map, functions);
+
+            out_val = eval(compile.compile(input));
+        }
+        catch (std::exception& e)
+        {
+            // std::cout << "EXCEPTION: " << e.what() << std::endl;
+        }
+
+        return;
+    }
+}
+
+#endif
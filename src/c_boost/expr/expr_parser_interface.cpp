@@ -26,25 +26,80 @@
 #include <fstream>
 #include <iostream>
 
-void convert_to_parsed_objects(std::vector<expr_boost_common::expr_object> expr_parse_results, BoostParsedExpr parsedExpr) 
+// A memoryview of ints holding a copy of values
+static boost::python::object int_memoryview(const std::vector<int> & values)
 {
+    boost::python::object bytes(boost::python::handle<>(PyBytes_FromStringAndSize(
+                    reinterpret_cast<const char *>(values.data()), values.size() * sizeof(int))));
+    boost::python::object view(boost::python::handle<>(PyMemoryView_FromObject(bytes.ptr())));
+    return view.attr("cast")("i");
+}
 
-    for(int i = 0; i < expr_parse_results.size(); i++) 
+// token_text is a str, which Python indexes by code point, while the tokens are found
+// in the UTF-8 bytes of the expression. Returns the byte offsets and lengths as code
+// point ones, which are the same unless the expression has non-ASCII characters.
+static void to_code_points(const std::string & text, std::vector<int> & offsets, std::vector<int> & lengths)
+{
+    // code_points[i] is the number of code points in the first i bytes of text
+    std::vector<int> code_points(text.size() + 1, 0);
+    bool ascii = true;
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        unsigned char c = text[i];
+        ascii = ascii && c < 0x80;
+        // continuation bytes (10xxxxxx) are part of the preceding code point
+        code_points[i + 1] = code_points[i] + ((c & 0xC0) != 0x80 ? 1 : 0);
+    }
+    if(ascii)
     {
+        return;
+    }
 
-        boost::python::list typeList;
+    for(size_t i = 0; i < offsets.size(); i++)
+    {
+        int end = code_points[offsets[i] + lengths[i]];
+        offsets[i] = code_points[offsets[i]];
+        lengths[i] = end - offsets[i];
+    }
+}
 
-        for(int j = 0; j < expr_parse_results[i].candidate_types.size(); j++) 
-        {
-            typeList.append(expr_parse_results[i].candidate_types[j]);
-        }
+void set_tokens(BoostParsedExpr & parsedExpr, const expr_boost_common::token_stream & tokens)
+{
+    parsedExpr.tokens = tokens;
+    parsedExpr.tokenText = boost::python::str(tokens.text.data(), tokens.text.size());
 
+    std::vector<int> offsets = tokens.offsets;
+    std::vector<int> lengths = tokens.lengths;
+    to_code_points(tokens.text, offsets, lengths);
+    parsedExpr.tokenOffsets = int_memoryview(offsets);
+    parsedExpr.tokenLengths = int_memoryview(lengths);
+    parsedExpr.tokenTypes = int_memoryview(tokens.types);
+    parsedExpr.parsedExprObjects = boost::python::list();
+    parsedExpr.madeParsedExprObjects = false;
+}
+
+boost::python::list parsed_expr_objects(BoostParsedExpr & parsedExpr)
+{
+    if(parsedExpr.madeParsedExprObjects)
+    {
+        return parsedExpr.parsedExprObjects;
+    }
+
+    const expr_boost_common::token_stream & tokens = parsedExpr.tokens;
+    for(size_t i = 0; i < tokens.size(); i++) 
+    {
         ParseExprObject obj;
-        obj.value = expr_parse_results[i].value;
-        obj.types = typeList;
+        obj.value = tokens.text.substr(tokens.offsets[i], tokens.lengths[i]);
+        if(tokens.types[i] >= 0)
+        {
+            obj.types.append(expr_boost_common::expr_data_model_type(tokens.types[i]));
+        }
 
         parsedExpr.parsedExprObjects.append(obj);
     }
+    parsedExpr.madeParsedExprObjects = true;
+
+    return parsedExpr.parsedExprObjects;
 }
 
 BOOST_PYTHON_MODULE(SpiritExprCommon)
@@ -55,7 +110,11 @@ BOOST_PYTHON_MODULE(SpiritExprCommon)
         ;
 
     boost::python::class_<BoostParsedExpr>("BoostParsedExpr")
-        .def_readonly("parsed_expr_objects", &BoostParsedExpr::parsedExprObjects)
+        .add_property("parsed_expr_objects", &parsed_expr_objects)
+        .def_readonly("token_text", &BoostParsedExpr::tokenText)
+        .def_readonly("token_offsets", &BoostParsedExpr::tokenOffsets)
+        .def_readonly("token_lengths", &BoostParsedExpr::tokenLengths)
+        .def_readonly("token_types", &BoostParsedExpr::tokenTypes)
         .def_readonly("sourceline", &BoostParsedExpr::sourceLine)
         .def_readonly("error_type", &BoostParsedExpr::errorType)
         .def_readonly("error_message", &BoostParsedExpr::errorMessage)
@@ -44,12 +44,24 @@ struct parse_results
 };
 
 
+// The tokens of a parsed expression are given to Python as one string, token_text, and
+// memoryviews of ints: token i is token_text[token_offsets[i]:token_offsets[i] +
+// token_lengths[i]] (in code points, like any index into a str; the C++ side keeps UTF-8
+// byte offsets in tokens), of type token_types[i], an expr_data_model_type or -1. The
+// ParseExprObject for each token is only made if parsed_expr_objects is asked for.
 struct BoostParsedExpr 
 {
     boost::python::list parsedExprObjects;
     std::string sourceLine;
     std::string errorType;
     std::string errorMessage;
+
+    expr_boost_common::token_stream tokens;
+    boost::python::object tokenText;
+    boost::python::object tokenOffsets;
+    boost::python::object tokenLengths;
+    boost::python::object tokenTypes;
+    bool madeParsedExprObjects = false;
 };
 
 
@@ -67,7 +79,8 @@ struct BoostEvaluatedExpr
     std::string errorMessage;
 };
 
-void convert_to_parsed_objects(std::vector<expr_boost_common::expr_object> expr_parse_results, BoostParsedExpr parsedExpr);
+void set_tokens(BoostParsedExpr & parsedExpr, const expr_boost_common::token_stream & tokens);
+boost::python::list parsed_expr_objects(BoostParsedExpr & parsedExpr);
 
 
 #endif
@@ -25,6 +25,7 @@
 #define HSPICE_ARITHMETIC_GRAMMAR_H
 
 #include "ast_common.hpp"
+#include "spice_number.hpp"
 #include <boost/spirit/include/qi.hpp>
 
 namespace qi = boost::spirit::qi;
@@ -152,13 +153,9 @@ struct HSPICEArithmeticGrammar : qi::grammar<Iterator, ast_common::root(), ascii
             char_("^")
             ;
 
-        number = 
-            hold[numeric >> -(char_(".") >> -numeric) >> no_case[char_("e") >> -(char_("-") | char_("+")) >> numeric]] | 
-            hold[numeric >> -(char_(".") >> -numeric) >> no_case[char_("afpnumkxg")]] |
-            hold[numeric >> -(char_(".") >> -numeric)] |
-            hold[char_(".") >> numeric >> no_case[char_("e") >> -(char_("-") | char_("+")) >> numeric]] | 
-            hold[char_(".") >> numeric >> no_case[char_("afpnumkxg")]] |
-            hold[char_(".") >> numeric]
+        // any SPICE scale factor, including meg and mil, and trailing units
+        number =
+            spice_number::parser(spice_number::FULL, false)
             ;
     
         parenthetical_math_expression = 
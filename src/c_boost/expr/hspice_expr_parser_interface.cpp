@@ -23,47 +23,68 @@
 
 #include "hspice_expr_parser_interface.hpp"
 #include "hspice_arithmetic_grammar.hpp"
+#include "monte_carlo.hpp"
+#include "xyce_expression.hpp"
+#include "scoped_gil_release.hpp"
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <queue>
+#include <thread>
 #include <boost/spirit/include/qi.hpp>
 
 namespace qi = boost::spirit::qi;
 
+typedef HSPICEArithmeticGrammar<std::string::const_iterator> expression_grammar;
+
+// The grammar parseExpr() and to_xyce() parse with. Building it costs far more than
+// parsing with it, and they are only ever called with the GIL held.
+static const expression_grammar & shared_grammar()
+{
+    static const expression_grammar g;
+    return g;
+}
+
 BoostParsedExpr HSPICEExprBoostParser::parseExpr(std::string expr)
 {
     BoostParsedExpr parsedExpr;
     parsedExpr.sourceLine = expr;
 
-    std::string::const_iterator start = expr.begin();
-    std::string::const_iterator end = expr.end();
-
-    std::vector<expr_boost_common::expr_object> expr_parse_result;
-
     typedef ast_common::root ast_root;
-    typedef std::string::const_iterator iterator_type;
-    typedef HSPICEArithmeticGrammar<iterator_type> grammar;
-    grammar g;
+
+    const expression_grammar & g = shared_grammar();
     ast_root top;
 
-    start = expr.begin();
-    end = expr.end();
-    ast_common::printer<grammar> print(variable_map, function_variable_map, function_map, g, expr_parse_result);
+    std::string::const_iterator start = expr.begin();
+    std::string::const_iterator end = expr.end();
     bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, top);
-    print(top);
 
+    expr_boost_common::token_stream tokens;
     if (r && start == end)
     {
-        convert_to_parsed_objects(expr_parse_result, parsedExpr);
+        ast_common::printer print(tokens);
+        print(top);
     }
     else
     {
         parsedExpr.errorType = "warn";
         parsedExpr.errorMessage = "\nHSpice Expression Parsing failed.";
     }
+    set_tokens(parsedExpr, tokens);
 
     return parsedExpr;
 }
 
+boost::python::tuple HSPICEExprBoostParser::to_xyce(std::string expr, bool braces)
+{
+    ast_common::xyce_expression xyce = ast_common::to_xyce(expr, braces, shared_grammar());
+    return boost::python::make_tuple(xyce.text, xyce.reads_temper, xyce.ternaries_match);
+}
+
 void HSPICEExprBoostParser::import_func_statements(class dict & py_dict)
 {
     Py_Initialize();
@@ -84,6 +105,8 @@ void HSPICEExprBoostParser::import_func_statements(class dict & py_dict)
         function_map[k] = v;
     }
 
+    functions.invalidate();
+
     return;
 }
 
@@ -111,132 +134,912 @@ void HSPICEExprBoostParser::import_func_args(class dict & py_dict)
         }
     }
 
+    functions.invalidate();
+
     return;
 }
 
 void HSPICEExprBoostParser::import_param_statements(class list & py_list)
 {
     Py_Initialize();
-    double out_val;
-    std::vector<std::string> unresolved_param_list;
-    int unresolved_count;
     typedef std::string::const_iterator iterator_type;
     typedef HSPICEArithmeticGrammar<iterator_type> grammar;
     grammar g;
+    ast_common::compiler<grammar> compile(variable_map, functions, function_variable_map, function_map, g);
+    compile.compile_functions();
+    ast_common::evaluator eval(variable_map, functions);
 
     std::cout << "Building parameter maps ... \n" << std::endl;
 
-    for(size_t i = 0; i < len(py_list); i++)
+    // the statements imported here are numbered from 0, and kept from base on
+    size_t num_statements = len(py_list);
+    size_t base = statements.size();
+    std::vector<int> targets(num_statements);
+
+    for(size_t i = 0; i < num_statements; i++)
     {
         extract<std::string> value_str(py_list[i]);
-        std::string param_name = value_str().substr(0, value_str().find("="));
+        add_statement(value_str(), compile.compile(value_str()), true);
+        targets[i] = ast_common::assigned_slot(compiled_statements[base + i]);
+    }
+
+    // SPICE doesn't care about ordering of parameters. So if a parameter depends on a second parameter, that second parameter 
+    // can appear after the first. Because of this, the statements are evaluated in dependency order: each one after the statements
+    // defining the parameters it reads. A parameter defined more than once keeps the order of its definitions, and the
+    // parameters reading it depend on the last one.
+    std::vector<int> previous_definition(num_statements, -1);
+    std::vector<int> last_definition(variable_map.size(), -1);
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        if(targets[i] >= 0)
+        {
+            previous_definition[i] = last_definition[targets[i]];
+            last_definition[targets[i]] = i;
+        }
+    }
 
-        ast_common::process_input(value_str(), g, variable_map, function_variable_map, function_map, out_val);
+    std::vector<std::vector<int> > dependencies(num_statements);
+    std::vector<std::vector<int> > dependents(num_statements);
+    std::vector<std::vector<int> > undefined(num_statements);
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        const std::vector<int> & slots = statement_reads[base + i];
 
-        if(isnan(variable_map[param_name]) || isinf(variable_map[param_name]))
+        if(previous_definition[i] >= 0)
         {
-            unresolved_param_list.push_back(value_str());
+            dependencies[i].push_back(previous_definition[i]);
         }
-        else
+
+        for(size_t j = 0; j < slots.size(); j++)
         {
-            param_list.push_back(value_str());
+            int definition = slots[j] == targets[i] ? previous_definition[i] : last_definition[slots[j]];
+            if(definition >= 0)
+            {
+                dependencies[i].push_back(definition);
+            }
+            else if(slots[j] == targets[i])
+            {
+                dependencies[i].push_back(i);
+            }
+            else if(isnan(variable_map.values[slots[j]]))
+            {
+                undefined[i].push_back(slots[j]);
+            }
+        }
+
+        std::sort(dependencies[i].begin(), dependencies[i].end());
+        dependencies[i].erase(std::unique(dependencies[i].begin(), dependencies[i].end()), dependencies[i].end());
+        for(size_t j = 0; j < dependencies[i].size(); j++)
+        {
+            dependents[dependencies[i][j]].push_back(i);
         }
     }
 
-    // SPICE doesn't care about ordering of parameters. So if a parameter depends on a second parameter, that second parameter 
-    // can appear after the first. Because of this, there needs to be a re-processing to make sure out of order parameters are
-    // evaluated correctly. This while loop does that by continuing to process unresolved parameters until the parameters cannot be
-    // resolved any further
-    unresolved_count = unresolved_param_list.size();
-    while(unresolved_count > 0)
+    // Statements become ready once everything they depend on has been evaluated, and the
+    // ready ones are taken in the order they were given.
+    std::vector<int> waiting_on(num_statements);
+    std::priority_queue<int, std::vector<int>, std::greater<int> > ready;
+    for(size_t i = 0; i < num_statements; i++)
     {
-        std::vector<std::string> new_unresolved_param_list;
-        int new_unresolved_count;
+        waiting_on[i] = dependencies[i].size();
+        if(waiting_on[i] == 0)
+        {
+            ready.push(i);
+        }
+    }
+
+    std::vector<bool> evaluated(num_statements, false);
+    std::vector<bool> resolved(num_statements, false);
+    while(!ready.empty())
+    {
+        int i = ready.top();
+        ready.pop();
+
+        double value = statement_values[base + i] = evaluate_statement(base + i, eval);
+        if(targets[i] >= 0)
+        {
+            value = variable_map.values[targets[i]];
+        }
 
-        for(int j = 0; j < unresolved_param_list.size(); j++)
+        evaluated[i] = true;
+        resolved[i] = !isnan(value) && !isinf(value);
+        if(resolved[i])
         {
-            std::string param_name = unresolved_param_list[j].substr(0, unresolved_param_list[j].find("="));
+            param_list.push_back(statements[base + i]);
+        }
 
-            ast_common::process_input(unresolved_param_list[j], g, variable_map, function_variable_map, function_map, out_val);
+        for(size_t j = 0; j < dependents[i].size(); j++)
+        {
+            if(--waiting_on[dependents[i][j]] == 0)
+            {
+                ready.push(dependents[i][j]);
+            }
+        }
+    }
 
-            if(isnan(variable_map[param_name]) || isinf(variable_map[param_name]))
+    // Whatever is left depends on a cycle. Dropping the statements no other one left
+    // depends on, repeatedly, leaves only the ones on a cycle or between two.
+    std::vector<int> num_dependents(num_statements, 0);
+    std::vector<int> unlinked;
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        for(size_t j = 0; !evaluated[i] && j < dependencies[i].size(); j++)
+        {
+            num_dependents[dependencies[i][j]]++;
+        }
+    }
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        if(!evaluated[i] && num_dependents[i] == 0)
+        {
+            unlinked.push_back(i);
+        }
+    }
+
+    std::vector<bool> on_cycle(num_statements, false);
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        on_cycle[i] = !evaluated[i];
+    }
+    while(!unlinked.empty())
+    {
+        int i = unlinked.back();
+        unlinked.pop_back();
+        on_cycle[i] = false;
+
+        for(size_t j = 0; j < dependencies[i].size(); j++)
+        {
+            if(!evaluated[dependencies[i][j]] && --num_dependents[dependencies[i][j]] == 0)
             {
-                new_unresolved_param_list.push_back(unresolved_param_list[j]);
+                unlinked.push_back(dependencies[i][j]);
             }
-            else
+        }
+    }
+
+    // These are evaluated in the order they were given, from whatever values they find.
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        if(!evaluated[i])
+        {
+            double value = statement_values[base + i] = evaluate_statement(base + i, eval);
+            if(targets[i] >= 0)
+            {
+                value = variable_map.values[targets[i]];
+            }
+
+            resolved[i] = !isnan(value) && !isinf(value);
+            if(resolved[i])
             {
-                param_list.push_back(unresolved_param_list[j]);
+                param_list.push_back(statements[base + i]);
             }
         }
+    }
 
-        new_unresolved_count = new_unresolved_param_list.size();
+    std::function<std::string (int)> param_name = [&](int i) {
+        return targets[i] >= 0 ? variable_map.names[targets[i]] : statements[base + i];
+    };
 
-        // If no further resolutions, stop
-        if(new_unresolved_count == unresolved_count)
+    bool reported = false;
+    for(size_t i = 0; i < num_statements; i++)
+    {
+        if(resolved[i])
+        {
+            continue;
+        }
+
+        if(!reported)
         {
             std::cout << "Could not resolve the following expressions:" << std::endl;
-            for(int j = 0; j < unresolved_param_list.size(); j++)
+            reported = true;
+        }
+
+        std::string reason;
+        if(!undefined[i].empty())
+        {
+            reason = "undefined parameter(s)";
+            for(size_t j = 0; j < undefined[i].size(); j++)
+            {
+                reason += (j == 0 ? " " : ", ") + variable_map.names[undefined[i][j]];
+            }
+        }
+        else if(on_cycle[i])
+        {
+            // follow dependencies on the cycle until one repeats
+            std::vector<int> path(1, i);
+            std::map<int, size_t> position;
+            while(position.find(path.back()) == position.end())
+            {
+                position[path.back()] = path.size() - 1;
+                const std::vector<int> & d = dependencies[path.back()];
+                path.push_back(*std::find_if(d.begin(), d.end(), [&](int j) { return on_cycle[j]; }));
+            }
+
+            size_t start = position[path.back()];
+            reason = start == 0 ? "circular definition " : "depends on circular definition ";
+            for(size_t j = start; j < path.size(); j++)
             {
-                std::cout << j << " " << unresolved_param_list[j] << std::endl;
+                reason += (j == start ? "" : " -> ") + param_name(path[j]);
             }
-            std::cout << "Continuing... " << std::endl;
-            break;
         }
         else
         {
-            unresolved_count = new_unresolved_count;
-            unresolved_param_list = new_unresolved_param_list;
+            const std::vector<int> & d = dependencies[i];
+            std::vector<int>::const_iterator unresolved = std::find_if(d.begin(), d.end(), [&](int j) { return !resolved[j]; });
+            if(unresolved != d.end())
+            {
+                reason = "depends on unresolved " + param_name(*unresolved);
+            }
+            else
+            {
+                reason = "does not evaluate to a finite value";
+            }
         }
+
+        std::cout << i << " " << statements[base + i] << " : " << reason << std::endl;
+    }
+
+    if(reported)
+    {
+        std::cout << "Continuing... " << std::endl;
     }
 
     return;
 }
 
+// Extracts the (hierarchy, expression) pairs given to eval_statements(). This is done with
+// the GIL held, so mismatched lists are reported before any evaluation starts.
+static void extract_statements(class list & py_list, class list & py_list_2, std::vector<std::string> & hierarchies, std::vector<std::string> & exprs)
+{
+    boost::python::ssize_t num_statements = len(py_list);
+    if(len(py_list_2) != num_statements)
+    {
+        PyErr_SetString(PyExc_ValueError, "The lists of hierarchies and expressions have different lengths.");
+        boost::python::throw_error_already_set();
+    }
+
+    for(boost::python::ssize_t i = 0; i < num_statements; i++)
+    {
+        hierarchies.push_back(extract<std::string>(py_list[i]));
+        exprs.push_back(extract<std::string>(py_list_2[i]));
+    }
+}
+
+// A memoryview of bytes holding a copy of values, which keeps the bytes object alive
+static boost::python::object as_memoryview(const std::vector<double> & values)
+{
+    boost::python::object bytes(boost::python::handle<>(PyBytes_FromStringAndSize(
+                    reinterpret_cast<const char *>(values.data()), values.size() * sizeof(double))));
+    return boost::python::object(boost::python::handle<>(PyMemoryView_FromObject(bytes.ptr())));
+}
+
 BoostEvaluatedExpr HSPICEExprBoostParser::eval_statements(class list & py_list, class list & py_list_2)
 {
     Py_Initialize();
-    double out_val;
+    BoostEvaluatedExpr output;
+    std::vector<std::string> hierarchies, exprs;
+
+    extract_statements(py_list, py_list_2, hierarchies, exprs);
+    std::vector<double> results = evaluate_batch(hierarchies, exprs);
+
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        if(verbose)
+        {
+            std::cout << "Evaluating " << hierarchies[i] << " " << exprs[i] << " ... " << std::endl;
+            std::cout << "EVALUATION RESULT : " << hierarchies[i] << " " << exprs[i] << "-->" << results[i] << "\n" << std::endl;
+        }
+
+        output.evalResult.append(results[i]);
+    }
+
+    return output;
+}
+
+boost::python::object HSPICEExprBoostParser::eval_statements_bulk(class list & py_list, class list & py_list_2)
+{
+    Py_Initialize();
+    std::vector<std::string> hierarchies, exprs;
+
+    extract_statements(py_list, py_list_2, hierarchies, exprs);
+    std::vector<double> results = evaluate_batch(hierarchies, exprs);
+
+    return as_memoryview(results).attr("cast")("d");
+}
+
+boost::python::object HSPICEExprBoostParser::eval_statements_mc(class list & py_list, class list & py_list_2, int num_samples, unsigned long long seed)
+{
+    Py_Initialize();
+    std::vector<std::string> hierarchies, exprs;
+
+    extract_statements(py_list, py_list_2, hierarchies, exprs);
+    num_samples = std::max(num_samples, 0);
+    std::vector<double> results = sample_batch(hierarchies, exprs, num_samples, seed);
+
+    // memoryview cannot have an empty dimension
+    if(results.empty())
+    {
+        return as_memoryview(results).attr("cast")("d");
+    }
+    return as_memoryview(results).attr("cast")("d", boost::python::make_tuple(exprs.size(), num_samples));
+}
+
+// Runs body(w, next) on up to num_threads threads, the calling thread being thread 0.
+// Each call takes chunks of [0, n) with next(first, last) until it returns false. When
+// there are not enough chunks to go round, fewer threads are used.
+template <typename Body>
+static void run_in_chunks(size_t n, size_t chunk, int num_threads, Body body)
+{
+    std::atomic<size_t> next_first(0);
+    auto next = [&](size_t & first, size_t & last)
+    {
+        first = next_first.fetch_add(chunk);
+        last = std::min(first + chunk, n);
+        return first < n;
+    };
+
+    size_t num_workers = std::min<size_t>(std::max(num_threads, 1), (n + chunk - 1) / chunk);
+    std::vector<std::thread> workers;
+    for(size_t w = 1; w < num_workers; w++)
+    {
+        workers.push_back(std::thread([&, w]() { body(w, next); }));
+    }
+    body(0, next);
+    for(size_t w = 0; w < workers.size(); w++)
+    {
+        workers[w].join();
+    }
+}
+
+// What a thread compiling statements for evaluate_batch() looks names up in. The
+// function definitions are copied, since a statement could define a function.
+struct batch_compile_tables
+{
+    ast_common::symbol_table variables;
+    ast_common::function_table functions;
+    std::unordered_map<std::string, std::map<int, std::string>> function_variable_map;
+    std::unordered_map<std::string, std::string> function_map;
+};
+
+// Compiles the expressions and evaluates them in the order they are given, without the
+// GIL, on up to num_threads threads.
+//
+// The statements are compiled in parallel, each thread against tables of its own, then
+// adopted into the shared tables in order, which gives them the slots compiling them
+// one by one would have.
+//
+// An expression has to wait for the earlier ones that assign a variable it reads, and
+// for the earlier ones that read or assign the variable it assigns itself. The others
+// are evaluated together, in rounds, by threads that share the symbol table read-only;
+// what a round assigns is only stored once it is over.
+std::vector<double> HSPICEExprBoostParser::evaluate_batch(const std::vector<std::string> & hierarchies, const std::vector<std::string> & exprs)
+{
+    ScopedGILRelease release;
     typedef std::string::const_iterator iterator_type;
     typedef HSPICEArithmeticGrammar<iterator_type> grammar;
     grammar g;
-    BoostEvaluatedExpr output;
+    ast_common::compiler<grammar> compile(variable_map, functions, function_variable_map, function_map, g);
+    compile.compile_functions();
+
+    size_t num_statements = exprs.size();
+    std::vector<std::string> param_statements(num_statements);
+    for(size_t k = 0; k < num_statements; k++)
+    {
+        const std::string & hier = hierarchies[k];
+        param_statements[k] = hier.substr(hier.find_last_of(":") + 1) + "=" + exprs[k];
+    }
+
+    std::vector<ast_common::compiled_expr> compiled(num_statements);
+    std::vector<int> compiled_by(num_statements, -1);
+    if(num_threads > 1)
+    {
+        std::vector<batch_compile_tables> tables(num_threads);
+        run_in_chunks(num_statements, 64, num_threads, [&](size_t w, std::function<bool(size_t &, size_t &)> next)
+        {
+            batch_compile_tables & t = tables[w];
+            t.function_variable_map = function_variable_map;
+            t.function_map = function_map;
+
+            grammar worker_g;
+            ast_common::compiler<grammar> worker_compile(t.variables, t.functions, t.function_variable_map, t.function_map, worker_g);
+
+            size_t first, last;
+            while(next(first, last))
+            {
+                for(size_t k = first; k < last; k++)
+                {
+                    int num_definitions = worker_compile.num_definitions;
+                    compiled[k] = worker_compile.compile(param_statements[k]);
+
+                    // a statement defining a function is compiled again against the
+                    // shared tables, where the definition belongs
+                    compiled_by[k] = worker_compile.num_definitions == num_definitions ? w : -1;
+                }
+            }
+        });
 
-    for(size_t i = 0; i < len(py_list); i++)
+        for(size_t k = 0; k < num_statements; k++)
+        {
+            if(compiled_by[k] >= 0)
+            {
+                const batch_compile_tables & t = tables[compiled_by[k]];
+                compiled[k] = compile.adopt(compiled[k], t.variables, t.functions);
+            }
+            else
+            {
+                compiled[k] = compile.compile(param_statements[k]);
+            }
+        }
+    }
+    else
     {
-        boost::python::object hier_value = py_list[i];
-        boost::python::object expr_value = py_list_2[i];
+        for(size_t k = 0; k < num_statements; k++)
+        {
+            compiled[k] = compile.compile(param_statements[k]);
+        }
+    }
 
-        extract<std::string> hier_str(hier_value);
-        std::string hier = hier_str();
-        extract<std::string> expr_str(expr_value);
-        std::string expr = expr_str();
+    std::vector<int> batch(num_statements);
+    for(size_t k = 0; k < num_statements; k++)
+    {
+        // the results are not definitions update_param() could replace
+        batch[k] = add_statement(param_statements[k], compiled[k], false);
+        result_statements.push_back(batch[k]);
+    }
 
-        std::cout << "Evaluating " << hier << " " << expr << " ... " << std::endl;
+    // the last round a variable was assigned in, and the last it was read or assigned in
+    std::vector<int> assigned_in(variable_map.size(), -1);
+    std::vector<int> used_in(variable_map.size(), 0);
+    std::vector<std::vector<int> > rounds;
+    for(size_t k = 0; k < num_statements; k++)
+    {
+        const std::vector<int> & slots = statement_reads[batch[k]];
+        int target = ast_common::assigned_slot(compiled_statements[batch[k]]);
 
-        std::string param_st;
-        if(hier.find(":") != std::string::npos)
+        int earliest = target >= 0 ? used_in[target] : 0;
+        for(size_t j = 0; j < slots.size(); j++)
+        {
+            earliest = std::max(earliest, assigned_in[slots[j]] + 1);
+        }
+
+        for(size_t j = 0; j < slots.size(); j++)
+        {
+            used_in[slots[j]] = std::max(used_in[slots[j]], earliest);
+        }
+        if(target >= 0)
         {
-            size_t equals_idx = hier.find_last_of(":");
-            param_st = hier.substr(equals_idx+1);
-            param_st += "=";
-            param_st += expr;
+            assigned_in[target] = earliest;
+            used_in[target] = earliest;
+        }
+
+        rounds.resize(std::max<size_t>(rounds.size(), earliest + 1));
+        rounds[earliest].push_back(k);
+    }
+
+    std::vector<double> results(num_statements);
+    const ast_common::symbol_table & snapshot = variable_map;
+    refresh_memo();
+    for(size_t r = 0; r < rounds.size(); r++)
+    {
+        const std::vector<int> & round = rounds[r];
+
+        // the memo is only used here, on this thread, before and after the round
+        std::vector<int> pending;
+        std::vector<std::string> keys(round.size());
+        for(size_t j = 0; j < round.size(); j++)
+        {
+            int i = batch[round[j]];
+            if(statement_ids[i] < 0 || !memo.find(statement_ids[i], statement_reads[i], variable_map, keys[j], results[round[j]]))
+            {
+                pending.push_back(j);
+            }
+        }
+
+        run_in_chunks(pending.size(), 256, num_threads, [&](size_t, std::function<bool(size_t &, size_t &)> next)
+        {
+            ast_common::evaluator eval(snapshot, functions);
+
+            size_t first, last;
+            while(next(first, last))
+            {
+                for(size_t p = first; p < last; p++)
+                {
+                    int k = round[pending[p]];
+                    results[k] = eval(compiled_statements[batch[k]]);
+                }
+            }
+        });
+
+        for(size_t p = 0; p < pending.size(); p++)
+        {
+            int k = round[pending[p]];
+            if(statement_ids[batch[k]] >= 0)
+            {
+                memo.keep(keys[pending[p]], results[k]);
+            }
+        }
+
+        for(size_t j = 0; j < round.size(); j++)
+        {
+            int i = batch[round[j]];
+            int target = ast_common::assigned_slot(compiled_statements[i]);
+
+            statement_values[i] = results[round[j]];
+            if(target >= 0)
+            {
+                variable_map.values[target] = results[round[j]];
+            }
+        }
+    }
+
+    return results;
+}
+
+// Compiles the expressions and evaluates them for blocks of samples, on up to num_threads
+// threads, without the GIL. The imported parameters that vary between samples are
+// evaluated for each block first, in dependency order. The random numbers depend only on
+// the seed, the text of the statement drawing them and the sample, so the result does
+// not depend on how the samples are split between threads. Returns the samples of each
+// expression in turn.
+std::vector<double> HSPICEExprBoostParser::sample_batch(const std::vector<std::string> & hierarchies, const std::vector<std::string> & exprs, int num_samples, unsigned long long seed)
+{
+    ScopedGILRelease release;
+    typedef std::string::const_iterator iterator_type;
+    typedef HSPICEArithmeticGrammar<iterator_type> grammar;
+    grammar g;
+    ast_common::compiler<grammar> compile(variable_map, functions, function_variable_map, function_map, g);
+    compile.compile_functions();
+
+    size_t num_statements = exprs.size();
+    std::vector<ast_common::compiled_expr> compiled(num_statements);
+    std::vector<ast_common::random_stream> streams(num_statements);
+    for(size_t k = 0; k < num_statements; k++)
+    {
+        const std::string & hier = hierarchies[k];
+        compiled[k] = compile.compile(hier.substr(hier.find_last_of(":") + 1) + "=" + exprs[k]);
+
+        // the whole hierarchy, so that every instance draws numbers of its own
+        streams[k] = ast_common::random_stream(seed, hier + "=" + exprs[k]);
+    }
+
+    // the definitions that draw random numbers, and the ones reading them
+    std::vector<int> random_definitions;
+    refresh_memo();
+    for(size_t i = 0; i < statements.size(); i++)
+    {
+        int target = ast_common::assigned_slot(compiled_statements[i]);
+        if(target >= 0 && definitions[target] == int(i) && ast_common::draws_random_numbers(compiled_statements[i], functions))
+        {
+            random_definitions.push_back(i);
+        }
+    }
+
+    std::vector<int> varying;
+    std::vector<ast_common::random_stream> varying_streams;
+    std::vector<int> downstream = downstream_of(random_definitions);
+    for(size_t j = 0; j < downstream.size(); j++)
+    {
+        int i = downstream[j];
+        int target = ast_common::assigned_slot(compiled_statements[i]);
+        if(target >= 0 && definitions[target] == i)
+        {
+            varying.push_back(i);
+            varying_streams.push_back(ast_common::random_stream(seed, statements[i]));
+        }
+    }
+
+    std::vector<double> results(num_statements * num_samples);
+    run_in_chunks(num_samples, 512, num_threads, [&](size_t, std::function<bool(size_t &, size_t &)> next)
+    {
+        ast_common::sample_evaluator eval(variable_map, functions);
+        std::vector<double> discarded;
+
+        size_t first, last;
+        while(next(first, last))
+        {
+            eval.start(first, last - first);
+            discarded.resize(last - first);
+
+            for(size_t j = 0; j < varying.size(); j++)
+            {
+                eval(compiled_statements[varying[j]], varying_streams[j], discarded.data());
+            }
+            for(size_t k = 0; k < num_statements; k++)
+            {
+                eval(compiled[k], streams[k], results.data() + k * num_samples + first);
+            }
+        }
+    });
+
+    return results;
+}
+
+BoostEvaluatedExpr HSPICEExprBoostParser::update_param(std::string name, std::string expr)
+{
+    Py_Initialize();
+    typedef std::string::const_iterator iterator_type;
+    typedef HSPICEArithmeticGrammar<iterator_type> grammar;
+    grammar g;
+    ast_common::compiler<grammar> compile(variable_map, functions, function_variable_map, function_map, g);
+    compile.compile_functions();
+    ast_common::evaluator eval(variable_map, functions);
+    BoostEvaluatedExpr output;
+
+    std::string statement = name + "=" + expr;
+    ast_common::compiled_expr compiled = compile.compile(statement);
+    int slot = variable_map.slot(name);
+
+    // a new definition that does not parse as an assignment to the parameter would leave it
+    // defined by something else, so the old definition stays in place
+    if(ast_common::assigned_slot(compiled) != slot)
+    {
+        output.errorType = "warn";
+        output.errorMessage = "Could not parse the new definition of " + name + ": " + expr;
+    }
+    else
+    {
+        // the last definition of the parameter is the one its readers see, so that is the
+        // one replaced
+        int i = size_t(slot) < definitions.size() ? definitions[slot] : -1;
+        if(i >= 0)
+        {
+            unindex_statement(i);
+            statements[i] = statement;
+            compiled_statements[i] = compiled;
+            statement_ids[i] = memo.id(compiled, functions);
+            index_statement(i, true);
         }
         else
         {
-            param_st = hier;
-            param_st += "=";
-            param_st += expr;
+            i = add_statement(statement, compiled, true);
         }
 
-        ast_common::process_input(param_st, g, variable_map, function_variable_map, function_map, out_val);
-        std::cout << "EVALUATION RESULT : " << hier << " " << expr << "-->" << out_val << "\n" << std::endl;
+        int num_evaluated = reevaluate(i, eval);
+
+        if(verbose)
+        {
+            std::cout << "Updated " << name << ", " << num_evaluated << " statement(s) re-evaluated" << std::endl;
+        }
+    }
 
-        output.evalResult.append(out_val);
+    // the results of every expression given to eval_statements(), in the same order
+    for(size_t j = 0; j < result_statements.size(); j++)
+    {
+        output.evalResult.append(statement_values[result_statements[j]]);
     }
 
     return output;
 }
 
+int HSPICEExprBoostParser::add_statement(const std::string & statement, const ast_common::compiled_expr & expr, bool is_definition)
+{
+    int i = statements.size();
+
+    statements.push_back(statement);
+    compiled_statements.push_back(expr);
+    statement_reads.push_back(std::vector<int>());
+    statement_values.push_back(std::numeric_limits<double>::quiet_NaN());
+    statement_ids.push_back(memo.id(expr, functions));
+    statement_versions.push_back(functions.version);
+    index_statement(i, is_definition);
+
+    return i;
+}
+
+void HSPICEExprBoostParser::index_statement(int i, bool is_definition)
+{
+    std::vector<int> & slots = statement_reads[i];
+    std::vector<bool> expanded(functions.functions.size(), false);
+
+    slots.clear();
+    ast_common::variables_read(compiled_statements[i], functions, slots, expanded);
+    std::sort(slots.begin(), slots.end());
+    slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+
+    readers.resize(variable_map.size());
+    definitions.resize(variable_map.size(), -1);
+    statement_versions[i] = functions.version;
+
+    for(size_t j = 0; j < slots.size(); j++)
+    {
+        readers[slots[j]].push_back(i);
+    }
+
+    int target = ast_common::assigned_slot(compiled_statements[i]);
+    if(is_definition && target >= 0 && definitions[target] < i)
+    {
+        definitions[target] = i;
+    }
+}
+
+void HSPICEExprBoostParser::unindex_statement(int i)
+{
+    const std::vector<int> & slots = statement_reads[i];
+
+    for(size_t j = 0; j < slots.size(); j++)
+    {
+        std::vector<int> & r = readers[slots[j]];
+        r.erase(std::remove(r.begin(), r.end(), i), r.end());
+    }
+}
+
+// Re-evaluates a statement and everything downstream of it, each after the statements
+// it depends on, and returns how many were evaluated.
+int HSPICEExprBoostParser::reevaluate(int first, ast_common::evaluator & eval)
+{
+    std::vector<int> affected = downstream_of(std::vector<int>(1, first));
+    for(size_t k = 0; k < affected.size(); k++)
+    {
+        statement_values[affected[k]] = evaluate_statement(affected[k], eval);
+    }
+
+    return affected.size();
+}
+
+// The given statements and everything downstream of them, in an order that puts each
+// after the statements it depends on. Statements on a cycle come last, in the order
+// they were added.
+std::vector<int> HSPICEExprBoostParser::downstream_of(const std::vector<int> & first)
+{
+    // who reads what has to be up to date with the functions
+    refresh_memo();
+
+    std::vector<int> affected;
+    std::vector<bool> is_affected(statements.size(), false);
+    for(size_t k = 0; k < first.size(); k++)
+    {
+        if(!is_affected[first[k]])
+        {
+            is_affected[first[k]] = true;
+            affected.push_back(first[k]);
+        }
+    }
+
+    // only the last definition of a variable is read, so the others stop here
+    for(size_t k = 0; k < affected.size(); k++)
+    {
+        int target = ast_common::assigned_slot(compiled_statements[affected[k]]);
+        if(target < 0 || definitions[target] != affected[k])
+        {
+            continue;
+        }
+
+        for(size_t j = 0; j < readers[target].size(); j++)
+        {
+            int r = readers[target][j];
+            if(!is_affected[r])
+            {
+                is_affected[r] = true;
+                affected.push_back(r);
+            }
+        }
+    }
+
+    std::map<int, std::vector<int> > dependents;
+    std::map<int, int> waiting_on;
+    for(size_t k = 0; k < affected.size(); k++)
+    {
+        int r = affected[k];
+        const std::vector<int> & slots = statement_reads[r];
+        waiting_on[r] = 0;
+
+        for(size_t j = 0; j < slots.size(); j++)
+        {
+            int d = definitions[slots[j]];
+            if(d >= 0 && d != r && is_affected[d])
+            {
+                dependents[d].push_back(r);
+                waiting_on[r]++;
+            }
+        }
+    }
+
+    std::priority_queue<int, std::vector<int>, std::greater<int> > ready;
+    for(std::map<int, int>::const_iterator it = waiting_on.begin(); it != waiting_on.end(); ++it)
+    {
+        if(it->second == 0)
+        {
+            ready.push(it->first);
+        }
+    }
+
+    std::vector<int> order;
+    std::vector<bool> done(statements.size(), false);
+    while(!ready.empty())
+    {
+        int i = ready.top();
+        ready.pop();
+
+        order.push_back(i);
+        done[i] = true;
+
+        std::vector<int> & d = dependents[i];
+        for(size_t j = 0; j < d.size(); j++)
+        {
+            if(--waiting_on[d[j]] == 0)
+            {
+                ready.push(d[j]);
+            }
+        }
+    }
+
+    for(std::map<int, int>::const_iterator it = waiting_on.begin(); it != waiting_on.end(); ++it)
+    {
+        if(!done[it->first])
+        {
+            order.push_back(it->first);
+        }
+    }
+
+    return order;
+}
+
+// Evaluates statement i, or takes its result from the memo if the same expression has
+// been evaluated over the same values before.
+double HSPICEExprBoostParser::evaluate_statement(int i, ast_common::evaluator & eval)
+{
+    refresh_memo();
+
+    std::string key;
+    double value;
+    if(statement_ids[i] >= 0 && memo.find(statement_ids[i], statement_reads[i], variable_map, key, value))
+    {
+        int target = ast_common::assigned_slot(compiled_statements[i]);
+        if(target >= 0)
+        {
+            variable_map.values[target] = value;
+        }
+        return value;
+    }
+
+    value = eval(compiled_statements[i]);
+    if(statement_ids[i] >= 0)
+    {
+        memo.keep(key, value);
+    }
+    return value;
+}
+
+// The functions have changed if the memo has been reset. The statements indexed before
+// then may now read other variables through them, and may or may not be worth keeping
+// results for, so they are indexed again.
+void HSPICEExprBoostParser::refresh_memo()
+{
+    if(!memo.reset(functions))
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < statements.size(); i++)
+    {
+        if(statement_versions[i] != functions.version)
+        {
+            int target = ast_common::assigned_slot(compiled_statements[i]);
+
+            unindex_statement(i);
+            index_statement(i, target >= 0 && definitions[target] == int(i));
+            statement_ids[i] = memo.id(compiled_statements[i], functions);
+        }
+    }
+}
+
+boost::python::dict HSPICEExprBoostParser::cache_stats()
+{
+    typedef HSPICEArithmeticGrammar<std::string::const_iterator> grammar;
+    ast_common::parse_cache<grammar> & cache = ast_common::parse_cache<grammar>::shared();
+
+    boost::python::dict stats;
+    stats["parse_hits"] = cache.num_hits();
+    stats["parse_misses"] = cache.num_misses();
+    stats["memo_hits"] = memo.hits;
+    stats["memo_misses"] = memo.misses;
+    return stats;
+}
+
+void HSPICEExprBoostParser::set_num_threads(int n)
+{
+    num_threads = n;
+}
+
 void HSPICEExprBoostParser::print_maps()
 {
     std::cout << "\nFUNCTION_MAP" << std::endl;
@@ -255,9 +1058,9 @@ void HSPICEExprBoostParser::print_maps()
     }
 
     std::cout << "\nVARIABLE_MAP" << std::endl;
-    for(auto elem : variable_map)
+    for(size_t i = 0; i < variable_map.size(); i++)
     {
-        std::cout << elem.first << " " << elem.second << std::endl;
+        std::cout << variable_map.names[i] << " " << variable_map.values[i] << std::endl;
     }
 
     std::cout << "\nPARAM_LIST" << std::endl;
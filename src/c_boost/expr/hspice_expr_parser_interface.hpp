@@ -29,6 +29,7 @@
 #include "boost_expr_parser_common.h"
 #include "expr_parser_interface.hpp"
 #include "ast_common.hpp"
+#include "compiled_expr.hpp"
 #include <boost/algorithm/string.hpp>
 #include <string>
 #include <vector>
@@ -46,16 +47,77 @@ class HSPICEExprBoostParser
         boost::python::list list;
         boost::python::list list2;
         std::vector<std::string> param_list;
-        std::unordered_map<std::string, double> variable_map;
+        ast_common::symbol_table variable_map;
         std::unordered_map<std::string, std::string> function_map;
         std::unordered_map<std::string, std::map<int, std::string>> function_variable_map;
+        ast_common::function_table functions;
+
+        // Every statement import_param_statements() and eval_statements() have evaluated,
+        // and the statements reading each variable, so that update_param() only has to
+        // re-evaluate what depends on the parameter it changes.
+        std::vector<std::string> statements;
+        std::vector<ast_common::compiled_expr> compiled_statements;
+        std::vector<std::vector<int> > statement_reads;
+        std::vector<double> statement_values;
+        std::vector<std::vector<int> > readers;
+        std::vector<int> definitions;
+        std::vector<int> result_statements;
+
+        // results of the statements that are worth keeping, see evaluation_memo, and the
+        // id of each statement's expression in it
+        ast_common::evaluation_memo memo;
+        std::vector<int> statement_ids;
+
+        // the version of the functions each statement was indexed against
+        std::vector<int> statement_versions;
+
+        // Threads eval_statements() and eval_statements_bulk() evaluate expressions on.
+        // 0 or 1 evaluates them all on the calling thread.
+        int num_threads = 0;
+
+        // print each expression eval_statements() evaluates, and its result
+        bool verbose = false;
 
         BoostParsedExpr parseExpr(std::string pythonExpr);
+
+        // The expression in Xyce syntax, see ast_common::to_xyce(), as a tuple of the
+        // rewritten text, whether it reads TEMPER, and whether its ternary operators pair up
+        boost::python::tuple to_xyce(std::string expr, bool braces);
+
         void import_func_statements(class dict & py_dict);
         void import_func_args(class dict & py_dict);
         void import_param_statements(class list & py_list);
         BoostEvaluatedExpr eval_statements(class list & py_list, class list & py_list_2);
+
+        // Same as eval_statements(), but returns the results as a memoryview of doubles
+        boost::python::object eval_statements_bulk(class list & py_list, class list & py_list_2);
+
+        // Evaluates the expressions for num_samples Monte Carlo samples in one pass, with
+        // agauss() and aunif() drawing a value for each sample. Imported parameters that
+        // draw random numbers, and the ones depending on them, are sampled as well. The
+        // same seed always gives the same samples. Nothing is stored: the parameters keep
+        // their nominal values. Returns a memoryview of doubles with a row of samples for
+        // each expression, which is flat if there are no expressions or no samples.
+        boost::python::object eval_statements_mc(class list & py_list, class list & py_list_2, int num_samples, unsigned long long seed);
+
+        BoostEvaluatedExpr update_param(std::string name, std::string expr);
         void print_maps();
+        void set_num_threads(int n);
+
+        // How often parsing found the text in the parse cache, which is shared by every
+        // parser, and how often evaluating a statement found its result in the memo
+        boost::python::dict cache_stats();
+
+    private:
+        std::vector<double> evaluate_batch(const std::vector<std::string> & hierarchies, const std::vector<std::string> & exprs);
+        std::vector<double> sample_batch(const std::vector<std::string> & hierarchies, const std::vector<std::string> & exprs, int num_samples, unsigned long long seed);
+        int add_statement(const std::string & statement, const ast_common::compiled_expr & expr, bool is_definition);
+        void index_statement(int i, bool is_definition);
+        void unindex_statement(int i);
+        int reevaluate(int first, ast_common::evaluator & eval);
+        std::vector<int> downstream_of(const std::vector<int> & first);
+        double evaluate_statement(int i, ast_common::evaluator & eval);
+        void refresh_memo();
 
 };
 
@@ -64,6 +126,7 @@ BOOST_PYTHON_MODULE(HSpiceExprSpirit)
 {
     boost::python::class_<HSPICEExprBoostParser>("HSPICEExprBoostParser")
         .def("parseExpr", &HSPICEExprBoostParser::parseExpr)
+        .def("to_xyce", &HSPICEExprBoostParser::to_xyce)
         .def_readwrite("py_dict", &HSPICEExprBoostParser::dict)
         .def_readwrite("py_list", &HSPICEExprBoostParser::list)
         .def_readwrite("py_list2", &HSPICEExprBoostParser::list2)
@@ -71,7 +134,13 @@ BOOST_PYTHON_MODULE(HSpiceExprSpirit)
         .def("import_func_args", &HSPICEExprBoostParser::import_func_args)
         .def("import_param_statements", &HSPICEExprBoostParser::import_param_statements)
         .def("eval_statements", &HSPICEExprBoostParser::eval_statements)
+        .def("eval_statements_bulk", &HSPICEExprBoostParser::eval_statements_bulk)
+        .def("eval_statements_mc", &HSPICEExprBoostParser::eval_statements_mc)
+        .def("update_param", &HSPICEExprBoostParser::update_param)
         .def("print_maps", &HSPICEExprBoostParser::print_maps)
+        .def("set_num_threads", &HSPICEExprBoostParser::set_num_threads)
+        .def("cache_stats", &HSPICEExprBoostParser::cache_stats)
+        .def_readwrite("verbose", &HSPICEExprBoostParser::verbose)
         ;
 }
 
@@ -0,0 +1,636 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef MONTE_CARLO_HPP
+#define MONTE_CARLO_HPP
+
+#include "compiled_expr.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+namespace ast_common
+{
+    // Whether evaluating an expression draws random numbers, directly or in a user function.
+    inline bool draws_random_numbers(const compiled_expr & e, const function_table & functions)
+    {
+        std::vector<bool> expanded(functions.functions.size(), false);
+        bool worth_keeping = false;
+        return evaluation_memo::draws_random_numbers(e, functions, expanded, worth_keeping);
+    }
+
+    // The random numbers of a Monte Carlo run. The n-th number of a stream is not drawn
+    // from a generator but worked out by hashing the key of the stream with n (this is
+    // SplitMix64), so samples can be evaluated in any order, or split between threads,
+    // and still get the same numbers for the same seed.
+    struct random_stream
+    {
+        random_stream() : key(0) { }
+
+        // The stream of a statement. The text is hashed with FNV-1a, which unlike
+        // std::hash gives the same key everywhere, so that a parameter defined the same
+        // way in every parser gets the same samples in each of them.
+        random_stream(uint64_t seed, const std::string & text)
+        {
+            uint64_t h = 14695981039346656037ULL;
+            for(size_t i = 0; i < text.size(); i++)
+            {
+                h = (h ^ static_cast<unsigned char>(text[i])) * 1099511628211ULL;
+            }
+            key = mix(h ^ mix(seed));
+        }
+
+        // the stream of the n-th draw made by the statement of this stream
+        random_stream draw(int n) const
+        {
+            random_stream s;
+            s.key = mix(key + uint64_t(n + 1) * 0xD1B54A32D192ED03ULL);
+            return s;
+        }
+
+        // the n-th number of the stream, uniformly distributed in (0, 1]
+        double uniform(uint64_t n) const
+        {
+            return ((mix(key + n * 0x9E3779B97F4A7C15ULL) >> 11) + 1) * (1.0 / 9007199254740992.0);
+        }
+
+        static uint64_t mix(uint64_t z)
+        {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t key;
+    };
+
+    // Evaluates compiled expressions over a block of Monte Carlo samples at once. A node
+    // gives a column holding its value in every sample, which operations work through in
+    // plain loops over contiguous doubles, or a single value if it is the same in all of
+    // them, as most of an expression usually is. agauss(nominal, variation, sigma) and
+    // aunif(nominal, variation) draw a value for each sample from the stream of the
+    // statement, which is where the columns come from.
+    //
+    // Variables read the columns the statements evaluated since start() assigned them,
+    // and otherwise the symbol table, which is never changed. Each sample gets NaN
+    // wherever the evaluator would have given it NaN.
+    struct sample_evaluator
+    {
+        // A column of values, or one value for every sample. column is the scratch column
+        // data points into if the column belongs to this value, and -1 if it is only
+        // borrowed.
+        struct samples
+        {
+            const double * data;
+            double value;
+            int column;
+        };
+
+        sample_evaluator(const symbol_table & variables, const function_table & functions)
+            : variables(variables), functions(functions), first_sample(0), num_samples(0), draws(0), depth(0), frame(0), frame_size(0) { }
+
+        // deeper calls than this are taken to be unbounded recursion
+        static const int max_call_depth = evaluator::max_call_depth;
+
+        const symbol_table & variables;
+        const function_table & functions;
+
+        // the block of samples, and what the statements evaluated for it have assigned
+        size_t first_sample;
+        int num_samples;
+        std::vector<double> values;
+        std::vector<std::vector<double> > columns;
+
+        random_stream stream;
+        int draws;
+
+        std::vector<std::vector<double> > scratch;
+        std::vector<int> free_columns;
+
+        std::vector<samples> stack;
+        int depth;
+        size_t frame;
+        int frame_size;
+
+        // Starts the block of n samples from first, forgetting everything assigned before.
+        void start(size_t first, int n)
+        {
+            if(n != num_samples)
+            {
+                scratch.clear();
+                free_columns.clear();
+            }
+
+            first_sample = first;
+            num_samples = n;
+            values = variables.values;
+            columns.resize(variables.size());
+            for(size_t i = 0; i < columns.size(); i++)
+            {
+                columns[i].clear();
+            }
+        }
+
+        // Evaluates e for every sample of the block, drawing from s, and writes the results
+        // to out.
+        void operator()(const compiled_expr & e, const random_stream & s, double * out)
+        {
+            stream = s;
+            draws = 0;
+
+            samples v = eval(e, e.root);
+            if(v.data)
+            {
+                std::copy(v.data, v.data + num_samples, out);
+            }
+            else
+            {
+                std::fill(out, out + num_samples, v.value);
+            }
+            release(v);
+
+            BOOST_ASSERT(free_columns.size() == scratch.size());
+        }
+
+        samples eval(const compiled_expr & e, int n)
+        {
+            if(n < 0)
+            {
+                return uniform(std::numeric_limits<double>::quiet_NaN());
+            }
+
+            const compiled_expr::node & x = e.nodes[n];
+            switch(x.op)
+            {
+                case compiled_expr::OP_CONSTANT:
+                    return uniform(x.value);
+                case compiled_expr::OP_VARIABLE:
+                    return variable(x.index);
+                case compiled_expr::OP_ARGUMENT:
+                    return x.index < frame_size ? borrow(stack[frame + x.index]) : uniform(std::numeric_limits<double>::quiet_NaN());
+                case compiled_expr::OP_NEGATE:
+                    return negate(eval(e, e.operand(x, 0)));
+                case compiled_expr::OP_ADD:
+                    return binary(e, x, std::plus<double>());
+                case compiled_expr::OP_SUBTRACT:
+                    return binary(e, x, std::minus<double>());
+                case compiled_expr::OP_MULTIPLY:
+                    return binary(e, x, std::multiplies<double>());
+                case compiled_expr::OP_DIVIDE:
+                    return binary(e, x, std::divides<double>());
+                case compiled_expr::OP_POWER:
+                    return binary(e, x, power());
+                case compiled_expr::OP_LOGICAL_OR:
+                    return binary(e, x, comparison<std::logical_or<double> >());
+                case compiled_expr::OP_LOGICAL_AND:
+                    return binary(e, x, comparison<std::logical_and<double> >());
+                case compiled_expr::OP_INEQUALITY:
+                    return binary(e, x, comparison<std::not_equal_to<double> >());
+                case compiled_expr::OP_EQUALITY:
+                    return binary(e, x, comparison<std::equal_to<double> >());
+                case compiled_expr::OP_GREATER_THAN_OR_EQUAL:
+                    return binary(e, x, comparison<std::greater_equal<double> >());
+                case compiled_expr::OP_LESS_THAN_OR_EQUAL:
+                    return binary(e, x, comparison<std::less_equal<double> >());
+                case compiled_expr::OP_GREATER_THAN:
+                    return binary(e, x, comparison<std::greater<double> >());
+                case compiled_expr::OP_LESS_THAN:
+                    return binary(e, x, comparison<std::less<double> >());
+                case compiled_expr::OP_TERNARY:
+                    return ternary(e, x);
+                case compiled_expr::OP_BUILT_IN:
+                    return built_in(e, x);
+                case compiled_expr::OP_CALL:
+                    return call(e, x);
+                case compiled_expr::OP_ASSIGN:
+                {
+                    samples v = eval(e, e.operand(x, 0));
+                    assign(x.index, v);
+                    return v;
+                }
+            }
+
+            BOOST_ASSERT(0);
+            return uniform(std::numeric_limits<double>::quiet_NaN());
+        }
+
+        struct power
+        {
+            double operator()(double lhs, double rhs) const
+            {
+                return pow(lhs, rhs);
+            }
+        };
+
+        // a comparison or logical operation, which is NaN if either side is
+        template <typename Op>
+        struct comparison
+        {
+            double operator()(double lhs, double rhs) const
+            {
+                return std::isnan(lhs) || std::isnan(rhs) ? std::numeric_limits<double>::quiet_NaN() : double(Op()(lhs, rhs));
+            }
+        };
+
+        template <typename Op>
+        samples binary(const compiled_expr & e, const compiled_expr::node & x, Op op)
+        {
+            samples operands[2] = { eval(e, e.operand(x, 0)), eval(e, e.operand(x, 1)) };
+            const samples & lhs = operands[0];
+            const samples & rhs = operands[1];
+
+            if(!lhs.data && !rhs.data)
+            {
+                return uniform(op(lhs.value, rhs.value));
+            }
+
+            int c = output_column(operands, 2);
+            double * out = scratch[c].data();
+            if(lhs.data && rhs.data)
+            {
+                for(int s = 0; s < num_samples; s++)
+                {
+                    out[s] = op(lhs.data[s], rhs.data[s]);
+                }
+            }
+            else if(lhs.data)
+            {
+                double r = rhs.value;
+                for(int s = 0; s < num_samples; s++)
+                {
+                    out[s] = op(lhs.data[s], r);
+                }
+            }
+            else
+            {
+                double l = lhs.value;
+                for(int s = 0; s < num_samples; s++)
+                {
+                    out[s] = op(l, rhs.data[s]);
+                }
+            }
+
+            return finish(c, operands, 2);
+        }
+
+        samples negate(samples operand)
+        {
+            if(!operand.data)
+            {
+                return uniform(-operand.value);
+            }
+
+            int c = output_column(&operand, 1);
+            double * out = scratch[c].data();
+            for(int s = 0; s < num_samples; s++)
+            {
+                out[s] = -operand.data[s];
+            }
+
+            return finish(c, &operand, 1);
+        }
+
+        // Both branches are evaluated unless the condition is the same in every sample.
+        samples ternary(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            samples conditional = eval(e, e.operand(x, 0));
+            if(!conditional.data)
+            {
+                if(std::isnan(conditional.value))
+                {
+                    return conditional;
+                }
+                return eval(e, e.operand(x, conditional.value == 0 ? 2 : 1));
+            }
+
+            samples operands[3] = { conditional, eval(e, e.operand(x, 1)), eval(e, e.operand(x, 2)) };
+            int c = output_column(operands, 3);
+            double * out = scratch[c].data();
+            for(int s = 0; s < num_samples; s++)
+            {
+                double v = conditional.data[s];
+                out[s] = std::isnan(v) ? v : (v == 0 ? at(operands[2], s) : at(operands[1], s));
+            }
+
+            return finish(c, operands, 3);
+        }
+
+        samples built_in(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+
+            size_t base = stack.size();
+            for(int i = 0; i < x.count; i++)
+            {
+                stack.push_back(eval(e, e.operand(x, i)));
+            }
+
+            samples * args = stack.data() + base;
+            size_t num_args = x.count;
+            bool varying = false;
+            for(size_t i = 0; i < num_args; i++)
+            {
+                varying = varying || args[i].data;
+            }
+
+            samples v;
+            if(x.index == compiled_expr::FN_AGAUSS || x.index == compiled_expr::FN_AUNIF)
+            {
+                v = draw(x.index, args, num_args);
+            }
+            else if(!varying)
+            {
+                double a[3] = { nan, nan, nan };
+                bool any_nan = false;
+                for(size_t i = 0; i < num_args; i++)
+                {
+                    any_nan = any_nan || std::isnan(args[i].value);
+                    if(i < 3)
+                    {
+                        a[i] = args[i].value;
+                    }
+                }
+                v = uniform(any_nan ? nan : apply_built_in(x.index, num_args, a));
+            }
+            else
+            {
+                int c = output_column(args, num_args);
+                double * out = scratch[c].data();
+                for(int s = 0; s < num_samples; s++)
+                {
+                    double a[3] = { nan, nan, nan };
+                    bool any_nan = false;
+                    for(size_t i = 0; i < num_args; i++)
+                    {
+                        double arg = at(args[i], s);
+                        any_nan = any_nan || std::isnan(arg);
+                        if(i < 3)
+                        {
+                            a[i] = arg;
+                        }
+                    }
+                    out[s] = any_nan ? nan : apply_built_in(x.index, num_args, a);
+                }
+                v = finish(c, args, num_args);
+            }
+
+            stack.resize(base);
+            return v;
+        }
+
+        // A value for each sample from the normal distribution with mean nominal and
+        // standard deviation variation/sigma, or the uniform one over nominal +/- variation
+        // (or variation/sigma, as the evaluator has it), taking numbers 2s and 2s+1 of the
+        // stream of this draw for sample s.
+        samples draw(int fn, samples * args, size_t num_args)
+        {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+
+            random_stream numbers = stream.draw(draws++);
+            if(num_args < 2)
+            {
+                release(args, num_args, -1);
+                return uniform(nan);
+            }
+
+            int c = output_column(args, num_args);
+            double * out = scratch[c].data();
+            for(int s = 0; s < num_samples; s++)
+            {
+                bool any_nan = false;
+                for(size_t i = 0; i < num_args; i++)
+                {
+                    any_nan = any_nan || std::isnan(at(args[i], s));
+                }
+
+                double nominal = at(args[0], s);
+                double variation = num_args == 2 ? at(args[1], s) : at(args[1], s)/at(args[2], s);
+                double u1 = numbers.uniform(2*(first_sample + s));
+                double u2 = numbers.uniform(2*(first_sample + s) + 1);
+
+                double deviation;
+                if(fn == compiled_expr::FN_AGAUSS)
+                {
+                    deviation = sqrt(-2*log(u1)) * cos(2*M_PI*u2);
+                }
+                else
+                {
+                    deviation = 2*u1 - 1;
+                }
+
+                out[s] = any_nan ? nan : nominal + variation*deviation;
+            }
+
+            return finish(c, args, num_args);
+        }
+
+        samples call(const compiled_expr & e, const compiled_expr::node & x)
+        {
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+
+            const user_function & f = functions.functions[x.index];
+            if(!f.defined || depth >= max_call_depth)
+            {
+                return uniform(nan);
+            }
+
+            size_t base = stack.size();
+            bool any_nan = false;
+            for(int i = 0; i < x.count; i++)
+            {
+                samples arg = eval(e, e.operand(x, i));
+                any_nan = any_nan || (!arg.data && std::isnan(arg.value));
+                stack.push_back(arg);
+            }
+
+            if(any_nan)
+            {
+                release(stack.data() + base, x.count, -1);
+                stack.resize(base);
+                return uniform(nan);
+            }
+
+            size_t outer_frame = frame;
+            int outer_frame_size = frame_size;
+            frame = base;
+            frame_size = std::min(x.count, f.num_parameters);
+
+            depth++;
+            samples v = eval(f.body, f.body.root);
+            depth--;
+
+            frame = outer_frame;
+            frame_size = outer_frame_size;
+
+            // the samples where an argument is NaN give NaN
+            samples * args = stack.data() + base;
+            for(int i = 0; i < x.count; i++)
+            {
+                if(!args[i].data || std::none_of(args[i].data, args[i].data + num_samples, [](double a) { return std::isnan(a); }))
+                {
+                    continue;
+                }
+
+                if(v.column < 0)
+                {
+                    int c = acquire();
+                    for(int s = 0; s < num_samples; s++)
+                    {
+                        scratch[c][s] = at(v, s);
+                    }
+                    v = owned(c);
+                }
+
+                double * out = scratch[v.column].data();
+                for(int s = 0; s < num_samples; s++)
+                {
+                    out[s] = std::isnan(args[i].data[s]) ? nan : out[s];
+                }
+            }
+
+            // the result may be one of the arguments, which it then takes over
+            for(int i = 0; i < x.count; i++)
+            {
+                if(v.column < 0 && v.data && args[i].column >= 0 && v.data == args[i].data)
+                {
+                    v.column = args[i].column;
+                }
+            }
+            release(args, x.count, v.column);
+            stack.resize(base);
+
+            return v;
+        }
+
+        void assign(int slot, const samples & v)
+        {
+            if(v.data)
+            {
+                if(v.data != columns[slot].data())
+                {
+                    columns[slot].assign(v.data, v.data + num_samples);
+                }
+            }
+            else
+            {
+                values[slot] = v.value;
+                columns[slot].clear();
+            }
+        }
+
+        samples variable(int slot) const
+        {
+            if(columns[slot].empty())
+            {
+                return uniform(values[slot]);
+            }
+
+            samples v = { columns[slot].data(), 0, -1 };
+            return v;
+        }
+
+        double at(const samples & v, int s) const
+        {
+            return v.data ? v.data[s] : v.value;
+        }
+
+        static samples uniform(double value)
+        {
+            samples v = { 0, value, -1 };
+            return v;
+        }
+
+        static samples borrow(const samples & v)
+        {
+            samples b = { v.data, v.value, -1 };
+            return b;
+        }
+
+        samples owned(int c) const
+        {
+            samples v = { scratch[c].data(), 0, c };
+            return v;
+        }
+
+        int acquire()
+        {
+            if(free_columns.empty())
+            {
+                scratch.push_back(std::vector<double>(num_samples));
+                return scratch.size() - 1;
+            }
+
+            int c = free_columns.back();
+            free_columns.pop_back();
+            return c;
+        }
+
+        void release(const samples & v)
+        {
+            if(v.column >= 0)
+            {
+                free_columns.push_back(v.column);
+            }
+        }
+
+        void release(const samples * operands, size_t count, int keep)
+        {
+            for(size_t i = 0; i < count; i++)
+            {
+                if(operands[i].column != keep)
+                {
+                    release(operands[i]);
+                }
+            }
+        }
+
+        // The column to write the result of an operation to: one of the operands' own, as
+        // each sample only reads its own operands, or a free one.
+        int output_column(const samples * operands, size_t count)
+        {
+            for(size_t i = 0; i < count; i++)
+            {
+                if(operands[i].column >= 0)
+                {
+                    return operands[i].column;
+                }
+            }
+            return acquire();
+        }
+
+        // The result written to column c, once the operands are no longer needed.
+        samples finish(int c, const samples * operands, size_t count)
+        {
+            release(operands, count, c);
+            return owned(c);
+        }
+    };
+}
+
+#endif
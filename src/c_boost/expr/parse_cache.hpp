@@ -0,0 +1,104 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef PARSE_CACHE_HPP
+#define PARSE_CACHE_HPP
+
+#include "ast_common.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+namespace ast_common
+{
+    // Trees parsed from expression text, shared by everything parsing with the same
+    // grammar. Parsing dominates the cost of compiling an expression, and libraries
+    // repeat the same expressions, and the same function arguments, many times over,
+    // across statements and across the parsers xdm makes for each subcircuit context.
+    // With the cache each distinct string is parsed once per process.
+    //
+    // The cache is safe to use from several threads. It stops growing once it holds
+    // max_entries trees, after which new text is parsed every time it is seen.
+    template <typename Grammar>
+    class parse_cache
+    {
+        public:
+            static const size_t max_entries = 1 << 18;
+
+            static parse_cache & shared()
+            {
+                static parse_cache cache;
+                return cache;
+            }
+
+            std::shared_ptr<const root> parse(const std::string & input, const Grammar & g)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    typename std::unordered_map<std::string, std::shared_ptr<const root> >::const_iterator it = trees.find(input);
+                    if(it != trees.end())
+                    {
+                        hits++;
+                        return it->second;
+                    }
+                    misses++;
+                }
+
+                // parsed without the lock, so two threads may both parse the same text
+                std::shared_ptr<root> top(new root);
+                phrase_parse_routine(input, g, boost::spirit::ascii::space, *top);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if(trees.size() < max_entries)
+                {
+                    trees.insert(std::make_pair(input, top));
+                }
+                return top;
+            }
+
+            size_t num_hits()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return hits;
+            }
+
+            size_t num_misses()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return misses;
+            }
+
+        private:
+            parse_cache() : hits(0), misses(0) { }
+
+            std::mutex mutex;
+            std::unordered_map<std::string, std::shared_ptr<const root> > trees;
+            size_t hits;
+            size_t misses;
+    };
+}
+
+#endif
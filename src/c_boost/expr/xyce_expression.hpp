@@ -0,0 +1,201 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef XYCE_EXPRESSION_HPP
+#define XYCE_EXPRESSION_HPP
+
+#include "ast_common.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+
+namespace ast_common
+{
+    // An HSPICE expression rewritten in Xyce syntax by to_xyce()
+    struct xyce_expression
+    {
+        std::string text;
+
+        // the expression reads the TEMPER special variable
+        bool reads_temper;
+
+        // false if a ':' has no '?' before it, or a '?' no ':' after it, in which case
+        // the spacing of the ternary operators is left as it was
+        bool ternaries_match;
+    };
+
+    // TEMPER as one of the pieces of the expression between operators, parentheses,
+    // spaces and quotes, in any case
+    inline bool reads_temper(const std::string & hspice)
+    {
+        static const char temper[] = "TEMPER";
+        const size_t temper_length = sizeof(temper) - 1;
+        const char * separators = "*/+-() '";
+
+        size_t first = 0;
+        while(first <= hspice.size())
+        {
+            size_t last = hspice.find_first_of(separators, first);
+            if(last == std::string::npos)
+            {
+                last = hspice.size();
+            }
+
+            if(last - first == temper_length)
+            {
+                size_t i = 0;
+                while(i < temper_length && std::toupper(static_cast<unsigned char>(hspice[first + i])) == temper[i])
+                {
+                    i++;
+                }
+                if(i == temper_length)
+                {
+                    return true;
+                }
+            }
+            first = last + 1;
+        }
+
+        return false;
+    }
+
+    // Xyce wants a space to the left of the ':' of a ternary operator. The '?' and ':' of
+    // the expression have to pair up; if they do not, it is returned as it is and
+    // matched is set to false.
+    inline std::string space_ternaries(const std::string & hspice, bool & matched)
+    {
+        matched = true;
+        if(hspice.find('?') == std::string::npos || hspice.find(':') == std::string::npos)
+        {
+            return hspice;
+        }
+
+        std::string spaced;
+        spaced.reserve(hspice.size() + 4);
+        size_t open = 0;
+        for(size_t i = 0; i < hspice.size(); i++)
+        {
+            char c = hspice[i];
+            if(c == ':')
+            {
+                if(open == 0)
+                {
+                    matched = false;
+                    return hspice;
+                }
+                open--;
+
+                if(spaced[spaced.size() - 1] != ' ')
+                {
+                    spaced += ' ';
+                }
+            }
+            else if(c == '?')
+            {
+                open++;
+            }
+            spaced += c;
+        }
+
+        if(open > 0)
+        {
+            matched = false;
+            return hspice;
+        }
+        return spaced;
+    }
+
+    // Whether Xyce needs the expression in curly braces, which is whenever it is
+    // anything other than a number, possibly signed. Text the grammar cannot parse is
+    // left as it is.
+    template <typename Grammar>
+    bool needs_braces(const std::string & hspice, const Grammar & g)
+    {
+        root top;
+        std::string::const_iterator start = hspice.begin();
+        std::string::const_iterator end = hspice.end();
+        bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, top);
+        if(!(r && start == end))
+        {
+            return false;
+        }
+
+        expr_boost_common::token_stream tokens;
+        printer print(tokens);
+        print(top);
+
+        if(tokens.size() == 1)
+        {
+            return tokens.types[0] != expr_boost_common::NUMBER;
+        }
+        if(tokens.size() == 2)
+        {
+            return !(tokens.types[0] == expr_boost_common::NUMBER &&
+                    (tokens.types[1] == expr_boost_common::UNARY_NEG || tokens.types[1] == expr_boost_common::UNARY_POS));
+        }
+        return tokens.size() > 0;
+    }
+
+    // Rewrites an HSPICE expression for Xyce in one go: spaces the ternary operators,
+    // encloses it in curly braces if braces is set (unless it is already quoted, which
+    // Xyce accepts as well, or does not need them), and spells the power operator "**"
+    // rather than "^". The text is otherwise kept as it was written.
+    template <typename Grammar>
+    xyce_expression to_xyce(const std::string & hspice, bool braces, const Grammar & g)
+    {
+        xyce_expression result;
+        result.reads_temper = reads_temper(hspice);
+
+        std::string text = space_ternaries(hspice, result.ternaries_match);
+
+        bool quoted = !text.empty() && text[0] == '\'' && text[text.size() - 1] == '\'';
+        if(braces && !quoted)
+        {
+            // quotes around function arguments go
+            text.erase(std::remove(text.begin(), text.end(), '\''), text.end());
+            if(needs_braces(text, g))
+            {
+                text = "{" + text + "}";
+            }
+        }
+
+        result.text.reserve(text.size() + 2);
+        for(size_t i = 0; i < text.size(); i++)
+        {
+            if(text[i] == '^')
+            {
+                result.text += "**";
+            }
+            else
+            {
+                result.text += text[i];
+            }
+        }
+
+        return result;
+    }
+}
+
+#endif
@@ -23,6 +23,7 @@
 
 #include <boost/python.hpp>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <fstream>
 #include <vector>
@@ -49,6 +50,12 @@ struct XmlLineReader {
     boost::python::dict ambiguityResolutionListDict;
     boost::python::dict adminDict;
 
+    // In lazy mode, read() only lists the devices in nameLevelTupleList, and their props,
+    // params, writers, ambiguity tokens and models are added to the dicts by load_device().
+    bool lazy = false;
+    std::vector<char> xmlBuffer;
+    std::map<std::vector<std::string>, rapidxml::xml_node<>*> deviceNodes;
+
     XmlLineReader() {
         doc = new rapidxml::xml_document<>();
     }
@@ -61,8 +68,10 @@ struct XmlLineReader {
     void traverse_xml(const std::string& input_xml)
     {
         bool debug = true;
-        // makes a copy of the xml - rapidxml alters it for its own purposes
-        std::vector<char> xml_copy(input_xml.begin(), input_xml.end());
+        // makes a copy of the xml - rapidxml alters it for its own purposes. The nodes point
+        // into the copy, so it is kept for as long as devices may still be loaded lazily.
+        std::vector<char> & xml_copy = xmlBuffer;
+        xml_copy.assign(input_xml.begin(), input_xml.end());
         xml_copy.push_back('\0');
         //rapidxml::xml_document<> doc;
         //doc.parse<rapidxml::parse_declaration_node | rapidxml::parse_no_data_nodes>(&xml_copy[0]);
@@ -95,75 +104,12 @@ struct XmlLineReader {
             boost::python::tuple nameLevelTuple = boost::python::make_tuple(deviceName, deviceLevel, deviceLevelKey, deviceVersion, deviceVersionKey, defaultAttributeValue, localName);
             nameLevelTupleList.append(nameLevelTuple);
 
-            // add device properties
-            boost::python::list devicePropList;
-            if (!add_props(cur_device_node->first_node("prop"), devicePropList, "prop"))
-                std::cout << "Could not add device properties for Device: "
-                    << deviceName << " Level: " << deviceLevel << std::endl;
-            devicePropListDict[nameLevelTuple] = devicePropList;
-
-            // add device params
-            boost::python::list deviceParamList;
-            if (!add_props(cur_device_node->first_node("param"), deviceParamList, "param"))
-                std::cout << "Could not add device params for Device: "
-                    << deviceName << " Level: " << deviceLevel << std::endl;
-            deviceParamListDict[nameLevelTuple] = deviceParamList;
-
-            // add ambiguity properties
-            rapidxml::xml_node<>* ambiguity_node = cur_device_node->first_node("ambiguity");
-            if (ambiguity_node) {
-                boost::python::list ambiguityTupleList;
-                for (rapidxml::xml_node<>* cur_token_node=ambiguity_node->first_node("token"); cur_token_node; cur_token_node=cur_token_node->next_sibling("token")) {
-
-                    // order, type, label are required attributes
-                    std::string order_string = cur_token_node->first_attribute("order")->value();
-                    std::string type_string = cur_token_node->first_attribute("type")->value();
-                    std::string label_string = cur_token_node->first_attribute("label")->value();
-
-                    // store ambiguity tuple: (order, type, label)
-                    boost::python::tuple ambiguityTuple = boost::python::make_tuple(order_string, type_string, label_string);
-                    ambiguityTupleList.append(ambiguityTuple);
-                }
-                ambiguityResolutionListDict[nameLevelTuple] = ambiguityTupleList;
-            }
-
-            // add device writer properties
-            boost::python::list deviceWriterPropList;
-            rapidxml::xml_node<>* device_writer_node = cur_device_node->first_node("writer");
-            if (!render_writer ( device_writer_node,
-                        deviceWriterPropList )) {
-                std::cout << "Instantiating the device writer failed" << std::endl;
-            }
-
-            deviceWriterTokenList[nameLevelTuple] = deviceWriterPropList;
-
-
-            // add model properties
-            rapidxml::xml_node<>* model_node = cur_device_node->first_node("model");
-
-            if (model_node) {
-                boost::python::list modelPropList;
-                if (!add_props(model_node->first_node("prop"), modelPropList, "prop"))
-                    std::cout << "Could not add model properties for Device: "
-                        << deviceName << " Level: " << deviceLevel << std::endl;
-                modelPropListDict[nameLevelTuple] = modelPropList;
-
-                boost::python::list modelParamList;
-                if (!add_props(model_node->first_node("param"), modelParamList, "param"))
-                    std::cout << "Could not add model params for Device: "
-                        << deviceName << " Level: " << deviceLevel << std::endl;
-                modelParamListDict[nameLevelTuple] = modelParamList;
-
-                // add model writer properties
-                boost::python::list modelWriterPropList;
-                rapidxml::xml_node<>* model_writer_node = model_node->first_node("writer");
-
-                if (!render_writer ( model_writer_node,
-                            modelWriterPropList )) {
-                    std::cout << "Instantiating the model writer failed" << std::endl;
-                }
-
-                modelWriterTokenList[nameLevelTuple] = modelWriterPropList;
+            // in lazy mode, the rest of the device is only added by load_device()
+            if (lazy) {
+                std::vector<std::string> deviceKey = {deviceName, deviceLevel, deviceLevelKey, deviceVersion, deviceVersionKey, defaultAttributeValue, localName};
+                deviceNodes[deviceKey] = cur_device_node;
+            } else {
+                add_device(cur_device_node, nameLevelTuple);
             }
         }
 
@@ -411,6 +357,84 @@ struct XmlLineReader {
           */
     }
 
+    // Adds the props, params, writers, ambiguity tokens and model of a device
+    void add_device(rapidxml::xml_node<>* cur_device_node, const boost::python::tuple & nameLevelTuple)
+    {
+        std::string deviceName = cur_device_node->first_attribute("key")->value();
+        std::string deviceLevel = cur_device_node->first_attribute("level")->value();
+
+        // add device properties
+        boost::python::list devicePropList;
+        if (!add_props(cur_device_node->first_node("prop"), devicePropList, "prop"))
+            std::cout << "Could not add device properties for Device: "
+                << deviceName << " Level: " << deviceLevel << std::endl;
+        devicePropListDict[nameLevelTuple] = devicePropList;
+
+        // add device params
+        boost::python::list deviceParamList;
+        if (!add_props(cur_device_node->first_node("param"), deviceParamList, "param"))
+            std::cout << "Could not add device params for Device: "
+                << deviceName << " Level: " << deviceLevel << std::endl;
+        deviceParamListDict[nameLevelTuple] = deviceParamList;
+
+        // add ambiguity properties
+        rapidxml::xml_node<>* ambiguity_node = cur_device_node->first_node("ambiguity");
+        if (ambiguity_node) {
+            boost::python::list ambiguityTupleList;
+            for (rapidxml::xml_node<>* cur_token_node=ambiguity_node->first_node("token"); cur_token_node; cur_token_node=cur_token_node->next_sibling("token")) {
+
+                // order, type, label are required attributes
+                std::string order_string = cur_token_node->first_attribute("order")->value();
+                std::string type_string = cur_token_node->first_attribute("type")->value();
+                std::string label_string = cur_token_node->first_attribute("label")->value();
+
+                // store ambiguity tuple: (order, type, label)
+                boost::python::tuple ambiguityTuple = boost::python::make_tuple(order_string, type_string, label_string);
+                ambiguityTupleList.append(ambiguityTuple);
+            }
+            ambiguityResolutionListDict[nameLevelTuple] = ambiguityTupleList;
+        }
+
+        // add device writer properties
+        boost::python::list deviceWriterPropList;
+        rapidxml::xml_node<>* device_writer_node = cur_device_node->first_node("writer");
+        if (!render_writer ( device_writer_node,
+                    deviceWriterPropList )) {
+            std::cout << "Instantiating the device writer failed" << std::endl;
+        }
+
+        deviceWriterTokenList[nameLevelTuple] = deviceWriterPropList;
+
+
+        // add model properties
+        rapidxml::xml_node<>* model_node = cur_device_node->first_node("model");
+
+        if (model_node) {
+            boost::python::list modelPropList;
+            if (!add_props(model_node->first_node("prop"), modelPropList, "prop"))
+                std::cout << "Could not add model properties for Device: "
+                    << deviceName << " Level: " << deviceLevel << std::endl;
+            modelPropListDict[nameLevelTuple] = modelPropList;
+
+            boost::python::list modelParamList;
+            if (!add_props(model_node->first_node("param"), modelParamList, "param"))
+                std::cout << "Could not add model params for Device: "
+                    << deviceName << " Level: " << deviceLevel << std::endl;
+            modelParamListDict[nameLevelTuple] = modelParamList;
+
+            // add model writer properties
+            boost::python::list modelWriterPropList;
+            rapidxml::xml_node<>* model_writer_node = model_node->first_node("writer");
+
+            if (!render_writer ( model_writer_node,
+                        modelWriterPropList )) {
+                std::cout << "Instantiating the model writer failed" << std::endl;
+            }
+
+            modelWriterTokenList[nameLevelTuple] = modelWriterPropList;
+        }
+    }
+
     // helper functions
     bool read(std::string path) {
         filename = path;
@@ -421,6 +445,26 @@ struct XmlLineReader {
 
 
         traverse_xml(str);
+
+        // the nodes are only needed to load devices later on
+        if (!lazy)
+            std::vector<char>().swap(xmlBuffer);
+        return true;
+    }
+
+    // Adds the device to the dicts, if it has not been already. Returns false if there is
+    // no such device.
+    bool load_device(const boost::python::tuple & nameLevelTuple) {
+        std::vector<std::string> deviceKey;
+        for (boost::python::ssize_t i = 0; i < boost::python::len(nameLevelTuple); i++)
+            deviceKey.push_back(boost::python::extract<std::string>(nameLevelTuple[i]));
+
+        std::map<std::vector<std::string>, rapidxml::xml_node<>*>::iterator device = deviceNodes.find(deviceKey);
+        if (device == deviceNodes.end())
+            return devicePropListDict.has_key(nameLevelTuple);
+
+        add_device(device->second, nameLevelTuple);
+        deviceNodes.erase(device);
         return true;
     }
 
@@ -619,6 +663,8 @@ BOOST_PYTHON_MODULE(XdmRapidXmlReader)
     using namespace boost::python;
     class_<XmlLineReader>("XmlLineReader")
         .def("read", &XmlLineReader::read)
+        .def_readwrite("lazy", &XmlLineReader::lazy)
+        .def("load_device", &XmlLineReader::load_device)
         .def_readonly("languageVersionTuple", &XmlLineReader::languageVersionTuple)
         .def_readonly("nameLevelTupleList", &XmlLineReader::nameLevelTupleList)
         .def_readonly("deviceDictList", &XmlLineReader::deviceDictList)
@@ -24,22 +24,24 @@
 #if !defined(BOOST_SPIRIT_HSPICE2)
 #define BOOST_SPIRIT_HSPICE2
 
+#include "inline_comment_rules.hpp"
+
 namespace qi = boost::spirit::qi;
 namespace ascii = boost::spirit::ascii;
 
 using namespace adm_boost_common;
 
 template <typename Iterator>
-struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>()>
+struct hspice_parser : qi::grammar<Iterator, netlist_statement_list()>
 {
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> netlist_line, analog_device, data_line, directive, transient, transient_or_ac_dc, table, abm_expression, control_expression, value_expression, param_value_pair, function_expression, measure_param_value_pair,
+    qi::rule<Iterator, netlist_statement_list()> netlist_line, analog_device, data_line, directive, transient, transient_or_ac_dc, table, abm_expression, control_expression, value_expression, param_value_pair, function_expression, measure_param_value_pair,
         vol_expression, cur_expression, circuit_params, poly, pulse_trans, sin_trans, exp_trans, pwl_trans, sffm_trans;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> bjt, capacitor, current_ctrl_current_src, current_ctrl_switch, current_ctrl_voltage_src, digital_dev, diode, inductor, port, resistor, indep_current_src,
+    qi::rule<Iterator, netlist_statement_list()> bjt, capacitor, current_ctrl_current_src, current_ctrl_switch, current_ctrl_voltage_src, digital_dev, diode, inductor, port, resistor, indep_current_src,
         indep_voltage_src, jfet, lossless_trans_line, mosfet, mututal_inductor, non_linear_dep_src, subcircuit, voltage_ctrl_current_src, voltage_ctrl_switch, voltage_ctrl_voltage_src, mesfet, lossy_trans_line,
         generic_switch;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> ac_dir, dc_dir, dcvolt_dir, eom_dir, end_dir, enddata_dir, ends_dir, endl_dir, global_param_dir, global_dir, hb_dir, ic_dir, inc_dir, lib_dir, measure_dir, model_dir,
+    qi::rule<Iterator, netlist_statement_list()> ac_dir, dc_dir, dcvolt_dir, eom_dir, end_dir, enddata_dir, ends_dir, endl_dir, global_param_dir, global_dir, hb_dir, ic_dir, inc_dir, lib_dir, measure_dir, model_dir,
         nodeset_dir, op_dir, options_dir, param_dir, preprocess_dir, print_dir, save_dir, sens_dir, step_dir, subckt_dir, temp_dir, tran_dir, four_dir, mor_dir, mpde_dir, lin_dir, data_dir;
 
     qi::rule<Iterator, netlist_statement_object()> AREA_VALUE, TRANSCONDUCTANCE_VALUE, COUPLING_VALUE, FUND_FREQ_VALUE, GAIN_VALUE,
@@ -66,10 +68,24 @@ struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
 
     qi::rule<Iterator, std::string()> identifier, math_expression, math_expression_single_quote_delimiter, math_expression_no_delimiter, composite_math_expression, output_variable_expression,
         simple_v_output_expression, inline_comment_str, comment_str, filename_str, param_with_comma, raw_identifier, no_curly_brace_expression, any, node_identifier, raw_node_identifier,
-        parenthetical_expression, numeric, number;
+        parenthetical_expression, number;
 
     qi::rule<Iterator> white_space, par_name;
 
+    // statement rules, tried by the keyword (or device letter) a line starts with
+    statement_dispatch<Iterator> devices, directives;
+
+    // number of device and directive rules tried so far
+    std::size_t alternatives_attempted() const {
+        return devices.attempted + directives.attempted;
+    }
+
+    // turns the keyword dispatch of statement rules off or back on, to measure it
+    void set_statement_dispatch(bool enabled) {
+        devices.enabled = enabled;
+        directives.enabled = enabled;
+    }
+
     hspice_parser() : hspice_parser::base_type(netlist_line)
     {
         using qi::lit;
@@ -88,10 +104,6 @@ struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
             *(char_)
             ;
 
-        numeric = 
-            +char_("0-9")
-            ;
-
         identifier =
             raw_identifier >> *(hold[char_(":") >> raw_identifier])
             ;
@@ -108,13 +120,10 @@ struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
             *(~char_("(),= \t\"'."))
             ;
 
-        number = 
-            hold[-lit("-") >> numeric >> -(char_(".") >> -numeric) >> no_case[char_("e") >> -(char_("-") | char_("+")) >> numeric]] | 
-            hold[-lit("-") >> numeric >> -(char_(".") >> -numeric) >> no_case[char_("afpnumkxg")]] |
-            hold[-lit("-") >> numeric >> -(char_(".") >> -numeric)] |
-            hold[-lit("-") >> char_(".") >> numeric >> no_case[char_("e") >> -(char_("-") | char_("+")) >> numeric]] | 
-            hold[-lit("-") >> char_(".") >> numeric >> no_case[char_("afpnumkxg")]] |
-            hold[-lit("-") >> char_(".") >> numeric]
+        // read in one pass; unlike the optional lit("-") it replaces, the lexer keeps a
+        // leading minus sign in the value
+        number =
+            spice_number::parser(spice_number::SINGLE_LETTER, true)
             ;
 
         no_curly_brace_expression =
@@ -161,9 +170,7 @@ struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
             hold[simple_v_output_expression]
             ;
 
-        inline_comment_str =
-            hold[(char_("$") >> *(char_))] | hold[(char_("*") >> *(char_))] | hold[(char_("/") >> char_("/") >> *(char_))];
-        ;
+        define_inline_comment_str(inline_comment_str, inline_comments::hspice());
 
         comment_str =
             hold[(char_("*") >> *(char_))] | hold[(char_("/") >> char_("/") >> *(char_))];
@@ -855,11 +862,45 @@ struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
 
         // DIRECTIVES ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+        // tried in this order, but only those matching the keyword the line starts with
+        directives.add(ac_dir, ".ac");
+        directives.add(data_dir, ".data");
+        directives.add(dcvolt_dir, ".dcvolt");
+        directives.add(dc_dir, ".dc");
+        directives.add(eom_dir, ".eom");
+        directives.add(ends_dir, ".ends");
+        directives.add(endl_dir, ".endl");
+        directives.add(enddata_dir, ".enddata");
+        directives.add(end_dir, ".end");
+        directives.add(global_param_dir, ".global_param");
+        directives.add(global_dir, ".global");
+        directives.add(hb_dir, ".hb");
+        directives.add(inc_dir, ".inc");
+        directives.add(ic_dir, ".ic .initcond");
+        directives.add(lib_dir, ".lib");
+        directives.add(lin_dir, ".lin");
+        directives.add(measure_dir, ".meas");
+        directives.add(model_dir, ".model");
+        directives.add(four_dir, ".four");
+        directives.add(nodeset_dir, ".nodeset");
+        directives.add(options_dir, ".option");
+        directives.add(op_dir, ".op");
+        directives.add(preprocess_dir, ".preprocess");
+        directives.add(print_dir, ".print .probe");
+        directives.add(param_dir, ".param");
+        directives.add(save_dir, ".save");
+        directives.add(sens_dir, ".sens");
+        directives.add(step_dir, ".step");
+        directives.add(subckt_dir, ".macro .subckt");
+        directives.add(temp_dir, ".temp");
+        directives.add(tran_dir, ".tr");
+        directives.add(mor_dir, ".mor");
+        directives.add(mpde_dir, ".mpde");
+        directives.build();
+
         directive =
-            ac_dir | data_dir | dcvolt_dir | dc_dir | eom_dir | ends_dir | endl_dir | enddata_dir | end_dir | global_param_dir | global_dir | hb_dir | inc_dir | ic_dir | lib_dir | lin_dir |
-            measure_dir | model_dir | four_dir | nodeset_dir | options_dir | op_dir | preprocess_dir | print_dir | param_dir | save_dir | sens_dir | step_dir | subckt_dir | temp_dir | tran_dir |
-            mor_dir | mpde_dir
-        ;
+            directives.start.alias()
+            ;
 
         ac_dir_type =
             qi::as_string[no_case[lit(".AC")]] [symbol_adder(_val, boost::spirit::_1, vector_of<data_model_type>(adm_boost_common::DIRECTIVE_TYPE))]
@@ -1154,8 +1195,35 @@ struct hspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
         // ANALOG DEVICES  ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+        // tried in this order, but only those matching the first letter(s) of the line
+        devices.add(bjt, "q");
+        devices.add(capacitor, "c");
+        devices.add(digital_dev, "y");
+        devices.add(diode, "d");
+        devices.add(generic_switch, "sw");
+        devices.add(current_ctrl_current_src, "f");
+        devices.add(current_ctrl_switch, "w");
+        devices.add(current_ctrl_voltage_src, "h");
+        devices.add(indep_current_src, "i");
+        devices.add(indep_voltage_src, "v");
+        devices.add(inductor, "l");
+        devices.add(jfet, "j");
+        devices.add(lossless_trans_line, "t");
+        devices.add(lossy_trans_line, "o");
+        devices.add(mesfet, "z");
+        devices.add(mosfet, "m");
+        devices.add(mututal_inductor, "k");
+        devices.add(non_linear_dep_src, "b");
+        devices.add(port, "p");
+        devices.add(resistor, "r");
+        devices.add(subcircuit, "x");
+        devices.add(voltage_ctrl_current_src, "g");
+        devices.add(voltage_ctrl_switch, "s");
+        devices.add(voltage_ctrl_voltage_src, "e");
+        devices.build();
+
         analog_device =
-            (bjt | capacitor | digital_dev | diode | generic_switch | current_ctrl_current_src | current_ctrl_switch | current_ctrl_voltage_src | indep_current_src | indep_voltage_src | inductor | jfet | lossless_trans_line | lossy_trans_line | mesfet | mosfet | mututal_inductor | non_linear_dep_src | port | resistor | subcircuit | voltage_ctrl_current_src | voltage_ctrl_switch | voltage_ctrl_voltage_src)
+            devices.start.alias()
             ;
 
         bjt_dev_type =
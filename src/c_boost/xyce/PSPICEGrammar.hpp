@@ -27,9 +27,9 @@
 #include "XyceParser.hpp"
 
 template <typename Iterator>
-struct pspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>()>
+struct pspice_parser : qi::grammar<Iterator, netlist_statement_list()>
 {
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> aliases_dir, distribution_dir, endaliases_dir, loadbias_dir, mc_dir, noise_dir,
+    qi::rule<Iterator, netlist_statement_list()> aliases_dir, distribution_dir, endaliases_dir, loadbias_dir, mc_dir, noise_dir,
         plot_dir, savebias_dir, stimulus_dir, text_dir, tf_dir, vector_dir, watch_dir, wcase_dir, pspice_start, lib_dir, options_dir, print_dir,
         probe_dir, temp_dir, tran_dir, directive, probe_64_dir, nodeset_dir, autoconverge_dir;
 
@@ -42,6 +42,20 @@ struct pspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
 
     xyce_parser<iterator_type> base_parser;
 
+    // statement rules, tried by the keyword (or device letter) a line starts with
+    statement_dispatch<Iterator> directives;
+
+    // number of device and directive rules tried so far
+    std::size_t alternatives_attempted() const {
+        return directives.attempted + base_parser.alternatives_attempted();
+    }
+
+    // turns the keyword dispatch of statement rules off or back on, to measure it
+    void set_statement_dispatch(bool enabled) {
+        directives.enabled = enabled;
+        base_parser.set_statement_dispatch(enabled);
+    }
+
     pspice_parser() : pspice_parser::base_type(pspice_start)
     {
         using qi::lit;
@@ -100,10 +114,34 @@ struct pspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
 
         // DIRECTIVES ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+        // tried in this order, but only those matching the keyword the line starts with
+        directives.add(probe_64_dir, ".probe64");
+        directives.add(lib_dir, ".lib");
+        directives.add(options_dir, ".options");
+        directives.add(print_dir, ".print");
+        directives.add(probe_dir, ".probe");
+        directives.add(temp_dir, ".temp");
+        directives.add(tran_dir, ".tr");
+        directives.add(aliases_dir, ".aliases");
+        directives.add(distribution_dir, ".distribution");
+        directives.add(endaliases_dir, ".endaliases");
+        directives.add(loadbias_dir, ".loadbias");
+        directives.add(mc_dir, ".mc");
+        directives.add(noise_dir, ".noise");
+        directives.add(plot_dir, ".plot");
+        directives.add(savebias_dir, ".savebias");
+        directives.add(stimulus_dir, ".stimulus");
+        directives.add(text_dir, ".text");
+        directives.add(tf_dir, ".tf");
+        directives.add(vector_dir, ".vector");
+        directives.add(watch_dir, ".watch");
+        directives.add(wcase_dir, ".wcase");
+        directives.add(nodeset_dir, ".nodeset");
+        directives.add(autoconverge_dir, ".autoconverge");
+        directives.build();
+
         directive =
-            probe_64_dir | lib_dir | options_dir | print_dir | probe_dir | temp_dir | tran_dir | aliases_dir | distribution_dir | endaliases_dir |
-            loadbias_dir | mc_dir | noise_dir | plot_dir | savebias_dir | stimulus_dir | text_dir | tf_dir | vector_dir | watch_dir |
-            wcase_dir | nodeset_dir | autoconverge_dir
+            directives.start.alias()
             ;
 
         lib_dir =
@@ -25,6 +25,7 @@
 #define BOOST_SPIRIT_SPECTRE
 
 #include "boost_adm_parser_common.h"
+#include "inline_comment_rules.hpp"
 #include <string>
 #include <unordered_map>
 
@@ -34,14 +35,14 @@ namespace ascii = boost::spirit::ascii;
 using namespace adm_boost_common;
 
 template <typename Iterator>
-struct spectre_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>()>
+struct spectre_parser : qi::grammar<Iterator, netlist_statement_list()>
 {
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()>
+    qi::rule<Iterator, netlist_statement_list()>
         spectre_line, param_value_pair, directive
         ;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()>
+    qi::rule<Iterator, netlist_statement_list()>
         capacitor, device, diode, inductor, mutual_inductor, resistor, mesfet,
         lossless_trans_line, jfet, vcvs, vccs, pvcvs, pvccs, vsource, isource,
         unknown_device, model_dir, param_dir, subckt_dir, ends_dir, include_dir,
@@ -93,6 +94,19 @@ struct spectre_parser : qi::grammar<Iterator, std::vector<netlist_statement_obje
 
     qi::rule<Iterator> white_space, analysis_identifier;
 
+    // directive rules, tried by the keyword a line starts with
+    statement_dispatch<Iterator> directives;
+
+    // number of directive rules tried so far
+    std::size_t alternatives_attempted() const {
+        return directives.attempted;
+    }
+
+    // turns the keyword dispatch of statement rules off or back on, to measure it
+    void set_statement_dispatch(bool enabled) {
+        directives.enabled = enabled;
+    }
+
     // part of an attempt to extract some common features between parsers into
     // a base parser, but it fails to compile
 
@@ -137,9 +151,7 @@ struct spectre_parser : qi::grammar<Iterator, std::vector<netlist_statement_obje
             (identifier) [symbol_adder(_val, boost::spirit::_1, vector_of<data_model_type>(adm_boost_common::OUTPUT_VARIABLE))]
             ;
 
-        inline_comment_str =
-            char_("/") >> char_("/") >> *(char_);
-        ;
+        define_inline_comment_str(inline_comment_str, inline_comments::spectre());
 
         comment_str =
             ("//" >> *(char_)) | (char_("*") >> *(char_));
@@ -951,12 +963,32 @@ struct spectre_parser : qi::grammar<Iterator, std::vector<netlist_statement_obje
 
         // DIRECTIVES ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////     ////////////////////////////////////////////////
 
+        // tried in this order, but only those matching the keyword the line starts with (or, like dc_dir, without one)
+        directives.add(dc_dir);
+        directives.add(modelParameter_dir, "modelparameter");
+        directives.add(section_dir, "section");
+        directives.add(endsection_dir, "endsection");
+        directives.add(model_dir, "model");
+        directives.add(param_dir, "parameters");
+        directives.add(subckt_dir, "inline subckt");
+        directives.add(ends_dir, "ends");
+        directives.add(include_dir, "include");
+        directives.add(library_dir, "library");
+        directives.add(endlibrary_dir, "endlibrary");
+        directives.add(tran_dir, "tran");
+        directives.add(save_dir, "save");
+        directives.add(simulator_dir, "simulator");
+        directives.add(unsupported_dir,
+                "ac alter analogmodel bsource check constants convergence cosim dcmatch designparamvals element "
+                "encryption envlp expressions finaltimeop functions global hb ibis ic if info keywords loadpull "
+                "memory montecarlo nodeset noise options outputparameter pac param_limits paramset pdisto pnoise "
+                "primitives psp pss pstb pxf pz qpac qpnoise qpsp qpss qpxf reliability rfmemory saveoptions "
+                "savestate sens set shell simulatoroptions smiconfig sp stb stitch subckts sweep tdr uti vector "
+                "veriloga xf");
+        directives.build();
+
         directive =
-            (
-             dc_dir | modelParameter_dir | section_dir | endsection_dir | model_dir | param_dir | subckt_dir |
-             ends_dir | include_dir | library_dir | endlibrary_dir | tran_dir | save_dir | simulator_dir |
-             unsupported_dir
-            )
+            directives.start.alias()
             ;
 
         dc_dir_type =
@@ -34,16 +34,16 @@ namespace ascii = boost::spirit::ascii;
 using namespace adm_boost_common;
 
 template <typename Iterator>
-struct tspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>()>
+struct tspice_parser : qi::grammar<Iterator, netlist_statement_list()>
 {
     //netlist statement objects
-    qi::rule<Iterator, std::vector<netlist_statement_object>()>
+    qi::rule<Iterator, netlist_statement_list()>
         bjt, capacitor, current_ctrl_current_src, current_ctrl_switch, current_ctrl_voltage_src, diode, inductor, resistor, indep_current_src,
         indep_voltage_src, jfet, mosfet, subcircuit, voltage_ctrl_current_src, voltage_ctrl_voltage_src, mesfet, lossy_trans_line, voltage_ctrl_resistor//, coupled_trans_line
             //devices that are different
             ;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()>
+    qi::rule<Iterator, netlist_statement_list()>
         acmodel_dir, alter_dir, assert_dir, checkpoint_dir, connect_dir, data_dir, enddata_dir, dellib_dir, global_dir, hdl_dir,
         if_dir, else_dir, elseif_dir, endif_dir, load_dir, malias_dir, optgoal_dir, optimize_dir, paramlimits_dir, power_dir, probe_dir,
         protect_dir, unprotect_dir, savebias_dir, temp_dir, tf_dir, vector_dir, warn_dir, gridsize_dir, table_dir, vrange_dir,
@@ -64,6 +64,16 @@ struct tspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_objec
 
     xyce_parser<iterator_type> base_parser;
 
+    // number of device and directive rules tried so far
+    std::size_t alternatives_attempted() const {
+        return base_parser.alternatives_attempted();
+    }
+
+    // turns the keyword dispatch of statement rules off or back on, to measure it
+    void set_statement_dispatch(bool enabled) {
+        base_parser.set_statement_dispatch(enabled);
+    }
+
     tspice_parser() : tspice_parser::base_type(tspice_start)
     {
         using qi::lit;
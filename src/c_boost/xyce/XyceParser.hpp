@@ -25,6 +25,7 @@
 #define BOOST_SPIRIT_XYCE
 
 #include "boost_adm_parser_common.h"
+#include "inline_comment_rules.hpp"
 
 namespace qi = boost::spirit::qi;
 namespace ascii = boost::spirit::ascii;
@@ -32,21 +33,21 @@ namespace ascii = boost::spirit::ascii;
 using namespace adm_boost_common;
 
 template <typename Iterator>
-struct xyce_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>()>
+struct xyce_parser : qi::grammar<Iterator, netlist_statement_list()>
 {
-    //friend struct pspice_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>()>;
+    //friend struct pspice_parser : qi::grammar<Iterator, netlist_statement_list()>;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> netlist_line, analog_device, directive, transient, transient_or_ac_dc, table, abm_expression, control_expression, value_expression, param_value_pair, measure_param_value_pair,
+    qi::rule<Iterator, netlist_statement_list()> netlist_line, analog_device, directive, transient, transient_or_ac_dc, table, abm_expression, control_expression, value_expression, param_value_pair, measure_param_value_pair,
         circuit_params, poly, pulse_trans, sin_trans, exp_trans, pwl_trans, sffm_trans,
         port_param_value_pair, port_param_double_value_pair, port_param_triple_value_pair, port_param_quad_value_pair, 
         port_param_quint_value_pair, port_param_sextuplet_value_pair,
         port_param_value_pair_last, port_param_double_value_pair_last, port_param_triple_value_pair_last, port_param_quad_value_pair_last, port_param_quint_value_pair_last, port_param_sextuplet_value_pair_last;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> bjt, capacitor, current_ctrl_current_src, current_ctrl_switch, current_ctrl_voltage_src, digital_dev, diode, inductor, port, resistor, indep_current_src,
+    qi::rule<Iterator, netlist_statement_list()> bjt, capacitor, current_ctrl_current_src, current_ctrl_switch, current_ctrl_voltage_src, digital_dev, diode, inductor, port, resistor, indep_current_src,
         indep_voltage_src, jfet, lossless_trans_line, mosfet, mututal_inductor, non_linear_dep_src, subcircuit, voltage_ctrl_current_src, voltage_ctrl_switch, voltage_ctrl_voltage_src, mesfet, lossy_trans_line,
         generic_switch;
 
-    qi::rule<Iterator, std::vector<netlist_statement_object>()> ac_dir, dc_dir, dcvolt_dir, end_dir, ends_dir, endl_dir, global_param_dir, global_dir, hb_dir, ic_dir, inc_dir, lib_dir, measure_dir, model_dir, nodeset_dir,
+    qi::rule<Iterator, netlist_statement_list()> ac_dir, dc_dir, dcvolt_dir, end_dir, ends_dir, endl_dir, global_param_dir, global_dir, hb_dir, ic_dir, inc_dir, lib_dir, measure_dir, model_dir, nodeset_dir,
         op_dir, options_dir, param_dir, preprocess_dir, print_dir, save_dir, sens_dir, step_dir, subckt_dir, tran_dir, four_dir, func_dir, mor_dir, mpde_dir, lin_dir;
 
     qi::rule<Iterator, netlist_statement_object()> AREA_VALUE, TRANSCONDUCTANCE_VALUE, COUPLING_VALUE, FUND_FREQ_VALUE, GAIN_VALUE,
@@ -76,6 +77,20 @@ struct xyce_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>
 
     qi::rule<Iterator> white_space;
 
+    // statement rules, tried by the keyword (or device letter) a line starts with
+    statement_dispatch<Iterator> devices, directives;
+
+    // number of device and directive rules tried so far
+    std::size_t alternatives_attempted() const {
+        return devices.attempted + directives.attempted;
+    }
+
+    // turns the keyword dispatch of statement rules off or back on, to measure it
+    void set_statement_dispatch(bool enabled) {
+        devices.enabled = enabled;
+        directives.enabled = enabled;
+    }
+
     xyce_parser() : xyce_parser::base_type(netlist_line)
     {
         using qi::lit;
@@ -138,9 +153,7 @@ struct xyce_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>
             hold[simple_v_output_expression]
             ;
 
-        inline_comment_str =
-            char_(";") >> *(char_);
-        ;
+        define_inline_comment_str(inline_comment_str, inline_comments::xyce());
 
         comment_str =
             //hold[char_("#") | char_("*")] >> *(char_); - This form breakes the Windows build for some reason - switched ot the below (Antonio consulted) - RRL 9/4/15
@@ -813,10 +826,42 @@ struct xyce_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>
 
         // DIRECTIVES ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+        // tried in this order, but only those matching the keyword the line starts with
+        directives.add(ac_dir, ".ac");
+        directives.add(dcvolt_dir, ".dcvolt");
+        directives.add(dc_dir, ".dc");
+        directives.add(ends_dir, ".ends");
+        directives.add(endl_dir, ".endl");
+        directives.add(end_dir, ".end");
+        directives.add(func_dir, ".func");
+        directives.add(global_param_dir, ".global_param");
+        directives.add(global_dir, ".global");
+        directives.add(hb_dir, ".hb");
+        directives.add(inc_dir, ".inc");
+        directives.add(ic_dir, ".ic .initcond");
+        directives.add(lib_dir, ".lib");
+        directives.add(lin_dir, ".lin");
+        directives.add(measure_dir, ".measure");
+        directives.add(model_dir, ".model");
+        directives.add(four_dir, ".four");
+        directives.add(nodeset_dir, ".nodeset");
+        directives.add(options_dir, ".options");
+        directives.add(op_dir, ".op");
+        directives.add(preprocess_dir, ".preprocess");
+        directives.add(print_dir, ".print");
+        directives.add(param_dir, ".param");
+        directives.add(save_dir, ".save");
+        directives.add(sens_dir, ".sens");
+        directives.add(step_dir, ".step");
+        directives.add(subckt_dir, ".subckt");
+        directives.add(tran_dir, ".tr");
+        directives.add(mor_dir, ".mor");
+        directives.add(mpde_dir, ".mpde");
+        directives.build();
+
         directive =
-            ac_dir | dcvolt_dir | dc_dir | ends_dir | endl_dir | end_dir | func_dir | global_param_dir | global_dir | hb_dir | inc_dir | ic_dir | lib_dir | lin_dir | measure_dir | model_dir |
-            four_dir | nodeset_dir | options_dir | op_dir | preprocess_dir | print_dir | param_dir | save_dir | sens_dir | step_dir | subckt_dir | tran_dir | mor_dir | mpde_dir;
-        ;
+            directives.start.alias()
+            ;
 
         ac_dir_type =
             qi::as_string[no_case[lit(".AC")]] [symbol_adder(_val, boost::spirit::_1, vector_of<data_model_type>(adm_boost_common::DIRECTIVE_TYPE))]
@@ -1081,8 +1126,35 @@ struct xyce_parser : qi::grammar<Iterator, std::vector<netlist_statement_object>
         // ANALOG DEVICES  ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+        // tried in this order, but only those matching the first letter(s) of the line
+        devices.add(bjt, "q");
+        devices.add(capacitor, "c");
+        devices.add(digital_dev, "y");
+        devices.add(diode, "d");
+        devices.add(generic_switch, "sw");
+        devices.add(current_ctrl_current_src, "f");
+        devices.add(current_ctrl_switch, "w");
+        devices.add(current_ctrl_voltage_src, "h");
+        devices.add(indep_current_src, "i");
+        devices.add(indep_voltage_src, "v");
+        devices.add(inductor, "l");
+        devices.add(jfet, "j");
+        devices.add(lossless_trans_line, "t");
+        devices.add(lossy_trans_line, "o");
+        devices.add(mesfet, "z");
+        devices.add(mosfet, "m");
+        devices.add(mututal_inductor, "k");
+        devices.add(non_linear_dep_src, "b");
+        devices.add(port, "p");
+        devices.add(resistor, "r");
+        devices.add(subcircuit, "x");
+        devices.add(voltage_ctrl_current_src, "g");
+        devices.add(voltage_ctrl_switch, "s");
+        devices.add(voltage_ctrl_voltage_src, "e");
+        devices.build();
+
         analog_device =
-            (bjt | capacitor | digital_dev | diode | generic_switch | current_ctrl_current_src | current_ctrl_switch | current_ctrl_voltage_src | indep_current_src | indep_voltage_src | inductor | jfet | lossless_trans_line | lossy_trans_line | mesfet | mosfet | mututal_inductor | non_linear_dep_src | port | resistor | subcircuit | voltage_ctrl_current_src | voltage_ctrl_switch | voltage_ctrl_voltage_src)
+            devices.start.alias()
             ;
 
         bjt_dev_type =
@@ -32,6 +32,19 @@
 #include <boost/spirit/include/phoenix_stl.hpp>
 #include <boost/spirit/include/phoenix_object.hpp>
 
+#include "spice_number.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <new>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 
@@ -73,11 +86,204 @@ static const char* data_model_type_strs[] = {"DEVICE_ID", "DEVICE_NAME", "DIRECT
     "STANDALONE_PARAM", "DATA_TABLE_NAME", "DATA_PARAM_NAME", "DATA_PARAM_VALUE"
 };
 
+// The candidate types of a token, most likely first. The grammars give a token at most a
+// few, so they are kept inline rather than in a vector of their own. (Not a bitset, since
+// the order matters: the first type is the one the readers go by.)
+class type_list {
+public:
+    static const std::size_t capacity = 6;
+
+    typedef data_model_type value_type;
+    typedef data_model_type * iterator;
+    typedef const data_model_type * const_iterator;
+
+    type_list() : count(0) {}
+
+    void push_back(data_model_type type) {
+        if(count == capacity)
+            throw std::length_error("too many candidate types for a token");
+        types[count++] = type;
+    }
+
+    void resize(std::size_t size) {
+        if(size > capacity)
+            throw std::length_error("too many candidate types for a token");
+        for(std::size_t i = count; i < size; i++)
+            types[i] = DEVICE_ID;
+        count = size;
+    }
+
+    void clear() { count = 0; }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    data_model_type & operator[](std::size_t i) { return types[i]; }
+    const data_model_type & operator[](std::size_t i) const { return types[i]; }
+
+    iterator begin() { return types; }
+    iterator end() { return types + count; }
+    const_iterator begin() const { return types; }
+    const_iterator end() const { return types + count; }
+
+private:
+    data_model_type types[capacity];
+    unsigned char count;
+};
+
+inline bool operator==(const type_list & a, const type_list & b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+inline bool operator!=(const type_list & a, const type_list & b) { return !(a == b); }
+
 struct netlist_statement_object {
-    std::vector<data_model_type> candidate_types;
+    type_list candidate_types;
     std::string value;
 };
 
+
+// Resettable monotonic arena for the temporaries of parsing a line. Spirit builds every
+// rule's list of tokens as it goes, and copies them between the lists of enclosing rules
+// and alternatives; from an arena these cost a pointer bump each instead of a malloc, and
+// are all given back at once when the line is done.
+//
+// Blocks are kept across resets, so once an arena has seen its largest line it does not
+// allocate again. Each parsing thread has its own (thread_arena()).
+class parse_arena {
+public:
+    explicit parse_arena(std::size_t block_size = 16384)
+        : block_size(block_size), block(0), used(0) {}
+
+    ~parse_arena() {
+        for(std::size_t i = 0; i < blocks.size(); i++)
+            ::operator delete(blocks[i].data);
+    }
+
+    void * allocate(std::size_t size, std::size_t alignment) {
+        while(block < blocks.size()) {
+            std::size_t start = (used + alignment - 1) & ~(alignment - 1);
+            if(start + size <= blocks[block].size) {
+                used = start + size;
+                return blocks[block].data + start;
+            }
+            block++;
+            used = 0;
+        }
+
+        // blocks come from operator new, so are aligned for any type
+        block_info b;
+        b.size = size > block_size ? size : block_size;
+        b.data = static_cast<char *>(::operator new(b.size));
+        blocks.push_back(b);
+        block = blocks.size() - 1;
+        used = size;
+        return b.data;
+    }
+
+    // Everything allocated so far is given back; the blocks stay for reuse
+    void reset() {
+        block = 0;
+        used = 0;
+    }
+
+    std::size_t num_blocks() const { return blocks.size(); }
+
+    // The arena that arena_allocators default to on this thread, or NULL for the heap
+    static parse_arena * current() { return current_ref(); }
+
+    static parse_arena & thread_arena() {
+        static thread_local parse_arena arena;
+        return arena;
+    }
+
+    // Makes an arena current on this thread for the lifetime of the scope, and resets it
+    // at the end. A scope nested in one for the same arena leaves the reset to the outer one.
+    class scope {
+    public:
+        explicit scope(parse_arena & arena = thread_arena())
+            : arena(arena), previous(current_ref()) {
+            current_ref() = &arena;
+        }
+
+        ~scope() {
+            current_ref() = previous;
+            if(previous != &arena)
+                arena.reset();
+        }
+
+    private:
+        scope(const scope &);
+        scope & operator=(const scope &);
+
+        parse_arena & arena;
+        parse_arena * previous;
+    };
+
+private:
+    parse_arena(const parse_arena &);
+    parse_arena & operator=(const parse_arena &);
+
+    static parse_arena *& current_ref() {
+        static thread_local parse_arena * arena = 0;
+        return arena;
+    }
+
+    struct block_info {
+        char * data;
+        std::size_t size;
+    };
+
+    std::size_t block_size;
+    std::vector<block_info> blocks;
+    std::size_t block;
+    std::size_t used;
+};
+
+// Allocates from the arena that was current on the thread when it was constructed, or from
+// the heap if there was none. Memory from an arena is never freed one piece at a time.
+template <typename T>
+struct arena_allocator {
+    typedef T value_type;
+
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    arena_allocator() : arena(parse_arena::current()) {}
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U> & other) : arena(other.arena) {}
+
+    T * allocate(std::size_t n) {
+        if(arena)
+            return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T * p, std::size_t) {
+        if(!arena)
+            ::operator delete(p);
+    }
+
+    parse_arena * arena;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T> & a, const arena_allocator<U> & b) { return a.arena == b.arena; }
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T> & a, const arena_allocator<U> & b) { return a.arena != b.arena; }
+
+// The tokens of a line (or of part of one) as the grammars build them
+typedef std::vector<netlist_statement_object, arena_allocator<netlist_statement_object> > netlist_statement_list;
+
+// Moves the tokens of a parsed line out of the arena, before it is reset
+inline void take_statements(netlist_statement_list & from, std::vector<netlist_statement_object> & to) {
+    to.assign(std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+    from.clear();
+}
+
 inline std::ostream& operator<< (std::ostream& os, const netlist_statement_object nso) {
     std::cout << "{" << nso.value << ", [";
 
@@ -131,6 +337,113 @@ boost::phoenix::function<symbol_adder_impl>(symbol_adder_impl());
 
 typedef std::string::const_iterator iterator_type;
 
+// Ordered alternative of statement rules (devices or directives) which only tries the
+// rules that can match the start of a line.
+//
+// Rules are added in the order the alternative would try them, each with the keywords
+// (matched without case) that it must start with; a rule added without keywords may
+// start with anything. A line is looked up by the longest keyword it starts with, and
+// only the rules having a keyword that is a prefix of it (plus those without keywords)
+// are tried, in the order they were added. The rules skipped would all fail on their
+// first token, so the result is the same as that of the full alternative.
+template <typename Iterator>
+struct statement_dispatch
+{
+    typedef boost::spirit::qi::rule<Iterator, netlist_statement_list()> rule_type;
+
+    // the rule to use in place of the ordered alternative, valid after build()
+    rule_type start;
+
+    // number of statement rules tried so far, to measure the effect of the dispatch
+    std::size_t attempted;
+
+    // if false, start tries every rule in order, like the plain alternative
+    bool enabled;
+
+    statement_dispatch() : attempted(0), enabled(true) {}
+
+    // keywords are separated by spaces
+    void add(rule_type & r, const std::string & keywords = "") {
+        std::vector<std::string> rule_keywords;
+        std::istringstream keyword_stream(keywords);
+        std::string keyword;
+
+        while(keyword_stream >> keyword) {
+            for(size_t i = 0; i < keyword.size(); i++)
+                keyword[i] = std::tolower(static_cast<unsigned char>(keyword[i]));
+            rule_keywords.push_back(keyword);
+            all_keywords.insert(keyword);
+        }
+
+        rules.push_back(std::make_pair(&r, rule_keywords));
+    }
+
+    void build() {
+        namespace qi = boost::spirit::qi;
+        namespace phx = boost::phoenix;
+        using qi::labels::_1;
+        using qi::labels::_a;
+
+        for(std::set<std::string>::const_iterator k = all_keywords.begin(); k != all_keywords.end(); ++k) {
+            std::vector<rule_type*> candidates;
+
+            for(size_t i = 0; i < rules.size(); i++) {
+                bool can_match = rules[i].second.empty();
+                for(size_t j = 0; j < rules[i].second.size() && !can_match; j++)
+                    can_match = k->compare(0, rules[i].second[j].size(), rules[i].second[j]) == 0;
+
+                if(can_match)
+                    candidates.push_back(rules[i].first);
+            }
+
+            keyword_rules.add(k->c_str(), chain(candidates));
+        }
+
+        std::vector<rule_type*> all, unkeyed;
+        for(size_t i = 0; i < rules.size(); i++) {
+            all.push_back(rules[i].first);
+            if(rules[i].second.empty())
+                unkeyed.push_back(rules[i].first);
+        }
+
+        rule_type * sequential = chain(all);
+        rule_type * unmatched = chain(unkeyed);
+
+        dispatched %= (&qi::ascii::no_case[keyword_rules[_a = _1]] | qi::eps[_a = unmatched]) >> qi::lazy(*_a);
+
+        start %= (qi::eps(phx::cref(enabled)) >> dispatched) | (!qi::eps(phx::cref(enabled)) >> *sequential);
+    }
+
+private:
+    // Builds an ordered alternative of the given rules, counting each rule tried.
+    rule_type * chain(const std::vector<rule_type*> & candidates) {
+        namespace qi = boost::spirit::qi;
+        namespace phx = boost::phoenix;
+
+        links.push_back(rule_type());
+        rule_type * next = &links.back();
+        *next = !qi::eps;
+
+        for(size_t i = candidates.size(); i > 0; i--) {
+            links.push_back(rule_type());
+            rule_type & link = links.back();
+            link %= (qi::eps[++phx::ref(attempted)] >> *candidates[i-1]) | *next;
+            next = &link;
+        }
+
+        return next;
+    }
+
+    std::vector<std::pair<rule_type*, std::vector<std::string> > > rules;
+    std::set<std::string> all_keywords;
+
+    boost::spirit::qi::symbols<char, rule_type*> keyword_rules;
+    boost::spirit::qi::rule<Iterator, netlist_statement_list(), boost::spirit::qi::locals<rule_type*> > dispatched;
+
+    // rules are referenced from other rules, so their addresses have to stay put
+    std::deque<rule_type> links;
+};
+
 }
 
 
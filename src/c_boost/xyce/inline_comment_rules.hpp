@@ -0,0 +1,84 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef INLINE_COMMENT_RULES_HPP
+#define INLINE_COMMENT_RULES_HPP
+
+
+#include <boost/spirit/include/qi.hpp>
+#include <string>
+
+
+// Where an inline comment can start in a dialect. Markers inside quotes or curly braces
+// never start a comment.
+struct InlineCommentRules {
+    // each of these characters starts an inline comment
+    std::string markers;
+    // "//" starts an inline comment
+    bool doubleSlash;
+    // markers only start a comment at the beginning of the line, or after white space
+    bool afterWhiteSpace;
+
+    InlineCommentRules(const std::string & markers = "", bool doubleSlash = false, bool afterWhiteSpace = false)
+        : markers(markers), doubleSlash(doubleSlash), afterWhiteSpace(afterWhiteSpace) {}
+};
+
+
+// The inline comments of each dialect. The inline_comment_str rule of each grammar is built
+// from its entry (see define_inline_comment_str), and NetlistLineReader strips comments from
+// continued lines with the same entry, so the two cannot disagree. The PSPICE and TSPICE
+// grammars read inline comments with the Xyce grammar's rule.
+namespace inline_comments {
+
+    // "$", "*" or "//", which (unlike in expressions and node names) are preceded by white space
+    inline InlineCommentRules hspice() { return InlineCommentRules("$*", true, true); }
+
+    inline InlineCommentRules xyce() { return InlineCommentRules(";"); }
+
+    inline InlineCommentRules pspice() { return xyce(); }
+
+    inline InlineCommentRules tspice() { return xyce(); }
+
+    inline InlineCommentRules spectre() { return InlineCommentRules("", true); }
+}
+
+
+// Defines rule, a rule with a std::string attribute, to match an inline comment of a dialect
+// from its marker to the end of the line. afterWhiteSpace is left to the rules that read the
+// comment, since they match the white space in front of it themselves.
+template <typename Rule>
+void define_inline_comment_str(Rule & rule, const InlineCommentRules & rules) {
+    using boost::spirit::qi::char_;
+    using boost::spirit::qi::hold;
+
+    if(rules.markers.empty()) {
+        rule = char_('/') >> char_('/') >> *(char_);
+    } else if(rules.doubleSlash) {
+        rule = hold[(char_(rules.markers) >> *(char_))] | hold[(char_('/') >> char_('/') >> *(char_))];
+    } else {
+        rule = char_(rules.markers) >> *(char_);
+    }
+}
+
+
+#endif
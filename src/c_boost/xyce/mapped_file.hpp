@@ -0,0 +1,48 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//   
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//  
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//   
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+
+#include <cstddef>
+#include <string>
+
+
+// Read-only memory mapping of an entire file. The mapping stays valid until close() is called.
+struct MappedFile {
+
+    const char * data = NULL;
+    size_t size = 0;
+
+    bool open(const std::string & filenm);
+
+    void close();
+};
+
+// Hash of the contents of a file, used to tell whether an on-disk cache built from the
+// file is still up to date. Not suitable for anything that needs to resist collisions.
+unsigned long long hash_contents(const char * data, size_t size);
+
+
+#endif
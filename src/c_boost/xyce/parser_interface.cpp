@@ -22,73 +22,1178 @@
 
 
 #include "parser_interface.hpp"
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <set>
+#include <sstream>
 
-std::string getLineNumsString (BoostParsedLine parsedLine) {
+#ifndef XDM_VERSION
+#define XDM_VERSION "unknown"
+#endif
+
+#ifndef XDM_BUILD_ID
+#define XDM_BUILD_ID "unknown"
+#endif
+
+// Part of the key of every on-disk entry. The tokens of a line depend on the grammar, which
+// can change without the version changing, so entries are only reused by the same build.
+static const char * const CACHE_BUILD_FINGERPRINT = XDM_VERSION " " XDM_BUILD_ID;
+
+std::string getLineNumsString (const std::vector<int> & linenums) {
     std::string lineNumsString = "[";
 
-    for (int i = 0; i < len(parsedLine.linenums); i++) {
-        // extracts the line number from the boost python list
-        std::string num = boost::python::extract<std::string>(
-                boost::python::object(parsedLine.linenums[i]).attr("__str__")())();
+    for (size_t i = 0; i < linenums.size(); i++) {
+        std::string num = std::to_string(linenums[i]);
+
         // add a comma if not the last element
-        if (i != len(parsedLine.linenums) - 1) {
+        if (i != linenums.size() - 1) {
             num += ",";
         }
+
         lineNumsString += num;
     }
+
     lineNumsString += "]";
     return lineNumsString ;
 }
 
-void convert_to_parsed_objects(std::vector<adm_boost_common::netlist_statement_object> netlist_parse_results, BoostParsedLine parsedLine) {
 
-    for(int i = 0; i < netlist_parse_results.size(); i++) {
+StringInterner &
+StringInterner::global() {
+    static StringInterner * interner = new StringInterner();
+    return *interner;
+}
+
+size_t
+StringInterner::Hash::operator()(boost::string_ref name) const {
+    // 64-bit FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < name.size(); i++) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+unsigned int
+StringInterner::intern(boost::string_ref name) {
+    std::lock_guard<std::mutex> lock(mutex);
 
-        boost::python::list typeList;
+    std::unordered_map<boost::string_ref, unsigned int, Hash>::const_iterator it = handles.find(name);
+    if(it != handles.end()) {
+        return it->second;
+    }
 
-        for(int j = 0; j < netlist_parse_results[i].candidate_types.size(); j++) {
-            typeList.append(netlist_parse_results[i].candidate_types[j]);
+    strings.push_back(std::string(name.begin(), name.end()));
+    unsigned int handle = strings.size() - 1;
+    handles.insert(std::make_pair(boost::string_ref(strings.back()), handle));
+    return handle;
+}
+
+const std::string &
+StringInterner::str(unsigned int handle) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings.at(handle);
+}
+
+boost::python::object
+StringInterner::py_str(unsigned int handle) {
+    if(handle >= py_strs.size()) {
+        py_strs.resize(size());
+    }
+
+    boost::python::object & cached = py_strs.at(handle);
+    if(cached.is_none()) {
+        const std::string & name = str(handle);
+        PyObject * py_name = PyUnicode_FromStringAndSize(name.data(), name.size());
+        if(py_name == NULL) {
+            boost::python::throw_error_already_set();
         }
+        PyUnicode_InternInPlace(&py_name);
+        cached = boost::python::object(boost::python::handle<>(py_name));
+    }
+    return cached;
+}
+
+size_t
+StringInterner::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings.size();
+}
+
+
+bool is_name_type(adm_boost_common::data_model_type type) {
+    using namespace adm_boost_common;
+
+    switch(type) {
+        case DEVICE_ID: case DEVICE_NAME: case DIRECTIVE_TYPE: case MODEL_NAME: case MODEL_TYPE:
+        case PARAM_NAME: case DEFAULT_PARAM_NAME: case FUNCTION_NAME: case TRANS_REF_NAME:
+        case VBIC_MODEL_NAME: case CONTROL_DEVICE_NAME: case LIB_ENTRY: case DATA_TABLE_NAME:
+        case DATA_PARAM_NAME: case MEASURE_PARAM_NAME:
+        case POSNODE: case NEGNODE: case GENERALNODE: case DRAINNODE: case GATENODE: case SOURCENODE:
+        case ANODE: case POSCONTROLNODE: case NEGCONTROLNODE: case COLLECTORNODE: case BASENODE:
+        case EMITTERNODE: case COLLECTORPRIMENODE: case BASEPRIMENODE: case EMITTERPRIMENODE:
+        case POSSWITCHNODE: case NEGSWITCHNODE: case APORTPOSNODE: case APORTNEGNODE: case BPORTPOSNODE:
+        case BPORTNEGNODE: case SUBSTRATENODE: case TEMPERATURENODE: case LOWOUTPUTNODE: case HIGHOUTPUTNODE:
+        case INPUTREFERENCENODE: case INPUTNODE: case OUTPUTNODE: case ACCELERATIONNODE: case VELOCITYNODE:
+        case POSITIONNODE: case THERMALNODE: case EXTERNALBODYCONTACTNODE: case INTERNALBODYCONTACTNODE:
+        case UNKNOWN_NODE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+void convert_to_parsed_objects(const std::vector<adm_boost_common::netlist_statement_object> & netlist_parse_results,
+        BoostParsedLine & parsedLine) {
+
+    StringInterner & interner = StringInterner::global();
+
+    for(size_t i = 0; i < netlist_parse_results.size(); i++) {
+        const adm_boost_common::netlist_statement_object & token = netlist_parse_results[i];
 
         ParseObject obj;
-        obj.value = netlist_parse_results[i].value;
-        obj.types = typeList;
+        bool name = false;
+
+        for(size_t j = 0; j < token.candidate_types.size(); j++) {
+            obj.types.append(token.candidate_types[j]);
+            name = name || is_name_type(token.candidate_types[j]);
+        }
+
+        if(name) {
+            unsigned int handle = interner.intern(token.value);
+            obj.value = interner.py_str(handle);
+            obj.nameId = handle;
+        } else {
+            obj.value = boost::python::object(token.value);
+        }
 
         parsedLine.parsedObjects.append(obj);
     }
 }
 
 
+BoostParsedLine to_boost_parsed_line(const NetlistLine & line, const std::string & filename) {
+
+    BoostParsedLine parsedLine;
+    parsedLine.filename = filename;
+    parsedLine.sourceLine = line.sourceLine;
+    parsedLine.errorType = line.errorType;
+    parsedLine.errorMessage = line.errorMessage;
+
+    for(size_t i = 0; i < line.linenums.size(); i++) {
+        parsedLine.linenums.append(line.linenums[i]);
+    }
+
+    convert_to_parsed_objects(line.parsedObjects, parsedLine);
+
+    return parsedLine;
+}
+
+
+boost::python::list to_boost_parsed_lines(const std::vector<NetlistLine> & lines, const std::string & filename) {
+
+    boost::python::list parsedLines;
+
+    for(size_t i = 0; i < lines.size(); i++) {
+        parsedLines.append(to_boost_parsed_line(lines[i], filename));
+    }
+
+    return parsedLines;
+}
+
+
+// Copies a column into a bytes object, and returns a memoryview of it with the given struct format.
+// The memoryview keeps the bytes object alive, so the column is independent of the batch.
+template <typename T>
+static boost::python::object make_column(const std::vector<T> & column, const char * format) {
+
+    boost::python::object bytes(boost::python::handle<>(PyBytes_FromStringAndSize(
+                    reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T))));
+    boost::python::object view(boost::python::handle<>(PyMemoryView_FromObject(bytes.ptr())));
+
+    return view.attr("cast")(format);
+}
+
+
+ParsedLineBatch to_parsed_line_batch(const std::vector<NetlistLine> & lines, const std::string & filename) {
+
+    std::vector<char> values, sourceLines;
+    std::vector<unsigned short> typeCodes;
+    std::vector<int> nameIds, linenums;
+    StringInterner & interner = StringInterner::global();
+    std::vector<long long> valueOffsets(1, 0), typeOffsets(1, 0), tokenOffsets(1, 0), linenumOffsets(1, 0),
+        sourceLineOffsets(1, 0);
+
+    ParsedLineBatch batch;
+    batch.filename = filename;
+    batch.numLines = lines.size();
+
+    for(size_t i = 0; i < lines.size(); i++) {
+        const NetlistLine & line = lines[i];
+
+        for(size_t j = 0; j < line.parsedObjects.size(); j++) {
+            const adm_boost_common::netlist_statement_object & token = line.parsedObjects[j];
+
+            values.insert(values.end(), token.value.begin(), token.value.end());
+            valueOffsets.push_back(values.size());
+
+            typeCodes.insert(typeCodes.end(), token.candidate_types.begin(), token.candidate_types.end());
+            typeOffsets.push_back(typeCodes.size());
+
+            bool name = std::any_of(token.candidate_types.begin(), token.candidate_types.end(), is_name_type);
+            nameIds.push_back(name ? static_cast<int>(interner.intern(token.value)) : -1);
+        }
+        tokenOffsets.push_back(valueOffsets.size() - 1);
+
+        linenums.insert(linenums.end(), line.linenums.begin(), line.linenums.end());
+        linenumOffsets.push_back(linenums.size());
+
+        sourceLines.insert(sourceLines.end(), line.sourceLine.begin(), line.sourceLine.end());
+        sourceLineOffsets.push_back(sourceLines.size());
+
+        batch.errorTypes.append(line.errorType);
+        batch.errorMessages.append(line.errorMessage);
+    }
+
+    batch.numTokens = valueOffsets.size() - 1;
+    batch.values = make_column(values, "B");
+    batch.valueOffsets = make_column(valueOffsets, "q");
+    batch.typeCodes = make_column(typeCodes, "H");
+    batch.typeOffsets = make_column(typeOffsets, "q");
+    batch.nameIds = make_column(nameIds, "i");
+    batch.tokenOffsets = make_column(tokenOffsets, "q");
+    batch.linenums = make_column(linenums, "i");
+    batch.linenumOffsets = make_column(linenumOffsets, "q");
+    batch.sourceLines = make_column(sourceLines, "B");
+    batch.sourceLineOffsets = make_column(sourceLineOffsets, "q");
+
+    return batch;
+}
+
+
+size_t findInlineComment(boost::string_ref line, const InlineCommentRules & rules) {
+
+    char quote = 0;
+    int braceDepth = 0;
+
+    for(size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+
+        if(quote != 0) {
+            if(c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if(c == '\'' || c == '"') {
+            quote = c;
+        } else if(c == '{') {
+            braceDepth++;
+        } else if(c == '}') {
+            if(braceDepth > 0) {
+                braceDepth--;
+            }
+        } else if(braceDepth == 0) {
+            if(rules.afterWhiteSpace && i > 0 && line[i-1] != ' ' && line[i-1] != '\t') {
+                continue;
+            }
+
+            if(rules.markers.find(c) != std::string::npos) {
+                return i;
+            }
+
+            if(rules.doubleSlash && c == '/' && i + 1 < line.size() && line[i+1] == '/') {
+                return i;
+            }
+        }
+    }
+
+    return std::string::npos;
+}
+
+
+std::string stripInlineCommentString(const std::string & line, const InlineCommentRules & rules) {
+    return line.substr(0, findInlineComment(line, rules));
+}
+
+
+static inline bool is_classic_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+
 bool
-NetlistLineReader::open(std::string filenm) {
+NetlistLineReader::open(std::string filenm, bool use_memory_map) {
     filename = filenm;
-    inputStream = new std::ifstream(filename.c_str(), std::ifstream::in );
 
-    tmp_line = "";
+    tmp_line.clear();
     title = "";
     current_line_num = 0;
 
+    map_pos = 0;
+    map_eof = false;
+    skipped_sections.clear();
+    next_skipped = 0;
+    memory_mapped = use_memory_map && mappedFile.open(filename);
+    if(memory_mapped) {
+        return true;
+    }
+
+    inputStream = new std::ifstream(filename.c_str(), std::ifstream::in );
+
     return inputStream->good();
 }
 
 void
 NetlistLineReader::close() {
+    tmp_line.clear();
+
+    if(memory_mapped) {
+        mappedFile.close();
+        memory_mapped = false;
+        return;
+    }
+
     //if(inputStream->good()) {
-    inputStream->close();
-    inputStream->clear();
-    delete inputStream;
+    if(inputStream != NULL) {
+        inputStream->close();
+        inputStream->clear();
+        delete inputStream;
+        inputStream = NULL;
+    }
     //}
 }
 
+bool
+NetlistLineReader::good() const {
+    // std::getline only sets failbit together with eofbit here, so good() is simply !eof()
+    if(memory_mapped) {
+        return !map_eof;
+    }
+    return inputStream->good();
+}
+
+bool
+NetlistLineReader::eof() const {
+    if(memory_mapped) {
+        return map_eof;
+    }
+    return inputStream->eof();
+}
+
+boost::string_ref
+NetlistLineReader::read_line() {
+    const char * begin;
+    const char * end;
+
+    if(memory_mapped) {
+        // Same semantics as std::getline: eof is only reached when a line is not
+        // terminated by a newline, or there is nothing left to read.
+        while(next_skipped < skipped_sections.size() && map_pos == skipped_sections[next_skipped].begin) {
+            const LibrarySection & skipped = skipped_sections[next_skipped++];
+            map_pos = skipped.end;
+            current_line_num += skipped.last_line - skipped.first_line + 1;
+        }
+
+        begin = mappedFile.data + map_pos;
+        end = mappedFile.data + mappedFile.size;
+        const char * newline = static_cast<const char *>(memchr(begin, '\n', end - begin));
+        if(newline != NULL) {
+            end = newline;
+            map_pos = newline - mappedFile.data + 1;
+        } else {
+            map_pos = mappedFile.size;
+            map_eof = true;
+        }
+    } else {
+        getline(*inputStream, line_buffer);
+        begin = line_buffer.data();
+        end = begin + line_buffer.size();
+    }
+
+    // equivalent to boost::trim in the classic locale, without modifying the underlying buffer
+    while(begin != end && is_classic_space(*begin)) {
+        ++begin;
+    }
+    while(begin != end && is_classic_space(*(end - 1))) {
+        --end;
+    }
+
+    return boost::string_ref(begin, end - begin);
+}
+
+
+// Bumped whenever the layout of a cache entry, or the tokens of a cached line, change.
+// 2: numbers in .DATA keep their leading minus sign
+static const unsigned int PARSED_LINE_CACHE_FORMAT = 2;
+static const char PARSED_LINE_CACHE_MAGIC[8] = {'X', 'D', 'M', 'L', 'I', 'N', 'E', 'S'};
+
+template <typename T>
+static void write_value(std::string & out, T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void write_string(std::string & out, const std::string & value) {
+    write_value<unsigned int>(out, value.size());
+    out.append(value);
+}
+
+// Reads from a cache entry, failing (rather than reading past the end) on a truncated entry
+struct CacheEntryReader {
+    const std::string & data;
+    size_t pos = 0;
+
+    explicit CacheEntryReader(const std::string & data) : data(data) {}
+
+    template <typename T>
+    bool read_value(T & value) {
+        if(data.size() - pos < sizeof(T)) {
+            return false;
+        }
+        memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool read_string(std::string & value) {
+        unsigned int size;
+        if(!read_value(size) || data.size() - pos < size) {
+            return false;
+        }
+        value.assign(data, pos, size);
+        pos += size;
+        return true;
+    }
+};
+
+static bool read_cache_entry(const std::string & data, const std::string & key, unsigned long long content_size,
+        std::vector<NetlistLine> & lines) {
+
+    CacheEntryReader in(data);
+
+    char magic[sizeof(PARSED_LINE_CACHE_MAGIC)];
+    for(size_t i = 0; i < sizeof(magic); i++) {
+        if(!in.read_value(magic[i]) || magic[i] != PARSED_LINE_CACHE_MAGIC[i]) {
+            return false;
+        }
+    }
+
+    // the file name only holds the content hash, so the size and the rest of the key are checked too
+    unsigned int format;
+    std::string entry_key;
+    unsigned long long entry_content_size;
+    unsigned int num_lines;
+    if(!in.read_value(format) || format != PARSED_LINE_CACHE_FORMAT ||
+       !in.read_string(entry_key) || entry_key != key ||
+       !in.read_value(entry_content_size) || entry_content_size != content_size ||
+       !in.read_value(num_lines)) {
+        return false;
+    }
+
+    lines.resize(num_lines);
+    for(size_t i = 0; i < lines.size(); i++) {
+        NetlistLine & line = lines[i];
+
+        unsigned int num_objects;
+        if(!in.read_value(num_objects)) {
+            return false;
+        }
+        line.parsedObjects.resize(num_objects);
+        for(size_t j = 0; j < line.parsedObjects.size(); j++) {
+            adm_boost_common::netlist_statement_object & object = line.parsedObjects[j];
+
+            unsigned short num_types;
+            if(!in.read_string(object.value) || !in.read_value(num_types) ||
+                    num_types > adm_boost_common::type_list::capacity) {
+                return false;
+            }
+            object.candidate_types.resize(num_types);
+            for(size_t k = 0; k < object.candidate_types.size(); k++) {
+                unsigned short type;
+                if(!in.read_value(type)) {
+                    return false;
+                }
+                object.candidate_types[k] = static_cast<adm_boost_common::data_model_type>(type);
+            }
+        }
+
+        unsigned int num_linenums;
+        if(!in.read_value(num_linenums)) {
+            return false;
+        }
+        line.linenums.resize(num_linenums);
+        for(size_t j = 0; j < line.linenums.size(); j++) {
+            if(!in.read_value(line.linenums[j])) {
+                return false;
+            }
+        }
+
+        if(!in.read_string(line.sourceLine) || !in.read_string(line.errorType) || !in.read_string(line.errorMessage)) {
+            return false;
+        }
+    }
+
+    return in.pos == data.size();
+}
+
+// Writes everything of a cache entry up to its lines, and returns the offset of the number
+// of lines, which is only known once the last line has been written.
+static size_t write_cache_header(std::string & out, const std::string & key, unsigned long long content_size) {
+    out.append(PARSED_LINE_CACHE_MAGIC, sizeof(PARSED_LINE_CACHE_MAGIC));
+    write_value(out, PARSED_LINE_CACHE_FORMAT);
+    write_string(out, key);
+    write_value(out, content_size);
+
+    size_t num_lines_pos = out.size();
+    write_value<unsigned int>(out, 0);
+    return num_lines_pos;
+}
+
+static void write_cache_line(std::string & out, const NetlistLine & line) {
+    write_value<unsigned int>(out, line.parsedObjects.size());
+    for(size_t j = 0; j < line.parsedObjects.size(); j++) {
+        const adm_boost_common::netlist_statement_object & object = line.parsedObjects[j];
+
+        write_string(out, object.value);
+        write_value<unsigned short>(out, object.candidate_types.size());
+        for(size_t k = 0; k < object.candidate_types.size(); k++) {
+            write_value<unsigned short>(out, object.candidate_types[k]);
+        }
+    }
+
+    write_value<unsigned int>(out, line.linenums.size());
+    for(size_t j = 0; j < line.linenums.size(); j++) {
+        write_value(out, line.linenums[j]);
+    }
+
+    write_string(out, line.sourceLine);
+    write_string(out, line.errorType);
+    write_string(out, line.errorMessage);
+}
+
+// Cache files are written under a unique name and then renamed, so that another process
+// reading the same entry never sees it half written; owner (any address) tells apart the
+// entries written by the threads of this process.
+static std::string temporary_cache_path(const std::string & path, const void * owner) {
+    std::ostringstream tmp_path;
+    tmp_path << path << "." << std::chrono::steady_clock::now().time_since_epoch().count()
+             << "." << reinterpret_cast<size_t>(owner) << ".tmp";
+    return tmp_path.str();
+}
+
+static void rename_cache_file(const std::string & tmp_path, const std::string & path) {
+    if(std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        // e.g. on Windows, when another process stored the same entry first
+        std::remove(tmp_path.c_str());
+    }
+}
+
+// Writes a whole cache entry to path, see temporary_cache_path()
+static void write_cache_file(const std::string & path, const std::string & data, const void * owner) {
+    std::string tmp_path = temporary_cache_path(path, owner);
+
+    {
+        std::ofstream entry(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!entry.good()) {
+            return;
+        }
+        entry.write(data.data(), data.size());
+        if(!entry.good()) {
+            entry.close();
+            std::remove(tmp_path.c_str());
+            return;
+        }
+    }
+
+    rename_cache_file(tmp_path, path);
+}
+
+
+bool
+ParsedLineCache::open(const NetlistLineReader & reader, const std::string & dialect, bool top_level_file) {
+    close();
+
+    if(directory.empty() || !reader.memory_mapped) {
+        return false;
+    }
+
+    key = dialect + (top_level_file ? " top " : " include ") + CACHE_BUILD_FINGERPRINT;
+    content_size = reader.mappedFile.size;
+    content_hash = hash_contents(reader.mappedFile.data, reader.mappedFile.size);
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", content_hash);
+    path = directory + "/" + name + "." + dialect + (top_level_file ? ".top" : ".inc");
+
+    // the lines of a library file read without some of its sections are a different entry
+    if(!reader.skipped_sections.empty()) {
+        std::string skipped;
+        for(size_t i = 0; i < reader.skipped_sections.size(); i++) {
+            skipped += " " + reader.skipped_sections[i].name;
+        }
+        key += " skipping" + skipped;
+
+        char sections_name[17];
+        snprintf(sections_name, sizeof(sections_name), "%016llx", hash_contents(skipped.data(), skipped.size()));
+        path = path + "." + sections_name;
+    }
+    path += ".xdmcache";
+
+    std::ifstream entry(path.c_str(), std::ios::in | std::ios::binary);
+    if(entry.good()) {
+        std::string data((std::istreambuf_iterator<char>(entry)), std::istreambuf_iterator<char>());
+        if(read_cache_entry(data, key, content_size, cached_lines)) {
+            replaying = true;
+            return true;
+        }
+        cached_lines.clear();
+    }
+
+    // the lines are streamed to disk as they are read, so a large file is never held in memory
+    record_path = temporary_cache_path(path, this);
+    record_file.reset(new std::ofstream(record_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc));
+    if(!record_file->good()) {
+        record_file.reset();
+        return false;
+    }
+    num_lines_pos = write_cache_header(record_buffer, key, content_size);
+    num_recorded = 0;
+
+    recording = true;
+    return false;
+}
+
+void
+ParsedLineCache::close() {
+    if(record_file) {
+        // the file was not read to the end
+        record_file.reset();
+        std::remove(record_path.c_str());
+    }
+
+    replaying = false;
+    recording = false;
+    replay_pos = 0;
+    cached_lines.clear();
+    record_buffer.clear();
+}
+
+void
+ParsedLineCache::replay(std::vector<NetlistLine> && lines) {
+    close();
+    cached_lines = std::move(lines);
+    replaying = true;
+}
+
+// Lines are written out in chunks of about this size
+static const size_t RECORD_BUFFER_SIZE = 1 << 16;
+
+void
+ParsedLineCache::record(const NetlistLine & line) {
+    write_cache_line(record_buffer, line);
+    num_recorded++;
+
+    if(record_buffer.size() >= RECORD_BUFFER_SIZE) {
+        record_file->write(record_buffer.data(), record_buffer.size());
+        record_buffer.clear();
+        if(!record_file->good()) {
+            close();
+        }
+    }
+}
+
+void
+ParsedLineCache::store() {
+    record_file->write(record_buffer.data(), record_buffer.size());
+
+    std::string num_lines;
+    write_value<unsigned int>(num_lines, num_recorded);
+    record_file->seekp(num_lines_pos);
+    record_file->write(num_lines.data(), num_lines.size());
+    record_file->close();
+
+    if(record_file->good()) {
+        record_file.reset();
+        rename_cache_file(record_path, path);
+    }
+    close();
+}
+
+
+// Bumped whenever the layout of a library section index entry changes
+static const unsigned int LIBRARY_INDEX_FORMAT = 1;
+static const char LIBRARY_INDEX_MAGIC[8] = {'X', 'D', 'M', 'L', 'I', 'B', 'I', 'X'};
+
+static bool read_library_index(const std::string & data, const std::string & key, unsigned long long content_size,
+        bool & valid, std::vector<LibrarySection> & sections) {
+
+    CacheEntryReader in(data);
+
+    char magic[sizeof(LIBRARY_INDEX_MAGIC)];
+    for(size_t i = 0; i < sizeof(magic); i++) {
+        if(!in.read_value(magic[i]) || magic[i] != LIBRARY_INDEX_MAGIC[i]) {
+            return false;
+        }
+    }
+
+    unsigned int format;
+    std::string entry_key;
+    unsigned long long entry_content_size;
+    unsigned char entry_valid;
+    unsigned int num_sections;
+    if(!in.read_value(format) || format != LIBRARY_INDEX_FORMAT ||
+       !in.read_string(entry_key) || entry_key != key ||
+       !in.read_value(entry_content_size) || entry_content_size != content_size ||
+       !in.read_value(entry_valid) || !in.read_value(num_sections)) {
+        return false;
+    }
+    valid = entry_valid != 0;
+
+    sections.resize(num_sections);
+    for(size_t i = 0; i < sections.size(); i++) {
+        LibrarySection & section = sections[i];
+
+        unsigned long long begin, end;
+        unsigned int num_reads;
+        if(!in.read_string(section.name) || !in.read_value(begin) || !in.read_value(end) ||
+           !in.read_value(section.first_line) || !in.read_value(section.last_line) ||
+           !in.read_value(num_reads) || begin > end || end > content_size) {
+            return false;
+        }
+        section.begin = begin;
+        section.end = end;
+
+        section.reads.resize(num_reads);
+        for(size_t j = 0; j < section.reads.size(); j++) {
+            if(!in.read_string(section.reads[j])) {
+                return false;
+            }
+        }
+    }
+
+    return in.pos == data.size();
+}
+
+static std::string write_library_index(const std::string & key, unsigned long long content_size,
+        bool valid, const std::vector<LibrarySection> & sections) {
+
+    std::string out;
+    out.append(LIBRARY_INDEX_MAGIC, sizeof(LIBRARY_INDEX_MAGIC));
+    write_value(out, LIBRARY_INDEX_FORMAT);
+    write_string(out, key);
+    write_value(out, content_size);
+    write_value<unsigned char>(out, valid ? 1 : 0);
+    write_value<unsigned int>(out, sections.size());
+
+    for(size_t i = 0; i < sections.size(); i++) {
+        const LibrarySection & section = sections[i];
+
+        write_string(out, section.name);
+        write_value<unsigned long long>(out, section.begin);
+        write_value<unsigned long long>(out, section.end);
+        write_value(out, section.first_line);
+        write_value(out, section.last_line);
+        write_value<unsigned int>(out, section.reads.size());
+        for(size_t j = 0; j < section.reads.size(); j++) {
+            write_string(out, section.reads[j]);
+        }
+    }
+
+    return out;
+}
+
+// The words of a statement, with quoted words (which keep their quotes) taken whole, and
+// without its inline comment
+static std::vector<std::string> statement_words(boost::string_ref line, const InlineCommentRules & rules) {
+    line = line.substr(0, findInlineComment(line, rules));
+
+    std::vector<std::string> words;
+    size_t i = 0;
+    while(i < line.size()) {
+        if(is_classic_space(line[i])) {
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        char quote = 0;
+        while(i < line.size() && (quote != 0 || !is_classic_space(line[i]))) {
+            if(quote != 0) {
+                if(line[i] == quote) {
+                    quote = 0;
+                }
+            } else if(line[i] == '\'' || line[i] == '"') {
+                quote = line[i];
+            }
+            i++;
+        }
+        words.push_back(line.substr(start, i - start).to_string());
+    }
+
+    return words;
+}
+
+static bool is_quoted(const std::string & word) {
+    return !word.empty() && (word[0] == '\'' || word[0] == '"');
+}
+
+bool
+LibrarySectionIndex::build(const char * data, size_t size, const InlineCommentRules & rules) {
+    sections.clear();
+
+    bool in_section = false;
+    bool well_formed = true;
+    size_t pos = 0;
+    int line_num = 0;
+
+    // physical lines are split up the same way as by NetlistLineReader::read_line(), so the
+    // line numbers match
+    while(pos < size && well_formed) {
+        size_t begin = pos;
+        const char * newline = static_cast<const char *>(memchr(data + pos, '\n', size - pos));
+        size_t end = newline != NULL ? newline - data : size;
+        pos = newline != NULL ? end + 1 : size;
+        line_num++;
+
+        size_t first = begin;
+        while(first != end && is_classic_space(data[first])) {
+            first++;
+        }
+        if(first == end || data[first] != '.') {
+            continue;
+        }
+
+        std::vector<std::string> words = statement_words(boost::string_ref(data + first, end - first), rules);
+        std::string keyword = boost::to_upper_copy(words[0]);
+
+        if(keyword == ".LIB") {
+            if(words.size() == 2 && !is_quoted(words[1])) {
+                // ".lib name" starts a section
+                if(in_section) {
+                    well_formed = false;
+                }
+                LibrarySection section;
+                section.name = words[1];
+                section.begin = begin;
+                section.first_line = line_num;
+                sections.push_back(section);
+                in_section = true;
+            } else if(words.size() == 3) {
+                // ".lib file name" reads a section, of this file or another one
+                if(in_section) {
+                    sections.back().reads.push_back(words[2]);
+                }
+            } else {
+                well_formed = false;
+            }
+        } else if(keyword == ".ENDL") {
+            if(!in_section) {
+                well_formed = false;
+                continue;
+            }
+            sections.back().end = pos;
+            sections.back().last_line = line_num;
+            in_section = false;
+        }
+    }
+
+    if(in_section || !well_formed) {
+        sections.clear();
+        return false;
+    }
+    return true;
+}
+
+bool
+LibrarySectionIndex::load_or_build(const MappedFile & file, const InlineCommentRules & rules, const std::string & dialect,
+        const std::string & cache_dir) {
+
+    if(cache_dir.empty()) {
+        return build(file.data, file.size, rules);
+    }
+
+    // comments are found by the rules of the dialect, so they are part of the key
+    std::string key = dialect + " " + CACHE_BUILD_FINGERPRINT;
+    unsigned long long content_size = file.size;
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", hash_contents(file.data, file.size));
+    std::string path = cache_dir + "/" + name + "." + dialect + ".lib.xdmcache";
+
+    std::ifstream entry(path.c_str(), std::ios::in | std::ios::binary);
+    if(entry.good()) {
+        std::string data((std::istreambuf_iterator<char>(entry)), std::istreambuf_iterator<char>());
+        bool valid;
+        if(read_library_index(data, key, content_size, valid, sections)) {
+            return valid;
+        }
+        sections.clear();
+    }
+
+    bool valid = build(file.data, file.size, rules);
+    write_cache_file(path, write_library_index(key, content_size, valid, sections), this);
+    return valid;
+}
+
+std::vector<LibrarySection>
+LibrarySectionIndex::unused(const std::vector<std::string> & keep) const {
+    std::set<std::string> used;
+    std::vector<std::string> pending;
+    for(size_t i = 0; i < keep.size(); i++) {
+        std::string name = boost::to_upper_copy(keep[i]);
+        if(used.insert(name).second) {
+            pending.push_back(name);
+        }
+    }
+
+    // a section read from another file is kept as well if this file has one of that name,
+    // which at worst reads a section that is not needed
+    while(!pending.empty()) {
+        std::string name = pending.back();
+        pending.pop_back();
+
+        for(size_t i = 0; i < sections.size(); i++) {
+            if(boost::to_upper_copy(sections[i].name) != name) {
+                continue;
+            }
+            for(size_t j = 0; j < sections[i].reads.size(); j++) {
+                std::string read = boost::to_upper_copy(sections[i].reads[j]);
+                if(used.insert(read).second) {
+                    pending.push_back(read);
+                }
+            }
+        }
+    }
+
+    std::vector<LibrarySection> result;
+    for(size_t i = 0; i < sections.size(); i++) {
+        if(used.count(boost::to_upper_copy(sections[i].name)) == 0) {
+            result.push_back(sections[i]);
+        }
+    }
+    return result;
+}
+
+void
+NetlistLineReader::skip_library_sections(const std::vector<std::string> & keep, const std::string & dialect,
+        const std::string & cache_dir) {
+    skipped_sections.clear();
+    next_skipped = 0;
+
+    if(!memory_mapped || map_pos != 0) {
+        return;
+    }
+
+    LibrarySectionIndex index;
+    if(index.load_or_build(mappedFile, commentRules, dialect, cache_dir)) {
+        skipped_sections = index.unused(keep);
+    }
+}
+
+
+std::vector<std::string> to_string_vector(const boost::python::list & strings) {
+    std::vector<std::string> result;
+    for(boost::python::ssize_t i = 0; i < boost::python::len(strings); i++) {
+        result.push_back(boost::python::extract<std::string>(strings[i]));
+    }
+    return result;
+}
+
+// Each pool thread reads up to this many files ahead of the ones that have been taken
+static const size_t FILES_READ_AHEAD_PER_THREAD = 2;
+
+NetlistPrefetcher::~NetlistPrefetcher() {
+    shutdown();
+}
+
+int
+NetlistPrefetcher::prefetch(const std::vector<std::string> & filenames, bool top_level_file, int num_threads,
+                            const std::string & cache_dir) {
+    if(num_threads <= 0) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    int batch = next_batch++;
+    for(size_t i = 0; i < filenames.size(); i++) {
+        std::shared_ptr<Entry> & entry = entries[key(filenames[i], top_level_file)];
+        if(entry) {
+            entry->batches.push_back(batch);
+            continue;
+        }
+
+        entry.reset(new Entry);
+        entry->filename = filenames[i];
+        entry->top_level_file = top_level_file;
+        entry->cache_dir = cache_dir;
+        entry->batches.push_back(batch);
+        work.push_back(entry);
+    }
+
+    max_read_ahead = std::max(max_read_ahead, FILES_READ_AHEAD_PER_THREAD * num_threads);
+    while(static_cast<int>(threads.size()) < num_threads) {
+        threads.push_back(std::thread(&NetlistPrefetcher::read_files, this));
+    }
+    work_ready.notify_all();
+    return batch;
+}
+
+bool
+NetlistPrefetcher::take(const std::string & filename, bool top_level_file, std::vector<NetlistLine> & lines) {
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, std::shared_ptr<Entry> >::iterator it = entries.find(key(filename, top_level_file));
+        if(it == entries.end()) {
+            return false;
+        }
+        entry = it->second;
+
+        // files are opened depth first, so the request is that of the most recent batch
+        entry->batches.pop_back();
+        if(!entry->started) {
+            // the pool is busy with files further ahead, so waiting for it could take longer
+            // than reading the file, or never end
+            if(entry->batches.empty()) {
+                drop(it);
+                work_ready.notify_all();
+            }
+            return false;
+        }
+        entry->num_takers++;
+    }
+
+    {
+        // the lock goes before the GIL is taken back
+        ScopedGILRelease release;
+        std::unique_lock<std::mutex> lock(mutex);
+        file_ready.wait(lock, [&entry] { return entry->done; });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // the last request gets the lines themselves, the others a copy
+    if(--entry->num_takers == 0 && entry->batches.empty()) {
+        std::map<std::string, std::shared_ptr<Entry> >::iterator it = entries.find(key(filename, top_level_file));
+        if(it != entries.end() && it->second == entry) {
+            drop(it);
+            work_ready.notify_all();
+        }
+        lines = std::move(entry->lines);
+    } else {
+        lines = entry->lines;
+    }
+
+    return entry->usable;
+}
+
+void
+NetlistPrefetcher::release(int batch) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::map<std::string, std::shared_ptr<Entry> >::iterator it = entries.begin();
+    while(it != entries.end()) {
+        std::vector<int> & batches = it->second->batches;
+        batches.erase(std::remove(batches.begin(), batches.end(), batch), batches.end());
+        if(batches.empty() && it->second->num_takers == 0) {
+            drop(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    work_ready.notify_all();
+}
+
+void
+NetlistPrefetcher::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        entries.clear();
+        work.clear();
+    }
+    work_ready.notify_all();
+
+    for(size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    threads.clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    max_read_ahead = 0;
+    stopping = false;
+}
+
+void
+NetlistPrefetcher::drop(std::map<std::string, std::shared_ptr<Entry> >::iterator it) {
+    if(!it->second->started) {
+        work.erase(std::find(work.begin(), work.end(), it->second));
+    }
+    entries.erase(it);
+}
+
+size_t
+NetlistPrefetcher::num_read_ahead() const {
+    size_t n = 0;
+    for(std::map<std::string, std::shared_ptr<Entry> >::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if(it->second->started) {
+            n++;
+        }
+    }
+    return n;
+}
+
+void
+NetlistPrefetcher::read_files() {
+    while(true) {
+        std::shared_ptr<Entry> entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [this] { return stopping || (!work.empty() && num_read_ahead() < max_read_ahead); });
+            if(stopping) {
+                return;
+            }
+            entry = work.front();
+            entry->started = true;
+            work.pop_front();
+        }
+
+        std::vector<NetlistLine> lines;
+        bool usable = false;
+        try {
+            usable = read(entry->filename, entry->top_level_file, entry->cache_dir, lines);
+        } catch(...) {
+            // opening the file again on the main thread reports the problem
+            lines.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entry->lines = std::move(lines);
+            entry->usable = usable;
+            entry->done = true;
+        }
+        file_ready.notify_all();
+    }
+}
+
 
 BOOST_PYTHON_MODULE(SpiritCommon)
 {
     boost::python::class_<ParseObject>("ParseObject")
         .def_readonly("value", &ParseObject::value)
         .def_readonly("types", &ParseObject::types)
+        .def_readonly("name_id", &ParseObject::nameId)
         ;
 
     boost::python::class_<BoostParsedLine>("BoostParsedLine")
@@ -100,6 +1205,24 @@ BOOST_PYTHON_MODULE(SpiritCommon)
         .def_readonly("error_message", &BoostParsedLine::errorMessage)
         ;
 
+    boost::python::class_<ParsedLineBatch>("ParsedLineBatch")
+        .def_readonly("filename", &ParsedLineBatch::filename)
+        .def_readonly("num_lines", &ParsedLineBatch::numLines)
+        .def_readonly("num_tokens", &ParsedLineBatch::numTokens)
+        .def_readonly("values", &ParsedLineBatch::values)
+        .def_readonly("value_offsets", &ParsedLineBatch::valueOffsets)
+        .def_readonly("type_codes", &ParsedLineBatch::typeCodes)
+        .def_readonly("type_offsets", &ParsedLineBatch::typeOffsets)
+        .def_readonly("name_ids", &ParsedLineBatch::nameIds)
+        .def_readonly("token_offsets", &ParsedLineBatch::tokenOffsets)
+        .def_readonly("linenums", &ParsedLineBatch::linenums)
+        .def_readonly("linenum_offsets", &ParsedLineBatch::linenumOffsets)
+        .def_readonly("sourcelines", &ParsedLineBatch::sourceLines)
+        .def_readonly("sourceline_offsets", &ParsedLineBatch::sourceLineOffsets)
+        .def_readonly("error_types", &ParsedLineBatch::errorTypes)
+        .def_readonly("error_messages", &ParsedLineBatch::errorMessages)
+        ;
+
     boost::python::enum_<adm_boost_common::data_model_type>("data_model_type")
         .value("DEVICE_TYPE", adm_boost_common::DEVICE_ID)
         .value("DEVICE_NAME", adm_boost_common::DEVICE_NAME)
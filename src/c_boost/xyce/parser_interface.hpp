@@ -27,8 +27,21 @@
 
 #include <boost/python.hpp>
 #include "boost_adm_parser_common.h"
+#include "inline_comment_rules.hpp"
+#include "mapped_file.hpp"
+#include "scoped_gil_release.hpp"
 #include <boost/algorithm/string.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <queue>
 #include <fstream>
@@ -54,123 +67,257 @@ struct BoostParsedLine {
 
 
 struct ParseObject {
-    std::string value;
+    // a str; the same object for every occurrence of an interned name
+    boost::python::object value;
     boost::python::list types;
+
+    // handle of the value in StringInterner::global(), or -1 if it is not a name
+    int nameId = -1;
 };
 
 
-// Takes in a parsed line object and returns the associated line numbers from the original
-// file as a string (e.g. "[45,46,47]")
-std::string getLineNumsString (BoostParsedLine parsedLine);
+// Keeps one copy of each distinct node, model, device and parameter name behind a compact
+// handle, so a net like VDD that appears on millions of lines is stored once. Handles are
+// given out in order from 0 and stay valid for the life of the process.
+//
+// intern() and str() may be called from any thread. py_str() needs the GIL, and returns the
+// same Python str for a handle every time; it is also interned with the interpreter, so equal
+// names from different parsers compare by identity.
+class StringInterner {
 
-// Identifies if an inline comment is present based on grammar, 
-// returns the line with the inline comment stripped from it
-template <typename Grammar>
-std::string stripInlineCommentString(std::string line, Grammar const&g) {
-    std::string::const_iterator start = line.begin();
-    std::string::const_iterator end = line.end();
-    std::string currentInlineComment = "";
-    std::string inlineCommentIdentifier = "INLINE_COMMENT";
-    std::vector<std::string> results;
-    std::string rtnLine;
-    std::vector<adm_boost_common::netlist_statement_object> netlist_parse_results;
-
-    bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
-    for(int i = 0; i < netlist_parse_results.size(); i++) {
-        std::string dataModelType = adm_boost_common::getDataModelTypeStr(netlist_parse_results[i]);
-
-        if (dataModelType == inlineCommentIdentifier){
-            currentInlineComment = netlist_parse_results[i].value;
-        }
-     }
+    public:
 
-    rtnLine = line;
-    if (currentInlineComment != ""){
-        boost::iter_split(results, line, boost::algorithm::first_finder(currentInlineComment));
-        rtnLine = results[0];
-    }
+    // Shared by the parsers of the module. Never destroyed, since it holds Python objects
+    // that must not be released after the interpreter has shut down.
+    static StringInterner & global();
 
-    return rtnLine;
-}
+    unsigned int intern(boost::string_ref name);
+
+    const std::string & str(unsigned int handle) const;
+
+    boost::python::object py_str(unsigned int handle);
+
+    size_t size() const;
+
+    private:
+
+    struct Hash {
+        size_t operator()(boost::string_ref name) const;
+    };
+
+    mutable std::mutex mutex;
+
+    // a deque, so the keys of handles (which point into it) never move
+    std::deque<std::string> strings;
+    std::unordered_map<boost::string_ref, unsigned int, Hash> handles;
+
+    // filled in lazily, and only touched with the GIL held
+    std::vector<boost::python::object> py_strs;
+};
+
+// Whether tokens of this type are names that repeat across lines (nodes, models, devices,
+// parameters), and so are worth interning. Values and expressions are mostly unique.
+bool is_name_type(adm_boost_common::data_model_type type);
+
+
+// Struct-of-arrays form of a batch of BoostParsedLines. Every column is a flat, read-only
+// memoryview, so a batch costs a handful of Python objects instead of several per token.
+//
+// Token i of the batch has the UTF-8 value values[valueOffsets[i]:valueOffsets[i+1]] and the
+// candidate types typeCodes[typeOffsets[i]:typeOffsets[i+1]] (data_model_type values), and
+// nameIds[i] is its StringInterner handle (-1 if it is not a name, see ParseObject). Line j
+// owns tokens tokenOffsets[j] up to tokenOffsets[j+1], line numbers
+// linenums[linenumOffsets[j]:linenumOffsets[j+1]], and the source line
+// sourceLines[sourceLineOffsets[j]:sourceLineOffsets[j+1]].
+struct ParsedLineBatch {
+    std::string filename;
+    int numLines = 0;
+    int numTokens = 0;
+
+    boost::python::object values;            // 'B'
+    boost::python::object valueOffsets;      // 'q', numTokens + 1 entries
+    boost::python::object typeCodes;         // 'H'
+    boost::python::object typeOffsets;       // 'q', numTokens + 1 entries
+    boost::python::object nameIds;           // 'i', numTokens entries
+    boost::python::object tokenOffsets;      // 'q', numLines + 1 entries
+    boost::python::object linenums;          // 'i'
+    boost::python::object linenumOffsets;    // 'q', numLines + 1 entries
+    boost::python::object sourceLines;       // 'B'
+    boost::python::object sourceLineOffsets; // 'q', numLines + 1 entries
+
+    // almost always empty, so these stay as plain lists of str
+    boost::python::list errorTypes;
+    boost::python::list errorMessages;
+};
+
+
+// C++ counterpart of BoostParsedLine. It holds no Python objects, so lines can be read
+// and parsed without holding the GIL, and only converted once they are handed to Python.
+struct NetlistLine {
+    std::vector<adm_boost_common::netlist_statement_object> parsedObjects;
+    std::vector<int> linenums;
+    std::string sourceLine;
+    std::string errorType;
+    std::string errorMessage;
+};
+
+
+// Takes in the line numbers of a parsed line and returns them as a string (e.g. "[45,46,47]")
+std::string getLineNumsString (const std::vector<int> & linenums);
+
+// Returns the position of the inline comment in line, or std::string::npos if there is none
+size_t findInlineComment(boost::string_ref line, const InlineCommentRules & rules);
+
+// Returns the line with the inline comment (if any) stripped from it. This is a single
+// lexical pass over the line, so no parse is needed to find the comment.
+std::string stripInlineCommentString(const std::string & line, const InlineCommentRules & rules);
+
+// A section of a library file, from its ".lib name" line to its ".endl" line
+struct LibrarySection {
+    std::string name;
+    // byte offsets of the start of the .lib line, and of the line after the .endl line
+    size_t begin = 0;
+    size_t end = 0;
+    // line numbers of the .lib and .endl lines
+    int first_line = 0;
+    int last_line = 0;
+    // the sections read by ".lib file name" statements inside this one
+    std::vector<std::string> reads;
+};
+
+// Where the .lib/.endl sections of a library file are. The index is built by a lexical scan
+// of the physical lines of the file, which only looks at lines starting with ".lib" or
+// ".endl", so the sections a netlist does not use can be skipped without being parsed.
+struct LibrarySectionIndex {
+
+    std::vector<LibrarySection> sections;
+
+    // Scans size bytes of data. Returns false and leaves the index empty if the sections are
+    // not well formed (nested, unterminated, an .endl outside a section, or a .lib statement
+    // split across lines), in which case the whole file has to be read.
+    bool build(const char * data, size_t size, const InlineCommentRules & rules);
+
+    // Same as build() for a memory mapped file, but kept on disk in cache_dir (if not empty)
+    // under the hash of the contents of the file and the name of the dialect.
+    bool load_or_build(const MappedFile & file, const InlineCommentRules & rules, const std::string & dialect,
+                       const std::string & cache_dir);
+
+    // The sections that are neither in keep, nor read by a section in keep (directly or
+    // through other sections). Section names are not case sensitive.
+    std::vector<LibrarySection> unused(const std::vector<std::string> & keep) const;
+};
 
 struct NetlistLineReader {
 
-    std::ifstream * inputStream;
+    std::ifstream * inputStream = NULL;
     std::string filename;
     std::string title;
 
-    std::string tmp_line;
+    // Physical lines are views into either the memory mapped file, or (when the file
+    // could not be mapped) into line_buffer, which holds the last line read from inputStream.
+    // tmp_line is only ever the most recently read physical line, so it remains valid
+    // until the next call to read_line().
+    bool memory_mapped = false;
+    MappedFile mappedFile;
+    size_t map_pos = 0;
+    bool map_eof = false;
+    std::string line_buffer;
+
+    boost::string_ref tmp_line;
     int current_line_num;
 
-    std::queue<BoostParsedLine> lines;
+    // Library sections of the memory mapped file that read_line() steps over, in file order
+    std::vector<LibrarySection> skipped_sections;
+    size_t next_skipped = 0;
+
+    std::queue<NetlistLine> lines;
 
-    bool open(std::string filenm);
+    // Inline comments have to be stripped when continuation lines are joined, otherwise
+    // they would swallow everything after them. Set by the parser for each dialect, from
+    // the same entry of inline_comments as its grammar.
+    InlineCommentRules commentRules;
+
+    // By default the file is memory mapped, and logical lines are only copied out of the
+    // mapping when continuation lines need to be stitched together. Falls back to
+    // std::ifstream if the file cannot be mapped (e.g. it is empty).
+    bool open(std::string filenm, bool use_memory_map = true);
 
     void close();
 
-    template <typename Grammar>
-    void read_next_parsable_line(Grammar const& g) {
+    // These mirror std::ifstream::good() and eof() after std::getline(), for either mode.
+    bool good() const;
+
+    bool eof() const;
+
+    // Returns the next physical line, with leading and trailing whitespace removed.
+    boost::string_ref read_line();
+
+    // Skips the .lib sections of the file just opened that keep does not need (see
+    // LibrarySectionIndex::unused), with the index of the file cached in cache_dir if it is
+    // not empty. Line numbers are still those of the file. Only memory mapped files are
+    // indexed; any other file is read in full.
+    void skip_library_sections(const std::vector<std::string> & keep, const std::string & dialect,
+                               const std::string & cache_dir);
+
+    void read_next_parsable_line() {
     
-        BoostParsedLine parsedLine;
-        parsedLine.filename = filename;
+        NetlistLine parsedLine;
         std::string currentRtnLine, nextRtnLine;
     
-        if(!inputStream->good()) {
-            if(tmp_line != "") {
-                parsedLine.sourceLine = tmp_line;
-                parsedLine.linenums.append(current_line_num);
+        if(!good()) {
+            if(!tmp_line.empty()) {
+                parsedLine.sourceLine = tmp_line.to_string();
+                parsedLine.linenums.push_back(current_line_num);
                 lines.push(parsedLine);
             }
-            tmp_line = "";
+            tmp_line.clear();
             return;
         }
     
-        std::string line_next = "";
+        boost::string_ref line_next;
     
-        if(tmp_line == "") {
+        if(tmp_line.empty()) {
             //find start of next parsable line
-            while(line_next == "" && !inputStream->eof()) {
-                getline(*inputStream, line_next);
-                boost::trim(line_next);
+            while(line_next.empty() && !eof()) {
+                line_next = read_line();
                 current_line_num++;
             }
         } else {
             line_next = tmp_line;
-            tmp_line = "";
+            tmp_line.clear();
         }
     
-        parsedLine.sourceLine = line_next;
-        parsedLine.linenums.append(current_line_num);
+        parsedLine.sourceLine = line_next.to_string();
+        parsedLine.linenums.push_back(current_line_num);
 
         bool foundEnd = false;
         std::string origCommandLine = "";
-        std::string tmpOrigCommandLine = stripInlineCommentString(parsedLine.sourceLine, g);
+        std::string tmpOrigCommandLine = stripInlineCommentString(parsedLine.sourceLine, commentRules);
         std::string tmpCommandLine;
         std::vector<std::string> results;
 
-        while(!foundEnd && !inputStream->eof()) {
+        while(!foundEnd && !eof()) {
     
-            getline(*inputStream, line_next);
-            boost::trim(line_next);
+            line_next = read_line();
             current_line_num++;
     
             tmp_line = line_next;
     
-            if(line_next == "") continue;
+            if(line_next.empty()) continue;
 
             if(boost::starts_with(line_next, "*") || boost::starts_with(line_next, "//") || boost::starts_with(line_next, "$")) {
-                BoostParsedLine commentLine;
-                commentLine.filename = filename;
-                commentLine.sourceLine = line_next;
-                commentLine.linenums.append(current_line_num);
+                NetlistLine commentLine;
+                commentLine.sourceLine = line_next.to_string();
+                commentLine.linenums.push_back(current_line_num);
                 lines.push(commentLine);
-                tmp_line = "";
+                tmp_line.clear();
             }
             // For case of dangling parentheses in .MODEL statements, allowable in HSPICE/PSPICE
             else if(boost::starts_with(line_next, ")")) {
-                currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, g);
+                currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, commentRules);
                 boost::trim_right(currentRtnLine);
-                parsedLine.sourceLine = currentRtnLine + " " + line_next;
+                parsedLine.sourceLine = currentRtnLine + " ";
+                parsedLine.sourceLine.append(line_next.data(), line_next.size());
             }
             // only considers "+" as line continuation if current line doesn't end with a "\\" line continuation
             // Need to save original, first portion of the line with the command statement (.PARAM for instance)
@@ -180,23 +327,23 @@ struct NetlistLineReader {
             else if(boost::starts_with(line_next, "+") && !boost::ends_with(parsedLine.sourceLine, "\\")) {
                 if (origCommandLine == "") {
                     origCommandLine = tmpOrigCommandLine;
-                    currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, g);
+                    currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, commentRules);
                     boost::trim_right(currentRtnLine);
-                    parsedLine.sourceLine = currentRtnLine + " " + line_next.substr(1);
-                    currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, g);
+                    parsedLine.sourceLine = currentRtnLine + " " + line_next.substr(1).to_string();
+                    currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, commentRules);
                     boost::trim_right(currentRtnLine);
                     parsedLine.sourceLine = currentRtnLine;
                 }
                 else {
-                    tmpCommandLine = origCommandLine + " " + line_next.substr(1);
-                    currentRtnLine = stripInlineCommentString(tmpCommandLine, g);
+                    tmpCommandLine = origCommandLine + " " + line_next.substr(1).to_string();
+                    currentRtnLine = stripInlineCommentString(tmpCommandLine, commentRules);
                     boost::trim_right(currentRtnLine);
                     boost::iter_split(results, currentRtnLine, boost::algorithm::first_finder(origCommandLine));
-                    parsedLine.sourceLine = parsedLine.sourceLine + " " + results[1];
+                    parsedLine.sourceLine.append(" ").append(results[1]);
                 }
                 boost::trim_right(parsedLine.sourceLine);
-                parsedLine.linenums.append(current_line_num);
-                tmp_line = "";
+                parsedLine.linenums.push_back(current_line_num);
+                tmp_line.clear();
             }
             // must check case of "\\" continuation first in order to avoid going into "\" block mistakenly
             // inline comments cannot occur after in-expression continuation character "\\" in HSPICE. So only need
@@ -205,14 +352,13 @@ struct NetlistLineReader {
                 // need to trim "\\" line continuation characters
                 parsedLine.sourceLine.pop_back();
                 parsedLine.sourceLine.pop_back();
-                boost::trim(line_next);
                 // current line and next line need to be joined with no spaces
-                parsedLine.sourceLine = parsedLine.sourceLine + line_next;
+                parsedLine.sourceLine.append(line_next.data(), line_next.size());
                 if (origCommandLine == "") {
                     tmpOrigCommandLine = parsedLine.sourceLine;
                 } 
                 boost::trim_right(parsedLine.sourceLine);
-                parsedLine.linenums.append(current_line_num);
+                parsedLine.linenums.push_back(current_line_num);
             }
             // Block to check for line continuation using "\" character.
             // Same as in two blocks above: need to save original, first portion of the line with 
@@ -222,34 +368,31 @@ struct NetlistLineReader {
             // then the current line is just appended to the original portion for inline comment checking purposes.
             else {
                 if (origCommandLine == "") {
-                    currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, g);
+                    currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, commentRules);
                     boost::trim_right(currentRtnLine);
                 }
-                else {
-                    currentRtnLine = parsedLine.sourceLine;
-                }
+                // once continued, the line has no comments left in it, so it is checked in place
+                const std::string & lineSoFar = origCommandLine == "" ? currentRtnLine : parsedLine.sourceLine;
 
-                if (boost::ends_with(currentRtnLine, R"delim(\)delim")) {
+                if (boost::ends_with(lineSoFar, R"delim(\)delim")) {
                     if (origCommandLine == "") {
                         origCommandLine = tmpOrigCommandLine;
                         currentRtnLine.pop_back();
-                        boost::trim(line_next);
-                        parsedLine.sourceLine = currentRtnLine + " " + line_next;
-                        currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, g);
+                        parsedLine.sourceLine = currentRtnLine + " " + line_next.to_string();
+                        currentRtnLine = stripInlineCommentString(parsedLine.sourceLine, commentRules);
                         boost::trim_right(currentRtnLine);
                         parsedLine.sourceLine = currentRtnLine;
                     }
                     else {
                         parsedLine.sourceLine.pop_back();
-                        boost::trim(line_next);
-                        tmpCommandLine = origCommandLine + " " + line_next;
-                        currentRtnLine = stripInlineCommentString(tmpCommandLine, g);
+                        tmpCommandLine = origCommandLine + " " + line_next.to_string();
+                        currentRtnLine = stripInlineCommentString(tmpCommandLine, commentRules);
                         boost::trim_right(currentRtnLine);
                         boost::iter_split(results, currentRtnLine, boost::algorithm::first_finder(origCommandLine));
-                        parsedLine.sourceLine = parsedLine.sourceLine + " " + results[1];
+                        parsedLine.sourceLine.append(" ").append(results[1]);
                     }
                     boost::trim_right(parsedLine.sourceLine);
-                    parsedLine.linenums.append(current_line_num);
+                    parsedLine.linenums.push_back(current_line_num);
                 }
                 else {
                     foundEnd = true;
@@ -260,17 +403,15 @@ struct NetlistLineReader {
         lines.push(parsedLine);
     }
 
-    template <typename Grammar>
-    bool hasNext(Grammar const& g) {
-        read_next_parsable_line(g);
+    bool hasNext() {
+        read_next_parsable_line();
         return lines.size() > 0;
     }
 
 
-    template <typename Grammar>
-    BoostParsedLine next(Grammar const& g){
-        read_next_parsable_line(g);
-        BoostParsedLine rtn = lines.front();
+    NetlistLine next(){
+        read_next_parsable_line();
+        NetlistLine rtn = lines.front();
         lines.pop();
         return rtn;
     }
@@ -278,11 +419,399 @@ struct NetlistLineReader {
 };
 
 
+// Opt-in cache of the parsed lines of netlist files, kept on disk across runs. A file is
+// looked up by a hash of its contents, so an unchanged file (under any name) is replayed
+// without being read or parsed again. Entries also depend on the dialect, on whether the
+// file is the top level one (its title line is handled differently), and on the build of XDM
+// (its version and commit), since the tokens of a line change along with the grammar.
+//
+// Entries are written in a compact native-endian binary format, so a cache directory should
+// not be shared between machines of different architectures. Corrupt or mismatched entries
+// are ignored. The lines of a file are written to a temporary file as they are read, which
+// only becomes the entry once the file has been read to the end.
+class ParsedLineCache {
+
+    public:
+
+    // Entries are read from and written to directory, which must already exist.
+    // An empty directory (the default) disables the cache.
+    void set_directory(const std::string & dir) { directory = dir; }
+
+    const std::string & get_directory() const { return directory; }
+
+    // Called once the reader has opened a file. Returns true if the file is in the cache,
+    // in which case its lines are replayed by next() and the reader does not have to be used.
+    // Otherwise the lines returned by next() are recorded, to be stored at the end of the file.
+    // Only memory mapped files are cached, since the whole file has to be hashed up front.
+    bool open(const NetlistLineReader & reader, const std::string & dialect, bool top_level_file);
+
+    // Stops replaying or recording. Lines recorded so far are dropped, along with their temporary file.
+    void close();
+
+    // Returns the next line of a cached file. For any other file, reads the line with
+    // read_line (a callable with the signature of next()) and records it if needed.
+    template <typename ReadLine>
+    bool next(NetlistLine & line, ReadLine read_line) {
+        if(replaying) {
+            if(replay_pos == cached_lines.size()) {
+                return false;
+            }
+            line = std::move(cached_lines[replay_pos++]);
+            return true;
+        }
+
+        bool more = read_line(line);
+
+        if(recording) {
+            if(more) {
+                record(line);
+            } else {
+                store();
+            }
+        }
+
+        return more;
+    }
+
+    // Lines carried state into or out of the file, so it must not be cached.
+    void discard() { close(); }
+
+    // Replays lines that were read ahead of time (see NetlistPrefetcher) instead of a file,
+    // as if they had been found in the cache.
+    void replay(std::vector<NetlistLine> && lines);
+
+    private:
+
+    void record(const NetlistLine & line);
+
+    void store();
+
+    std::string directory;
+    std::string path;
+    std::string key;
+    unsigned long long content_hash = 0;
+    unsigned long long content_size = 0;
+
+    bool replaying = false;
+    bool recording = false;
+    size_t replay_pos = 0;
+    std::vector<NetlistLine> cached_lines;
+
+    // while recording: the temporary file, the lines not yet written to it, and where the
+    // number of lines goes once it is known. A shared_ptr, since streams cannot be copied.
+    std::shared_ptr<std::ofstream> record_file;
+    std::string record_path;
+    std::string record_buffer;
+    size_t num_lines_pos = 0;
+    unsigned int num_recorded = 0;
+};
+
+
+// Parses a netlist in three stages. A reader thread splits the file into logical lines,
+// which has to happen in order since continuation and comment handling depend on the
+// preceding lines. A pool of worker threads then parses those lines, each worker with its
+// own grammar instance, and next() hands the results back in source order.
+//
+// The reader is owned by the pipeline from construction until the pipeline is destroyed.
+template <typename Grammar>
+class NetlistParsePipeline {
+
+    public:
+
+    // Called on the reader thread, in source order, for any handling that carries state
+    // from one line to the next. Returns true if the line is complete and should not be parsed.
+    typedef std::function<bool (NetlistLine &, Grammar const&)> prepare_function;
+
+    // Called on a worker thread, so it must not modify any state shared between lines.
+    typedef std::function<void (NetlistLine &, Grammar const&)> parse_function;
+
+    NetlistParsePipeline(NetlistLineReader & reader, int num_workers, prepare_function prepare, parse_function parse)
+        : reader(reader), prepare(prepare), parse(parse),
+          max_lines_in_flight(1024 * num_workers) {
+        splitter = std::thread(&NetlistParsePipeline::split_lines, this);
+        for(int i = 0; i < num_workers; i++) {
+            workers.push_back(std::thread(&NetlistParsePipeline::parse_lines, this));
+        }
+    }
+
+    ~NetlistParsePipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        space_ready.notify_all();
+
+        splitter.join();
+        for(size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    // Blocks until the next line in source order has been parsed. Returns false once the
+    // whole file has been returned, and rethrows anything thrown by the reader or a worker.
+    bool next(NetlistLine & line) {
+        std::unique_lock<std::mutex> lock(mutex);
+        result_ready.wait(lock, [this] {
+            return error || results.count(next_index) > 0 || (split_done && next_index == num_split);
+        });
+
+        if(error) {
+            std::rethrow_exception(error);
+        }
+
+        typename std::map<size_t, NetlistLine>::iterator result = results.find(next_index);
+        if(result == results.end()) {
+            return false;
+        }
+
+        line = std::move(result->second);
+        results.erase(result);
+        next_index++;
+        space_ready.notify_one();
+        return true;
+    }
+
+    private:
+
+    struct WorkItem {
+        size_t index;
+        NetlistLine line;
+    };
+
+    void split_lines() {
+        try {
+            // only needed by prepare, which most dialects do not have, and expensive to construct
+            std::unique_ptr<Grammar> g;
+            if(prepare) {
+                g.reset(new Grammar());
+            }
+            while(reader.hasNext()) {
+                WorkItem item;
+                item.line = reader.next();
+                bool complete = prepare && prepare(item.line, *g);
+
+                // bounds the number of lines held in memory when Python falls behind
+                std::unique_lock<std::mutex> lock(mutex);
+                space_ready.wait(lock, [this] {
+                    return stopping || num_split - next_index < max_lines_in_flight;
+                });
+                if(stopping) {
+                    break;
+                }
+
+                item.index = num_split++;
+                if(complete) {
+                    results[item.index] = std::move(item.line);
+                    result_ready.notify_one();
+                } else {
+                    work.push_back(std::move(item));
+                    work_ready.notify_one();
+                }
+            }
+        } catch(...) {
+            set_error(std::current_exception());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        split_done = true;
+        work_ready.notify_all();
+        result_ready.notify_one();
+    }
+
+    void parse_lines() {
+        try {
+            Grammar g;
+            while(true) {
+                WorkItem item;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    work_ready.wait(lock, [this] {
+                        return stopping || !work.empty() || split_done;
+                    });
+                    if(stopping || work.empty()) {
+                        return;
+                    }
+                    item = std::move(work.front());
+                    work.pop_front();
+                }
+
+                parse(item.line, g);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                results[item.index] = std::move(item.line);
+                result_ready.notify_one();
+            }
+        } catch(...) {
+            set_error(std::current_exception());
+        }
+    }
+
+    void set_error(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!error) {
+            error = e;
+        }
+        result_ready.notify_one();
+    }
+
+    NetlistLineReader & reader;
+    prepare_function prepare;
+    parse_function parse;
+    const size_t max_lines_in_flight;
+
+    std::thread splitter;
+    std::vector<std::thread> workers;
+
+    // everything below is guarded by mutex
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable result_ready;
+    std::condition_variable space_ready;
+    std::deque<WorkItem> work;
+    std::map<size_t, NetlistLine> results;
+    size_t num_split = 0;
+    size_t next_index = 0;
+    bool split_done = false;
+    bool stopping = false;
+    std::exception_ptr error;
+};
+
+
+// Reads whole netlist files ahead of time on a pool of threads, and keeps their lines until
+// a parser opens the file. The .include and .lib files of a netlist are all known once the
+// netlist has been read, so they can be parsed together, and reading a deck then takes about
+// as long as its largest file instead of the sum of its files. Python still opens and reads
+// the files one after another, in the same order as without prefetching, so the result
+// does not depend on which file happens to be parsed first.
+//
+// The pool only reads a few files ahead of the ones that have been taken, to bound the
+// number of parsed files held in memory. Files are queued in batches, and whatever is left
+// of a batch is dropped by release() once the reader that queued it is done.
+//
+// There is one prefetcher per dialect, each with its own pool.
+class NetlistPrefetcher {
+
+    public:
+
+    // Called on a pool thread to read the whole of a file into lines, as opening and reading
+    // it would, with the on-disk cache in cache_dir (if not empty). Returns false if the
+    // lines cannot stand in for opening the file, for instance because it does not exist.
+    typedef std::function<bool (const std::string & filename, bool top_level_file, const std::string & cache_dir,
+                                std::vector<NetlistLine> & lines)> read_function;
+
+    explicit NetlistPrefetcher(read_function read) : read(read) {}
+
+    ~NetlistPrefetcher();
+
+    // Queues the files to be read on up to num_threads threads, and returns the number of the
+    // batch, for release(). A file queued more than once is read once, and can be taken as
+    // many times as it was queued. Does nothing (and returns -1) if num_threads is 0.
+    int prefetch(const std::vector<std::string> & filenames, bool top_level_file, int num_threads,
+                 const std::string & cache_dir);
+
+    // If the file was queued, waits for it to be read, without holding the GIL, and returns
+    // true with its lines. Returns false if it was not queued, could not be read, or has not
+    // been started yet, in which case it is dropped and the caller reads it instead.
+    bool take(const std::string & filename, bool top_level_file, std::vector<NetlistLine> & lines);
+
+    // Drops the files of a batch that have not been taken, whether they have been read or not.
+    void release(int batch);
+
+    // Drops every file and stops the pool, once the files being read have been finished.
+    // The pool is started again by the next prefetch().
+    void shutdown();
+
+    private:
+
+    struct Entry {
+        std::string filename;
+        bool top_level_file;
+        std::string cache_dir;
+        // the batch of each request not taken yet
+        std::vector<int> batches;
+        // the number of take() calls waiting for the file
+        int num_takers = 0;
+        bool started = false;
+        bool done = false;
+        bool usable = false;
+        std::vector<NetlistLine> lines;
+    };
+
+    static std::string key(const std::string & filename, bool top_level_file) {
+        return (top_level_file ? "top " : "include ") + filename;
+    }
+
+    // Removes the entry from the map and the queue. Its lines are freed by whoever holds it last.
+    void drop(std::map<std::string, std::shared_ptr<Entry> >::iterator it);
+
+    // The number of files started but not taken. Needs the lock.
+    size_t num_read_ahead() const;
+
+    void read_files();
+
+    read_function read;
+    std::vector<std::thread> threads;
+
+    // everything below is guarded by mutex
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable file_ready;
+    std::map<std::string, std::shared_ptr<Entry> > entries;
+    std::deque<std::shared_ptr<Entry> > work;
+    size_t max_read_ahead = 0;
+    int next_batch = 0;
+    bool stopping = false;
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // PYTHON INTERFACE
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void convert_to_parsed_objects(std::vector<adm_boost_common::netlist_statement_object> netlist_parse_results, BoostParsedLine parsedLine);
+void convert_to_parsed_objects(const std::vector<adm_boost_common::netlist_statement_object> & netlist_parse_results,
+        BoostParsedLine & parsedLine);
+
+// Builds the Python facing BoostParsedLine for a line read from filename
+BoostParsedLine to_boost_parsed_line(const NetlistLine & line, const std::string & filename);
+
+// Same as to_boost_parsed_line, for a whole batch of lines
+boost::python::list to_boost_parsed_lines(const std::vector<NetlistLine> & lines, const std::string & filename);
+
+// Packs a batch of lines read from filename into columns
+ParsedLineBatch to_parsed_line_batch(const std::vector<NetlistLine> & lines, const std::string & filename);
+
+
+// Collects up to max_lines lines from next_line, a callable that fills in a NetlistLine and
+// returns false once the file is exhausted. No Python objects are involved in reading or
+// parsing a line, so the GIL is released for the whole batch.
+template <typename NextLine>
+std::vector<NetlistLine> read_netlist_lines(NextLine next_line, int max_lines) {
+    std::vector<NetlistLine> lines;
+    ScopedGILRelease release;
+
+    NetlistLine line;
+    while(static_cast<int>(lines.size()) < max_lines && next_line(line)) {
+        lines.push_back(std::move(line));
+        line = NetlistLine();
+    }
+
+    return lines;
+}
+
+
+// Collects every line next_line returns, for a NetlistPrefetcher. Unlike read_netlist_lines()
+// this never touches the GIL, since it runs on threads Python knows nothing about.
+template <typename NextLine>
+void read_all_netlist_lines(NextLine next_line, std::vector<NetlistLine> & lines) {
+    NetlistLine line;
+    while(next_line(line)) {
+        lines.push_back(std::move(line));
+        line = NetlistLine();
+    }
+}
+
+std::vector<std::string> to_string_vector(const boost::python::list & strings);
 
 
 inline boost::python::object pass_through(boost::python::object const& o) { return o; }
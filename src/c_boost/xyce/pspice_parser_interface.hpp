@@ -27,21 +27,84 @@
 
 #include <boost/python.hpp>
 #include "parser_interface.hpp"
+#include <memory>
 #include <string>
 
 
+template <typename Iterator> struct pspice_parser;
+
 struct PSPICENetlistBoostParser {
 
     NetlistLineReader reader;
     bool is_top_level_file = true;
     std::string filename = " ";
+    int num_threads = 0;
+    std::vector<std::string> lib_sections;
+
+    PSPICENetlistBoostParser();
 
     bool open(std::string filenm, bool top_level_file);
 
     void close();
 
+    // Sets the number of worker threads that parse the lines of the next file opened.
+    // With 0 (the default) each line is read and parsed synchronously by next().
+    void set_num_threads(int n);
+
+    // Sets the directory of the on-disk cache of parsed lines used for the next file
+    // opened (see ParsedLineCache). An empty directory (the default) disables the cache.
+    void set_cache_dir(std::string dir);
+
+    // Sets the .lib sections of the next file opened that are read, along with the sections
+    // they read in turn. The other sections are skipped without being parsed (see
+    // LibrarySectionIndex). An empty list (the default) reads the whole file.
+    void set_lib_sections(boost::python::list sections);
+
+    // Starts reading the files a netlist includes on num_threads threads, with the on-disk
+    // cache in cache_dir (if not empty), so that opening one of them later only replays its
+    // lines. Returns the batch of the files, to be released once they have been read.
+    // See NetlistPrefetcher.
+    static int prefetch(boost::python::list filenames, int num_threads, std::string cache_dir);
+
+    // Drops the files of a batch returned by prefetch() that have not been opened.
+    static void release_prefetched(int batch);
+
+    // Stops the threads reading files ahead of time, before the interpreter exits.
+    static void shutdown_prefetch();
+
     BoostParsedLine next();
 
-    void parseLine(BoostParsedLine & parsedLine);
+    // Reads and parses up to num_lines lines without holding the GIL, and returns them as a
+    // list of BoostParsedLine. The list is empty once the end of the file has been reached.
+    boost::python::list next_batch(int num_lines);
+
+    // Same as next_batch(), but returns the lines in columnar form.
+    ParsedLineBatch next_columnar_batch(int num_lines);
+
+    // Reports the first line of a top level file as its title, and parses any other line.
+    void processLine(NetlistLine & parsedLine, pspice_parser<adm_boost_common::iterator_type> const& g) const;
+
+    void parseLine(NetlistLine & parsedLine, pspice_parser<adm_boost_common::iterator_type> const& g) const;
+
+    private:
+    // Opens the file, unless usePrefetched is set and the prefetcher has already read it.
+    bool openFile(std::string filenm, bool top_level_file, bool usePrefetched);
+
+    // The files read ahead of time for open()
+    static NetlistPrefetcher & prefetcher();
+
+    bool nextLine(NetlistLine & line);
+
+    // Reads and parses the next line of the file, with the pipeline if there is one.
+    bool readLine(NetlistLine & line);
+
+    // Constructing the grammar is far more expensive than parsing a typical line,
+    // so a single instance is built with the parser and reused for every line.
+    std::shared_ptr<pspice_parser<adm_boost_common::iterator_type> > grammar;
+
+    // Only set while a file opened with num_threads > 0 is being read.
+    std::shared_ptr<NetlistParsePipeline<pspice_parser<adm_boost_common::iterator_type> > > pipeline;
+
+    ParsedLineCache cache;
 };
 #endif
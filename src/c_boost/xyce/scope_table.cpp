@@ -0,0 +1,364 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#include "scope_table.hpp"
+#include <stdexcept>
+
+
+// 64-bit FNV-1a
+static unsigned long long hash_name(const std::string & name) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < name.size(); i++) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Fibonacci hashing, which spreads consecutive ids over the table
+static size_t hash_id(unsigned int id) {
+    return static_cast<size_t>((id + 1) * 11400714819323198485ULL >> 32);
+}
+
+
+size_t
+NameTable::probe(const std::string & name, unsigned long long hash) const {
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while(slots[i] != 0) {
+        unsigned int id = slots[i] - 1;
+        if(hashes[id] == hash && names[id] == name) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+unsigned int
+NameTable::find(const std::string & name) const {
+    if(slots.empty()) {
+        return NOT_FOUND;
+    }
+    size_t i = probe(name, hash_name(name));
+    return slots[i] == 0 ? NOT_FOUND : slots[i] - 1;
+}
+
+unsigned int
+NameTable::intern(const std::string & name) {
+    // kept at most half full
+    if(2 * (names.size() + 1) > slots.size()) {
+        grow();
+    }
+
+    unsigned long long hash = hash_name(name);
+    size_t i = probe(name, hash);
+    if(slots[i] == 0) {
+        names.push_back(name);
+        hashes.push_back(hash);
+        slots[i] = names.size();
+    }
+    return slots[i] - 1;
+}
+
+void
+NameTable::grow() {
+    std::vector<unsigned int> old_slots;
+    old_slots.swap(slots);
+    slots.assign(old_slots.empty() ? 64 : 2 * old_slots.size(), 0);
+
+    size_t mask = slots.size() - 1;
+    for(size_t id = 0; id < names.size(); id++) {
+        size_t i = hashes[id] & mask;
+        while(slots[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = id + 1;
+    }
+}
+
+
+ScopeTable::ScopeTable()
+    : scopes(1) {
+}
+
+const ScopeTable::Scope &
+ScopeTable::at(int scope) const {
+    if(scope < 0 || static_cast<size_t>(scope) >= scopes.size()) {
+        throw std::out_of_range("no scope " + std::to_string(scope));
+    }
+    return scopes[scope];
+}
+
+ScopeTable::Scope &
+ScopeTable::at(int scope) {
+    return const_cast<Scope &>(static_cast<const ScopeTable &>(*this).at(scope));
+}
+
+int
+ScopeTable::push_scope(int scope) {
+    at(scope);
+
+    Scope child;
+    child.parent = scope;
+    scopes.push_back(child);
+    return scopes.size() - 1;
+}
+
+int
+ScopeTable::pop_scope(int scope) const {
+    return is_top(scope) ? scope : at(scope).parent;
+}
+
+long
+ScopeTable::lookup(const Scope & s, unsigned int id) const {
+    if(s.size == 0 || id == NameTable::NOT_FOUND) {
+        return -1;
+    }
+
+    size_t mask = s.slots.size() - 1;
+    size_t i = hash_id(id) & mask;
+    while(s.slots[i] != 0) {
+        if(s.slots[i] != REMOVED && s.names[s.slots[i] - 1] == id) {
+            return s.slots[i] - 1;
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+void
+ScopeTable::insert_slot(Scope & s, unsigned int id, unsigned int entry) {
+    size_t mask = s.slots.size() - 1;
+    size_t i = hash_id(id) & mask;
+    while(s.slots[i] != 0) {
+        i = (i + 1) & mask;
+    }
+    s.slots[i] = entry + 1;
+    s.used++;
+}
+
+void
+ScopeTable::grow(Scope & s) {
+    // removed slots are dropped too, since every live entry is inserted again
+    size_t num_slots = s.slots.empty() ? 8 : s.slots.size();
+    while(4 * (s.size + 1) > 3 * num_slots) {
+        num_slots *= 2;
+    }
+    s.slots.assign(num_slots, 0);
+    s.used = 0;
+
+    for(size_t entry = 0; entry < s.names.size(); entry++) {
+        if(s.names[entry] != NameTable::NOT_FOUND) {
+            insert_slot(s, s.names[entry], entry);
+        }
+    }
+}
+
+void
+ScopeTable::set(int scope, const std::string & key, boost::python::object statement) {
+    Scope & s = at(scope);
+    unsigned int id = names.intern(key);
+
+    long entry = lookup(s, id);
+    if(entry >= 0) {
+        s.statements[entry] = statement;
+        return;
+    }
+
+    // the slots also fill up with removed entries, which only a rehash clears
+    if(4 * (s.used + 1) > 3 * s.slots.size()) {
+        grow(s);
+    }
+    s.names.push_back(id);
+    s.statements.push_back(statement);
+    s.size++;
+    insert_slot(s, id, s.names.size() - 1);
+}
+
+bool
+ScopeTable::remove(int scope, const std::string & key) {
+    unsigned int id = names.find(key);
+
+    for(int i = scope; i >= 0; i = scopes[i].parent) {
+        Scope & s = at(i);
+        long entry = lookup(s, id);
+        if(entry < 0) {
+            continue;
+        }
+
+        size_t mask = s.slots.size() - 1;
+        size_t slot = hash_id(id) & mask;
+        while(s.slots[slot] != static_cast<unsigned int>(entry + 1)) {
+            slot = (slot + 1) & mask;
+        }
+        s.slots[slot] = REMOVED;
+        s.names[entry] = NameTable::NOT_FOUND;
+        s.statements[entry] = boost::python::object();
+        s.size--;
+        return true;
+    }
+
+    return false;
+}
+
+bool
+ScopeTable::contains(int scope, const std::string & key) const {
+    return lookup(at(scope), names.find(key)) >= 0;
+}
+
+bool
+ScopeTable::scope_contains(int scope, const std::string & key) const {
+    unsigned int id = names.find(key);
+    for(int i = scope; i >= 0; i = scopes[i].parent) {
+        if(lookup(at(i), id) >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+boost::python::object
+ScopeTable::get(int scope, const std::string & key) const {
+    const Scope & s = at(scope);
+    long entry = lookup(s, names.find(key));
+    return entry < 0 ? boost::python::object() : s.statements[entry];
+}
+
+boost::python::object
+ScopeTable::find(int scope, const std::string & key) const {
+    unsigned int id = names.find(key);
+    for(int i = scope; i >= 0; i = scopes[i].parent) {
+        long entry = lookup(at(i), id);
+        if(entry >= 0) {
+            return scopes[i].statements[entry];
+        }
+    }
+    return boost::python::object();
+}
+
+boost::python::list
+ScopeTable::keys(int scope) const {
+    const Scope & s = at(scope);
+    boost::python::list result;
+    for(size_t entry = 0; entry < s.names.size(); entry++) {
+        if(s.names[entry] != NameTable::NOT_FOUND) {
+            result.append(names.name(s.names[entry]));
+        }
+    }
+    return result;
+}
+
+boost::python::list
+ScopeTable::values(int scope) const {
+    const Scope & s = at(scope);
+    boost::python::list result;
+    for(size_t entry = 0; entry < s.names.size(); entry++) {
+        if(s.names[entry] != NameTable::NOT_FOUND) {
+            result.append(s.statements[entry]);
+        }
+    }
+    return result;
+}
+
+boost::python::list
+ScopeTable::items(int scope) const {
+    const Scope & s = at(scope);
+    boost::python::list result;
+    for(size_t entry = 0; entry < s.names.size(); entry++) {
+        if(s.names[entry] != NameTable::NOT_FOUND) {
+            result.append(boost::python::make_tuple(names.name(s.names[entry]), s.statements[entry]));
+        }
+    }
+    return result;
+}
+
+boost::python::list
+ScopeTable::values_with_prefix(int scope, const std::string & prefix) const {
+    const Scope & s = at(scope);
+    boost::python::list result;
+    for(size_t entry = 0; entry < s.names.size(); entry++) {
+        if(s.names[entry] != NameTable::NOT_FOUND && names.name(s.names[entry]).compare(0, prefix.size(), prefix) == 0) {
+            result.append(s.statements[entry]);
+        }
+    }
+    return result;
+}
+
+
+// True if a < b, by the < operator of Python
+static bool less_than(const boost::python::object & a, const boost::python::object & b) {
+    int result = PyObject_RichCompareBool(a.ptr(), b.ptr(), Py_LT);
+    if(result < 0) {
+        boost::python::throw_error_already_set();
+    }
+    return result != 0;
+}
+
+void insert_sorted(boost::python::list lst, boost::python::object item, boost::python::object key) {
+    using boost::python::object;
+
+    boost::python::ssize_t size = boost::python::len(lst);
+    boost::python::object item_key = key(item);
+
+    if(size == 0 || !less_than(item_key, key(object(lst[size - 1])))) {
+        lst.append(item);
+        return;
+    }
+
+    // the first item whose key is greater than item_key, which is before the last one
+    boost::python::ssize_t low = 0;
+    boost::python::ssize_t high = size - 1;
+    while(low < high) {
+        boost::python::ssize_t middle = low + (high - low) / 2;
+        if(less_than(item_key, key(object(lst[middle])))) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    lst.insert(low, item);
+}
+
+BOOST_PYTHON_MODULE(XdmScopeTable)
+{
+    using namespace boost::python;
+
+    class_<ScopeTable, boost::noncopyable>("ScopeTable")
+        .def("push_scope", &ScopeTable::push_scope)
+        .def("pop_scope", &ScopeTable::pop_scope)
+        .def("set", &ScopeTable::set)
+        .def("remove", &ScopeTable::remove)
+        .def("contains", &ScopeTable::contains)
+        .def("scope_contains", &ScopeTable::scope_contains)
+        .def("get", &ScopeTable::get)
+        .def("find", &ScopeTable::find)
+        .def("keys", &ScopeTable::keys)
+        .def("values", &ScopeTable::values)
+        .def("items", &ScopeTable::items)
+        .def("values_with_prefix", &ScopeTable::values_with_prefix)
+        .def("size", &ScopeTable::size)
+        ;
+
+    def("insert_sorted", insert_sorted);
+}
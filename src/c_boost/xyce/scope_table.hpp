@@ -0,0 +1,161 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef SCOPE_TABLE_HPP
+#define SCOPE_TABLE_HPP
+
+
+#include <boost/python.hpp>
+#include <string>
+#include <vector>
+
+
+// Interns the names used as keys of a ScopeTable, so each distinct name is stored and
+// hashed once however many scopes it is used in. Ids are handed out in order from 0.
+//
+// Names are kept exactly as given. Whether a name is case sensitive depends on the
+// dialect of the statement (Spectre names are, SPICE names are not), and the key of a
+// statement mixes its name with its (case sensitive) statement type, so NAME_SCOPE_INDEX
+// folds the name itself, once per statement, before it builds the key.
+class NameTable {
+
+    public:
+
+    static const unsigned int NOT_FOUND = ~0u;
+
+    // Returns the id of the name, adding it if it is new
+    unsigned int intern(const std::string & name);
+
+    // Returns the id of the name, or NOT_FOUND if it has never been interned
+    unsigned int find(const std::string & name) const;
+
+    const std::string & name(unsigned int id) const { return names[id]; }
+
+    private:
+
+    size_t probe(const std::string & name, unsigned long long hash) const;
+
+    void grow();
+
+    std::vector<std::string> names;
+    std::vector<unsigned long long> hashes;
+
+    // open addressing with linear probing; a slot holds an id + 1, or 0 if it is empty
+    std::vector<unsigned int> slots;
+};
+
+
+// The statements of a netlist by name, in a tree of scopes (the top level of the netlist,
+// and a child scope for each subcircuit and unused library section). A lookup that walks
+// up to the enclosing scopes only hashes the name once, and each scope is a small open
+// addressing table from name id to statement.
+//
+// The statements are Python objects, and are returned in the order they were first added
+// to their scope, like the dict this replaces.
+class ScopeTable {
+
+    public:
+
+    ScopeTable();
+
+    // Adds a child to the scope, and returns it. Scope 0 is the top level scope.
+    int push_scope(int scope);
+
+    // Returns the parent of the scope, or the scope itself if it is the top level one
+    int pop_scope(int scope) const;
+
+    bool is_top(int scope) const { return at(scope).parent < 0; }
+
+    // Adds or replaces the statement named key in the scope
+    void set(int scope, const std::string & key, boost::python::object statement);
+
+    // Removes key from the scope, or else from the nearest enclosing scope that has it.
+    // Returns false if no scope has it.
+    bool remove(int scope, const std::string & key);
+
+    // Whether the scope itself has key
+    bool contains(int scope, const std::string & key) const;
+
+    // Whether the scope or one of its enclosing scopes has key
+    bool scope_contains(int scope, const std::string & key) const;
+
+    // The statement named key in the scope itself, or None
+    boost::python::object get(int scope, const std::string & key) const;
+
+    // The statement named key in the scope or the nearest enclosing scope, or None
+    boost::python::object find(int scope, const std::string & key) const;
+
+    boost::python::list keys(int scope) const;
+
+    boost::python::list values(int scope) const;
+
+    boost::python::list items(int scope) const;
+
+    // The statements of the scope whose names start with prefix, e.g. every model
+    boost::python::list values_with_prefix(int scope, const std::string & prefix) const;
+
+    size_t size(int scope) const { return at(scope).size; }
+
+    private:
+
+    struct Scope {
+        int parent = -1;
+        size_t size = 0;
+        // slots that are not empty, removed ones included
+        size_t used = 0;
+
+        // entries in the order they were added; a removed entry keeps its place as a
+        // hole, with its name set to NameTable::NOT_FOUND
+        std::vector<unsigned int> names;
+        std::vector<boost::python::object> statements;
+
+        // open addressing with linear probing; a slot holds an entry + 1, 0 if it is
+        // empty, or REMOVED
+        std::vector<unsigned int> slots;
+    };
+
+    static const unsigned int REMOVED = ~0u;
+
+    // Scope ids come from Python, so they are checked
+    const Scope & at(int scope) const;
+    Scope & at(int scope);
+
+    // Returns the entry of the scope for the name id, or -1
+    long lookup(const Scope & s, unsigned int id) const;
+
+    void insert_slot(Scope & s, unsigned int id, unsigned int entry);
+
+    void grow(Scope & s);
+
+    NameTable names;
+    std::vector<Scope> scopes;
+};
+
+
+// Inserts item into lst, which is sorted by key (a callable), after the items with an
+// equal key. This leaves lst the way sorted(lst + [item], key=key) would, with a binary
+// search instead of a sort. Items usually arrive in order, so the last one is checked first.
+void insert_sorted(boost::python::list lst, boost::python::object item, boost::python::object key);
+
+
+#endif
@@ -0,0 +1,50 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//   
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//  
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//   
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef SCOPED_GIL_RELEASE_HPP
+#define SCOPED_GIL_RELEASE_HPP
+
+
+#include <boost/python.hpp>
+
+
+// Releases the GIL for as long as the object is in scope, so that other Python threads
+// can run while the current one blocks on work that does not touch Python objects.
+class ScopedGILRelease {
+
+    public:
+
+    ScopedGILRelease() : state(PyEval_SaveThread()) {}
+
+    ~ScopedGILRelease() { PyEval_RestoreThread(state); }
+
+    private:
+
+    ScopedGILRelease(const ScopedGILRelease &);
+    ScopedGILRelease & operator=(const ScopedGILRelease &);
+
+    PyThreadState * state;
+};
+
+
+#endif
@@ -27,29 +27,176 @@
 #include <iostream>
 #include <string>
 
+SpectreNetlistBoostParser::SpectreNetlistBoostParser()
+    : grammar(new spectre_parser<iterator_type>()) {
+    reader.commentRules = inline_comments::spectre();
+}
+
 bool
 SpectreNetlistBoostParser::open(std::string filenm, bool top_level_file) {
+        return openFile(filenm, top_level_file, true);
+    }
+
+bool
+SpectreNetlistBoostParser::openFile(std::string filenm, bool top_level_file, bool usePrefetched) {
+        pipeline.reset();
+        cache.close();
         this->is_top_level_file = top_level_file;
-        return reader.open(filenm);
+        bool good = reader.open(filenm);
+
+        std::vector<NetlistLine> lines;
+        if(usePrefetched && prefetcher().take(filenm, top_level_file, lines) && good && bracketCount == 0) {
+            // read ahead of time, so there is nothing to parse
+            cache.replay(std::move(lines));
+            return good;
+        }
+
+        if(good && bracketCount == 0 && cache.open(reader, "spectre", top_level_file)) {
+            // every line is replayed from the cache, so there is nothing to parse
+            return good;
+        }
+
+        if(good && num_threads > 0) {
+            typedef NetlistParsePipeline<spectre_parser<iterator_type> > pipeline_type;
+            pipeline.reset(new pipeline_type(reader, num_threads,
+                    [this](NetlistLine & parsedLine, spectre_parser<iterator_type> const& g) { return prepareLine(parsedLine, g); },
+                    [this](NetlistLine & parsedLine, spectre_parser<iterator_type> const& g) { processLine(parsedLine, g); }));
+        }
+
+        return good;
     }
 
 void
 SpectreNetlistBoostParser::close() {
+        // the pipeline reads from the file, so it has to be stopped first
+        pipeline.reset();
         reader.close();
+        cache.close();
+    }
+
+void
+SpectreNetlistBoostParser::set_num_threads(int n) {
+        num_threads = n;
+    }
+
+void
+SpectreNetlistBoostParser::set_cache_dir(std::string dir) {
+        cache.set_directory(dir);
     }
 
+int
+SpectreNetlistBoostParser::prefetch(boost::python::list filenames, int num_threads, std::string cache_dir) {
+        return prefetcher().prefetch(to_string_vector(filenames), false, num_threads, cache_dir);
+    }
+
+void
+SpectreNetlistBoostParser::release_prefetched(int batch) {
+        prefetcher().release(batch);
+    }
+
+void
+SpectreNetlistBoostParser::shutdown_prefetch() {
+        prefetcher().shutdown();
+    }
+
+NetlistPrefetcher &
+SpectreNetlistBoostParser::prefetcher() {
+        static NetlistPrefetcher files([](const std::string & filenm, bool top_level_file, const std::string & cache_dir,
+                                          std::vector<NetlistLine> & lines) {
+            SpectreNetlistBoostParser parser;
+            parser.set_cache_dir(cache_dir);
+            if(!parser.openFile(filenm, top_level_file, false)) {
+                return false;
+            }
+            read_all_netlist_lines([&parser](NetlistLine & line) { return parser.nextLine(line); }, lines);
+            // a statistics block left open runs on into the next file
+            return parser.bracketCount == 0;
+        });
+        return files;
+    }
+
+
 BoostParsedLine
 SpectreNetlistBoostParser::next() {
 
-        typedef spectre_parser<iterator_type> spectre_parser;
-        spectre_parser g;
+        std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, 1);
 
-        if(!reader.hasNext(g)) {
+        if(lines.empty()) {
             PyErr_SetString(PyExc_StopIteration, "No more data.");
             boost::python::throw_error_already_set();
         }
 
-        BoostParsedLine parsedLine = reader.next(g);
+        return to_boost_parsed_line(lines[0], reader.filename);
+    }
+
+boost::python::list
+SpectreNetlistBoostParser::next_batch(int num_lines) {
+
+        std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, num_lines);
+
+        return to_boost_parsed_lines(lines, reader.filename);
+    }
+
+ParsedLineBatch
+SpectreNetlistBoostParser::next_columnar_batch(int num_lines) {
+
+        std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, num_lines);
+
+        return to_parsed_line_batch(lines, reader.filename);
+    }
+
+bool
+SpectreNetlistBoostParser::nextLine(NetlistLine & line) {
+
+        return cache.next(line, [this](NetlistLine & line) {
+            bool more = readLine(line);
+            // a statistics block left open runs on into the next file
+            if(!more && bracketCount != 0) {
+                cache.discard();
+            }
+            return more;
+        });
+    }
+
+bool
+SpectreNetlistBoostParser::readLine(NetlistLine & line) {
+
+        // called without the GIL, see read_netlist_lines()
+        if(pipeline) {
+            return pipeline->next(line);
+        }
+
+        spectre_parser<iterator_type> const& g = *grammar;
+
+        if(!reader.hasNext()) {
+            return false;
+        }
+
+        line = reader.next();
+
+        if(!prepareLine(line, g)) {
+            processLine(line, g);
+        }
+
+        return true;
+    }
+
+void
+SpectreNetlistBoostParser::processLine(NetlistLine & parsedLine, spectre_parser<iterator_type> const& g) const {
+
+        if(is_top_level_file && parsedLine.linenums[0] == 1)  {
+            adm_boost_common::netlist_statement_object titleNSO;
+            titleNSO.value = "*" + parsedLine.sourceLine;
+            titleNSO.candidate_types.push_back(adm_boost_common::TITLE);
+
+            parsedLine.parsedObjects.push_back(titleNSO);
+        } else {
+            parseLine(parsedLine, g);
+        }
+    }
+
+bool
+SpectreNetlistBoostParser::prepareLine(NetlistLine & parsedLine, spectre_parser<iterator_type> const& g) {
 
         // BUGZILLA-2089
         // We need to parse out 'statistics' lines, but statistics lines can have nested
@@ -68,7 +215,7 @@ SpectreNetlistBoostParser::next() {
                 parsedLine.errorType = "warn";
                 parsedLine.errorMessage = parsedLine.sourceLine;
             }
-            parseLine(parsedLine);
+            parseLine(parsedLine, g);
 
             // Remember that we need to check for any nested curly braces.
             for(auto ch : parsedLine.sourceLine) {
@@ -79,37 +226,23 @@ SpectreNetlistBoostParser::next() {
                 }
             }
 
-            return parsedLine;
-        }
-
-        if(is_top_level_file && parsedLine.linenums[0] == 1)  {
-            adm_boost_common::netlist_statement_object titleNSO;
-            titleNSO.value = "*" + parsedLine.sourceLine;
-            titleNSO.candidate_types.push_back(adm_boost_common::TITLE);
-
-            std::vector<adm_boost_common::netlist_statement_object> v;
-            v.push_back(titleNSO);
-
-            convert_to_parsed_objects(v, parsedLine);
-        } else {
-            parseLine(parsedLine);
+            return true;
         }
 
-        return parsedLine;
+        return false;
     }
 
 void
-SpectreNetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
+SpectreNetlistBoostParser::parseLine(NetlistLine & parsedLine, spectre_parser<iterator_type> const& g) const {
 
         //setup parser objects
         //typedef std::string::const_iterator iterator_type;
-        typedef spectre_parser<iterator_type> spectre_parser;
-        spectre_parser g;
 
         std::string::const_iterator start = parsedLine.sourceLine.begin();
         std::string::const_iterator end = parsedLine.sourceLine.end();
 
-        std::vector<adm_boost_common::netlist_statement_object> netlist_parse_results;
+        adm_boost_common::parse_arena::scope arena_scope;
+        adm_boost_common::netlist_statement_list netlist_parse_results;
         bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
 
         if (r && start == end)
@@ -122,7 +255,7 @@ SpectreNetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
                std::cout << netlist_parse_results[i] << std::endl;
                }
                */
-            convert_to_parsed_objects(netlist_parse_results, parsedLine);
+            adm_boost_common::take_statements(netlist_parse_results, parsedLine.parsedObjects);
         } else {
 
             netlist_parse_results.clear();
@@ -134,9 +267,9 @@ SpectreNetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
             parsedLine.errorMessage = parsedLine.sourceLine;
             bool comment_readable = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
             if (comment_readable){
-                convert_to_parsed_objects(netlist_parse_results, parsedLine);
+                adm_boost_common::take_statements(netlist_parse_results, parsedLine.parsedObjects);
             } else {
-                std::cout << "\nBoost Parsing failed around line " + getLineNumsString (parsedLine) +
+                std::cout << "\nBoost Parsing failed around line " + getLineNumsString (parsedLine.linenums) +
                     " and line(s) could not be converted to comment\n" << std::endl;
             }
         }
@@ -27,24 +27,84 @@
 
 #include <boost/python.hpp>
 #include "parser_interface.hpp"
+#include <memory>
 #include <vector>
 
 
+template <typename Iterator> struct spectre_parser;
+
 struct SpectreNetlistBoostParser {
 
     NetlistLineReader reader;
     bool is_top_level_file = true;
+    int num_threads = 0;
+
+    SpectreNetlistBoostParser();
 
     bool open(std::string filenm, bool top_level_file);
 
     void close();
 
+    // Sets the number of worker threads that parse the lines of the next file opened.
+    // With 0 (the default) each line is read and parsed synchronously by next().
+    void set_num_threads(int n);
+
+    // Sets the directory of the on-disk cache of parsed lines used for the next file
+    // opened (see ParsedLineCache). An empty directory (the default) disables the cache.
+    void set_cache_dir(std::string dir);
+
+    // Starts reading the files a netlist includes on num_threads threads, with the on-disk
+    // cache in cache_dir (if not empty), so that opening one of them later only replays its
+    // lines. Returns the batch of the files, to be released once they have been read.
+    // See NetlistPrefetcher.
+    static int prefetch(boost::python::list filenames, int num_threads, std::string cache_dir);
+
+    // Drops the files of a batch returned by prefetch() that have not been opened.
+    static void release_prefetched(int batch);
+
+    // Stops the threads reading files ahead of time, before the interpreter exits.
+    static void shutdown_prefetch();
+
     BoostParsedLine next();
 
-    void parseLine(BoostParsedLine & parsedLine);
+    // Reads and parses up to num_lines lines without holding the GIL, and returns them as a
+    // list of BoostParsedLine. The list is empty once the end of the file has been reached.
+    boost::python::list next_batch(int num_lines);
+
+    // Same as next_batch(), but returns the lines in columnar form.
+    ParsedLineBatch next_columnar_batch(int num_lines);
+
+    // Reports the first line of a top level file as its title, and parses any other line.
+    void processLine(NetlistLine & parsedLine, spectre_parser<adm_boost_common::iterator_type> const& g) const;
+
+    void parseLine(NetlistLine & parsedLine, spectre_parser<adm_boost_common::iterator_type> const& g) const;
 
     private:
+    // Opens the file, unless usePrefetched is set and the prefetcher has already read it.
+    bool openFile(std::string filenm, bool top_level_file, bool usePrefetched);
+
+    // The files read ahead of time for open()
+    static NetlistPrefetcher & prefetcher();
+
+    bool nextLine(NetlistLine & line);
+
+    // Reads and parses the next line of the file, with the pipeline if there is one.
+    bool readLine(NetlistLine & line);
+
+    // Comments out Spectre statistics blocks, which span lines and so have to be tracked
+    // in source order. Returns true if the line was handled.
+    bool prepareLine(NetlistLine & parsedLine, spectre_parser<adm_boost_common::iterator_type> const& g);
+
     int bracketCount = 0;
+
+    // Constructing the grammar is far more expensive than parsing a typical line,
+    // so a single instance is built with the parser and reused for every line.
+    std::shared_ptr<spectre_parser<adm_boost_common::iterator_type> > grammar;
+
+    // Only set while a file opened with num_threads > 0 is being read.
+    std::shared_ptr<NetlistParsePipeline<spectre_parser<adm_boost_common::iterator_type> > > pipeline;
+
+    ParsedLineCache cache;
 };
 
 
@@ -53,7 +113,17 @@ BOOST_PYTHON_MODULE(SpectreSpirit)
     boost::python::class_<SpectreNetlistBoostParser>("SpectreNetlistBoostParser")
         .def("open", &SpectreNetlistBoostParser::open)
         .def("close", &SpectreNetlistBoostParser::close)
+        .def("set_num_threads", &SpectreNetlistBoostParser::set_num_threads)
+        .def("set_cache_dir", &SpectreNetlistBoostParser::set_cache_dir)
+        .def("prefetch", &SpectreNetlistBoostParser::prefetch)
+        .staticmethod("prefetch")
+        .def("release_prefetched", &SpectreNetlistBoostParser::release_prefetched)
+        .staticmethod("release_prefetched")
+        .def("shutdown_prefetch", &SpectreNetlistBoostParser::shutdown_prefetch)
+        .staticmethod("shutdown_prefetch")
         .def("next", &SpectreNetlistBoostParser::next)
+        .def("next_batch", &SpectreNetlistBoostParser::next_batch)
+        .def("next_columnar_batch", &SpectreNetlistBoostParser::next_columnar_batch)
         .def("__next__", &SpectreNetlistBoostParser::next)
         .def("__iter__", pass_through)
         ;
@@ -0,0 +1,322 @@
+//-------------------------------------------------------------------------
+//   Copyright 2002-2020 National Technology & Engineering Solutions of
+//   Sandia, LLC (NTESS).  Under the terms of Contract DE-NA0003525 with
+//   NTESS, the U.S. Government retains certain rights in this software.
+//
+//   This file is part of the Xyce(TM) XDM Netlist Translator.
+//
+//   Xyce(TM) XDM is free software: you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License as published by
+//   the Free Software Foundation, either version 3 of the License, or
+//   (at your option) any later version.
+//
+//   Xyce(TM) XDM is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with the Xyce(TM) XDM Netlist Translator.
+//   If not, see <http://www.gnu.org/licenses/>.
+//-------------------------------------------------------------------------
+
+
+#ifndef SPICE_NUMBER_HPP
+#define SPICE_NUMBER_HPP
+
+#include <boost/spirit/include/qi.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <string>
+
+// A lexer for SPICE numeric literals, shared by the netlist grammars and the
+// expression parser. It reads a literal in a single pass and, when asked,
+// converts it to a double without allocating or going through a stream.
+namespace spice_number
+{
+    enum scale_factors
+    {
+        // One of the letters a f p n u m k x g straight after the mantissa, when there
+        // is no exponent. This is the literal the netlist grammars have always read.
+        SINGLE_LETTER,
+
+        // Any of t g meg x k mil m u n p f a (in any case) after the mantissa and
+        // exponent, then any letters, which are taken to be units and ignored.
+        FULL
+    };
+
+    inline bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    inline bool is_letter(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    inline char lower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+
+    // The power of ten of a single-letter scale factor, or 0 if the letter is not one.
+    inline int scale_exponent(char c, scale_factors scales)
+    {
+        switch(lower(c))
+        {
+            case 't': return scales == FULL ? 12 : 0;
+            case 'g': return 9;
+            case 'x': return 6;
+            case 'k': return 3;
+            case 'm': return -3;
+            case 'u': return -6;
+            case 'n': return -9;
+            case 'p': return -12;
+            case 'f': return -15;
+            case 'a': return -18;
+        }
+        return 0;
+    }
+
+    template <typename Iterator>
+    bool starts_with_word(Iterator first, Iterator last, const char * word)
+    {
+        for(; *word; ++word, ++first)
+        {
+            if(first == last || lower(*first) != *word)
+                return false;
+        }
+        return true;
+    }
+
+    // What scan() found, for converting it.
+    struct literal
+    {
+        bool negative = false;
+        unsigned long long mantissa = 0;
+        int significant_digits = 0;
+        bool inexact = false;
+        int exponent = 0;
+        bool mil = false;
+        char digits[19];
+    };
+
+    // Reads the literal at the start of [first, last), returning the end of it, or first
+    // if there is no number there. If lit is given, what is needed to convert the number
+    // is stored in it.
+    template <typename Iterator>
+    Iterator scan(Iterator first, Iterator last, scale_factors scales, bool allow_sign, literal * lit = 0)
+    {
+        literal scratch;
+        literal & l = lit ? *lit : scratch;
+        Iterator it = first;
+
+        if(allow_sign && it != last && *it == '-')
+        {
+            l.negative = true;
+            ++it;
+        }
+
+        // the mantissa, which needs a digit before or after the point
+        bool have_digits = false;
+        int fraction_digits = 0;
+        bool in_fraction = false;
+        for(; it != last; ++it)
+        {
+            char c = *it;
+            if(c == '.' && !in_fraction)
+            {
+                in_fraction = true;
+                continue;
+            }
+            if(!is_digit(c))
+            {
+                break;
+            }
+
+            have_digits = true;
+            if(l.significant_digits == 0 && c == '0')
+            {
+                // leading zeros only move the point
+                fraction_digits += in_fraction;
+            }
+            else if(l.significant_digits < 19)
+            {
+                l.digits[l.significant_digits++] = c;
+                l.mantissa = l.mantissa*10 + (c - '0');
+                fraction_digits += in_fraction;
+            }
+            else
+            {
+                // past what fits exactly, digits before the point still scale the number
+                l.inexact = l.inexact || c != '0';
+                fraction_digits -= !in_fraction;
+            }
+        }
+
+        if(!have_digits)
+        {
+            return first;
+        }
+
+        l.exponent = -fraction_digits;
+
+        // an exponent needs at least one digit
+        if(it != last && lower(*it) == 'e')
+        {
+            Iterator e = it;
+            ++e;
+            int sign = 1;
+            if(e != last && (*e == '-' || *e == '+'))
+            {
+                sign = *e == '-' ? -1 : 1;
+                ++e;
+            }
+
+            if(e != last && is_digit(*e))
+            {
+                int exponent = 0;
+                for(; e != last && is_digit(*e); ++e)
+                {
+                    if(exponent < 100000)
+                        exponent = exponent*10 + (*e - '0');
+                }
+                l.exponent += sign*exponent;
+                it = e;
+
+                if(scales == SINGLE_LETTER)
+                {
+                    return it;
+                }
+            }
+        }
+
+        if(it == last)
+        {
+            return it;
+        }
+
+        if(scales == FULL && starts_with_word(it, last, "meg"))
+        {
+            l.exponent += 6;
+            std::advance(it, 3);
+        }
+        else if(scales == FULL && starts_with_word(it, last, "mil"))
+        {
+            l.mil = true;
+            std::advance(it, 3);
+        }
+        else if(int e = scale_exponent(*it, scales))
+        {
+            l.exponent += e;
+            ++it;
+        }
+
+        if(scales == FULL)
+        {
+            while(it != last && is_letter(*it))
+            {
+                ++it;
+            }
+        }
+
+        return it;
+    }
+
+    // The value of a literal read by scan().
+    inline double value(const literal & l)
+    {
+        static const double powers_of_ten[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+            1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        double v;
+        if(l.mantissa == 0)
+        {
+            v = 0;
+        }
+        else if(!l.inexact && l.mantissa <= (1ULL << 53) && l.exponent >= -22 && l.exponent <= 22)
+        {
+            // both the mantissa and the power of ten are exact, so one multiplication or
+            // division rounds correctly
+            v = l.exponent < 0 ? l.mantissa / powers_of_ten[-l.exponent] : l.mantissa * powers_of_ten[l.exponent];
+        }
+        else
+        {
+            char buffer[64];
+            std::snprintf(buffer, sizeof(buffer), "%.*se%d", l.significant_digits, l.digits, l.exponent);
+            v = std::strtod(buffer, 0);
+        }
+
+        if(l.mil)
+        {
+            v *= 25.4e-6;
+        }
+
+        return l.negative ? -v : v;
+    }
+
+    // Converts text holding a literal, with any scale factor and units, to a double. Text
+    // that does not start with a number gives NaN.
+    template <typename Iterator>
+    double to_double(Iterator first, Iterator last)
+    {
+        literal l;
+        if(scan(first, last, FULL, true, &l) == first)
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return value(l);
+    }
+
+    inline double to_double(const std::string & text)
+    {
+        return to_double(text.begin(), text.end());
+    }
+
+    // The lexer as a Spirit Qi parser, for use in a grammar. Its attribute is the text of
+    // the literal.
+    struct parser : boost::spirit::qi::primitive_parser<parser>
+    {
+        parser(scale_factors scales, bool allow_sign)
+            : scales(scales), allow_sign(allow_sign) { }
+
+        scale_factors scales;
+        bool allow_sign;
+
+        template <typename Context, typename Iterator>
+        struct attribute
+        {
+            typedef std::string type;
+        };
+
+        template <typename Iterator, typename Context, typename Skipper, typename Attribute>
+        bool parse(Iterator & first, Iterator const& last, Context &, Skipper const& skipper, Attribute & attr) const
+        {
+            boost::spirit::qi::skip_over(first, last, skipper);
+
+            Iterator end = scan(first, last, scales, allow_sign);
+            if(end == first)
+            {
+                return false;
+            }
+
+            boost::spirit::traits::assign_to(first, end, attr);
+            first = end;
+            return true;
+        }
+
+        template <typename Context>
+        boost::spirit::info what(Context &) const
+        {
+            return boost::spirit::info("spice_number");
+        }
+    };
+}
+
+#endif
@@ -30,61 +30,184 @@
 #include <vector>
 
 
+TSPICENetlistBoostParser::TSPICENetlistBoostParser()
+    : grammar(new tspice_parser<iterator_type>()) {
+    reader.commentRules = inline_comments::tspice();
+}
+
 bool
 TSPICENetlistBoostParser::open(std::string filenm, bool top_level_file) {
+        return openFile(filenm, top_level_file, true);
+    }
+
+bool
+TSPICENetlistBoostParser::openFile(std::string filenm, bool top_level_file, bool usePrefetched) {
+        pipeline.reset();
+        cache.close();
         this->is_top_level_file = top_level_file;
         this->filename = filenm;
-        return reader.open(filenm);
-    }
+        bool good = reader.open(filenm);
+        if(good && !lib_sections.empty()) {
+            reader.skip_library_sections(lib_sections, "tspice", cache.get_directory());
+        }
 
+        std::vector<NetlistLine> lines;
+        if(usePrefetched && prefetcher().take(filenm, top_level_file, lines) && good &&
+           reader.skipped_sections.empty()) {
+            // read ahead of time, from the whole file, so there is nothing to parse
+            cache.replay(std::move(lines));
+            return good;
+        }
+
+        if(good && cache.open(reader, "tspice", top_level_file)) {
+            // every line is replayed from the cache, so there is nothing to parse
+            return good;
+        }
+
+        if(good && num_threads > 0) {
+            typedef NetlistParsePipeline<tspice_parser<iterator_type> > pipeline_type;
+            pipeline.reset(new pipeline_type(reader, num_threads,
+                    pipeline_type::prepare_function(),
+                    [this](NetlistLine & parsedLine, tspice_parser<iterator_type> const& g) { processLine(parsedLine, g); }));
+        }
+
+        return good;
+    }
 
 void
 TSPICENetlistBoostParser::close() {
+        // the pipeline reads from the file, so it has to be stopped first
+        pipeline.reset();
         reader.close();
+        cache.close();
+    }
+
+void
+TSPICENetlistBoostParser::set_num_threads(int n) {
+        num_threads = n;
+    }
+
+void
+TSPICENetlistBoostParser::set_cache_dir(std::string dir) {
+        cache.set_directory(dir);
+    }
+
+void
+TSPICENetlistBoostParser::set_lib_sections(boost::python::list sections) {
+        lib_sections = to_string_vector(sections);
+    }
+
+int
+TSPICENetlistBoostParser::prefetch(boost::python::list filenames, int num_threads, std::string cache_dir) {
+        return prefetcher().prefetch(to_string_vector(filenames), false, num_threads, cache_dir);
+    }
+
+void
+TSPICENetlistBoostParser::release_prefetched(int batch) {
+        prefetcher().release(batch);
+    }
+
+void
+TSPICENetlistBoostParser::shutdown_prefetch() {
+        prefetcher().shutdown();
+    }
+
+NetlistPrefetcher &
+TSPICENetlistBoostParser::prefetcher() {
+        static NetlistPrefetcher files([](const std::string & filenm, bool top_level_file, const std::string & cache_dir,
+                                          std::vector<NetlistLine> & lines) {
+            TSPICENetlistBoostParser parser;
+            parser.set_cache_dir(cache_dir);
+            if(!parser.openFile(filenm, top_level_file, false)) {
+                return false;
+            }
+            read_all_netlist_lines([&parser](NetlistLine & line) { return parser.nextLine(line); }, lines);
+            return true;
+        });
+        return files;
     }
 
 
 BoostParsedLine
 TSPICENetlistBoostParser::next() {
 
-        typedef tspice_parser<iterator_type> tspice_parser;
-        tspice_parser g;
+        std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, 1);
 
-        if(!reader.hasNext(g)) {
+        if(lines.empty()) {
             PyErr_SetString(PyExc_StopIteration, "No more data.");
             boost::python::throw_error_already_set();
         }
 
-        BoostParsedLine parsedLine = reader.next(g);
+        return to_boost_parsed_line(lines[0], reader.filename);
+    }
+
+boost::python::list
+TSPICENetlistBoostParser::next_batch(int num_lines) {
+
+        std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, num_lines);
+
+        return to_boost_parsed_lines(lines, reader.filename);
+    }
+
+ParsedLineBatch
+TSPICENetlistBoostParser::next_columnar_batch(int num_lines) {
+
+        std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, num_lines);
+
+        return to_parsed_line_batch(lines, reader.filename);
+    }
+
+bool
+TSPICENetlistBoostParser::nextLine(NetlistLine & line) {
+
+        return cache.next(line, [this](NetlistLine & line) { return readLine(line); });
+    }
+
+bool
+TSPICENetlistBoostParser::readLine(NetlistLine & line) {
+
+        // called without the GIL, see read_netlist_lines()
+        if(pipeline) {
+            return pipeline->next(line);
+        }
+
+        tspice_parser<iterator_type> const& g = *grammar;
+
+        if(!reader.hasNext()) {
+            return false;
+        }
+
+        line = reader.next();
+        processLine(line, g);
+
+        return true;
+    }
+
+void
+TSPICENetlistBoostParser::processLine(NetlistLine & parsedLine, tspice_parser<iterator_type> const& g) const {
 
         if(is_top_level_file && parsedLine.linenums[0] == 1)  {
             netlist_statement_object titleNSO;
             titleNSO.value = "*" + parsedLine.sourceLine;
             titleNSO.candidate_types.push_back(adm_boost_common::TITLE);
 
-            std::vector<netlist_statement_object> v;
-            v.push_back(titleNSO);
-
-            convert_to_parsed_objects(v, parsedLine);
+            parsedLine.parsedObjects.push_back(titleNSO);
         } else {
-            parseLine(parsedLine);
+            parseLine(parsedLine, g);
         }
-
-        return parsedLine;
     }
 
 void
-TSPICENetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
+TSPICENetlistBoostParser::parseLine(NetlistLine & parsedLine, tspice_parser<iterator_type> const& g) const {
 
         //setup parser objects
         //typedef std::string::const_iterator iterator_type;
-        typedef tspice_parser<iterator_type> tspice_parser;
-        tspice_parser g;
 
         std::string::const_iterator start = parsedLine.sourceLine.begin();
         std::string::const_iterator end = parsedLine.sourceLine.end();
 
-        std::vector<netlist_statement_object> netlist_parse_results;
+        adm_boost_common::parse_arena::scope arena_scope;
+        adm_boost_common::netlist_statement_list netlist_parse_results;
         bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
 
         if (r && start == end)
@@ -95,7 +218,7 @@ TSPICENetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
               std::cout << netlist_parse_results[i] << std::endl;
               }*/
 
-            convert_to_parsed_objects(netlist_parse_results, parsedLine);
+            adm_boost_common::take_statements(netlist_parse_results, parsedLine.parsedObjects);
         } else {
             netlist_parse_results.clear();
             // if parsing the string failed, we turn it into a comment and report the line numbers
@@ -106,9 +229,9 @@ TSPICENetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
             end = parsedLine.sourceLine.end();
             bool comment_readable = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
             if (comment_readable){
-                convert_to_parsed_objects(netlist_parse_results, parsedLine);
+                adm_boost_common::take_statements(netlist_parse_results, parsedLine.parsedObjects);
             } else {
-                std::cout << "\nBoost Parsing failed around line " + getLineNumsString (parsedLine) +
+                std::cout << "\nBoost Parsing failed around line " + getLineNumsString (parsedLine.linenums) +
                     " and line(s) could not be converted to comment\n" << std::endl;
             }
         }
@@ -26,59 +26,183 @@
 #include <iostream>
 #include <string>
 
+XyceNetlistBoostParser::XyceNetlistBoostParser()
+    : grammar(new xyce_parser<iterator_type>()) {
+    reader.commentRules = inline_comments::xyce();
+}
+
 bool
 XyceNetlistBoostParser::open(std::string filenm, bool top_level_file) {
+    return openFile(filenm, top_level_file, true);
+}
+
+bool
+XyceNetlistBoostParser::openFile(std::string filenm, bool top_level_file, bool usePrefetched) {
+    pipeline.reset();
+    cache.close();
     this->is_top_level_file = top_level_file;
-    return reader.open(filenm);
+    bool good = reader.open(filenm);
+    if(good && !lib_sections.empty()) {
+        reader.skip_library_sections(lib_sections, "xyce", cache.get_directory());
+    }
+
+    std::vector<NetlistLine> lines;
+    if(usePrefetched && prefetcher().take(filenm, top_level_file, lines) && good &&
+       reader.skipped_sections.empty()) {
+        // read ahead of time, from the whole file, so there is nothing to parse
+        cache.replay(std::move(lines));
+        return good;
+    }
+
+    if(good && cache.open(reader, "xyce", top_level_file)) {
+        // every line is replayed from the cache, so there is nothing to parse
+        return good;
+    }
+
+    if(good && num_threads > 0) {
+        typedef NetlistParsePipeline<xyce_parser<iterator_type> > pipeline_type;
+        pipeline.reset(new pipeline_type(reader, num_threads,
+                pipeline_type::prepare_function(),
+                [this](NetlistLine & parsedLine, xyce_parser<iterator_type> const& g) { processLine(parsedLine, g); }));
+    }
+
+    return good;
 }
 
 void
 XyceNetlistBoostParser::close() {
+    // the pipeline reads from the file, so it has to be stopped first
+    pipeline.reset();
     reader.close();
+    cache.close();
+}
+
+void
+XyceNetlistBoostParser::set_num_threads(int n) {
+    num_threads = n;
+}
+
+void
+XyceNetlistBoostParser::set_cache_dir(std::string dir) {
+    cache.set_directory(dir);
+}
+
+void
+XyceNetlistBoostParser::set_lib_sections(boost::python::list sections) {
+    lib_sections = to_string_vector(sections);
+}
+
+int
+XyceNetlistBoostParser::prefetch(boost::python::list filenames, int num_threads, std::string cache_dir) {
+    return prefetcher().prefetch(to_string_vector(filenames), false, num_threads, cache_dir);
+}
+
+void
+XyceNetlistBoostParser::release_prefetched(int batch) {
+    prefetcher().release(batch);
+}
+
+void
+XyceNetlistBoostParser::shutdown_prefetch() {
+    prefetcher().shutdown();
+}
+
+NetlistPrefetcher &
+XyceNetlistBoostParser::prefetcher() {
+    static NetlistPrefetcher files([](const std::string & filenm, bool top_level_file, const std::string & cache_dir,
+                                      std::vector<NetlistLine> & lines) {
+        XyceNetlistBoostParser parser;
+        parser.set_cache_dir(cache_dir);
+        if(!parser.openFile(filenm, top_level_file, false)) {
+            return false;
+        }
+        read_all_netlist_lines([&parser](NetlistLine & line) { return parser.nextLine(line); }, lines);
+        return true;
+    });
+    return files;
 }
 
 
 BoostParsedLine
 XyceNetlistBoostParser::next() {
 
-    typedef xyce_parser<iterator_type> xyce_parser;
-    xyce_parser g;
+    std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, 1);
 
-    if(!reader.hasNext(g)) {
+    if(lines.empty()) {
         PyErr_SetString(PyExc_StopIteration, "No more data.");
         boost::python::throw_error_already_set();
     }
 
-    BoostParsedLine parsedLine = reader.next(g);
+    return to_boost_parsed_line(lines[0], reader.filename);
+}
+
+boost::python::list
+XyceNetlistBoostParser::next_batch(int num_lines) {
+
+    std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, num_lines);
+
+    return to_boost_parsed_lines(lines, reader.filename);
+}
+
+ParsedLineBatch
+XyceNetlistBoostParser::next_columnar_batch(int num_lines) {
+
+    std::vector<NetlistLine> lines = read_netlist_lines([this](NetlistLine & line) { return nextLine(line); }, num_lines);
+
+    return to_parsed_line_batch(lines, reader.filename);
+}
+
+bool
+XyceNetlistBoostParser::nextLine(NetlistLine & line) {
+
+    return cache.next(line, [this](NetlistLine & line) { return readLine(line); });
+}
+
+bool
+XyceNetlistBoostParser::readLine(NetlistLine & line) {
+
+    // called without the GIL, see read_netlist_lines()
+    if(pipeline) {
+        return pipeline->next(line);
+    }
+
+    xyce_parser<iterator_type> const& g = *grammar;
+
+    if(!reader.hasNext()) {
+        return false;
+    }
 
-    if(is_top_level_file && parsedLine.linenums[0] == 1) {
+    line = reader.next();
+    processLine(line, g);
+
+    return true;
+}
+
+void
+XyceNetlistBoostParser::processLine(NetlistLine & parsedLine, xyce_parser<iterator_type> const& g) const {
+
+    if(is_top_level_file && parsedLine.linenums[0] == 1)  {
         adm_boost_common::netlist_statement_object titleNSO;
         titleNSO.value = "*" + parsedLine.sourceLine;
         titleNSO.candidate_types.push_back(adm_boost_common::TITLE);
 
-        std::vector<adm_boost_common::netlist_statement_object> v;
-        v.push_back(titleNSO);
-
-        convert_to_parsed_objects(v, parsedLine);
+        parsedLine.parsedObjects.push_back(titleNSO);
     } else {
-        parseLine(parsedLine);
+        parseLine(parsedLine, g);
     }
-
-    return parsedLine;
 }
 
 void
-XyceNetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
+XyceNetlistBoostParser::parseLine(NetlistLine & parsedLine, xyce_parser<iterator_type> const& g) const {
 
     //setup parser objects
     //typedef std::string::const_iterator iterator_type;
-    typedef xyce_parser<iterator_type> xyce_parser;
-    xyce_parser g;
 
     std::string::const_iterator start = parsedLine.sourceLine.begin();
     std::string::const_iterator end = parsedLine.sourceLine.end();
 
-    std::vector<adm_boost_common::netlist_statement_object> netlist_parse_results;
+    adm_boost_common::parse_arena::scope arena_scope;
+    adm_boost_common::netlist_statement_list netlist_parse_results;
     // Note phrase_parse is a call supplied by boost::spirit::qi
     bool r = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
 
@@ -90,7 +214,7 @@ XyceNetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
         //}
         //std::cout << "\n\n" << std::flush;
 
-        convert_to_parsed_objects(netlist_parse_results, parsedLine);
+        adm_boost_common::take_statements(netlist_parse_results, parsedLine.parsedObjects);
     } else {
         //std::cout << "Xyce Parsing failed: \n" << parsedLine.sourceLine << std::endl;
         //for(int i = 0; i < netlist_parse_results.size(); i++) {
@@ -108,9 +232,9 @@ XyceNetlistBoostParser::parseLine(BoostParsedLine & parsedLine) {
         parsedLine.errorMessage = parsedLine.sourceLine;
         bool comment_readable = phrase_parse(start, end, g, boost::spirit::ascii::space, netlist_parse_results);
         if (comment_readable){
-            convert_to_parsed_objects(netlist_parse_results, parsedLine);
+            adm_boost_common::take_statements(netlist_parse_results, parsedLine.parsedObjects);
         } else {
-            std::cout << "\nXyce Parsing failed around line " + getLineNumsString (parsedLine) +
+            std::cout << "\nXyce Parsing failed around line " + getLineNumsString (parsedLine.linenums) +
                 " and line(s) could not be converted to comment\n" << std::endl;
         }
     }
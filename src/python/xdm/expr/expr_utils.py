@@ -20,6 +20,7 @@
 #   If not, see <http://www.gnu.org/licenses/>.
 #-------------------------------------------------------------------------
 
+from collections import namedtuple
 from copy import copy, deepcopy
 
 from xdm import Types
@@ -31,36 +32,78 @@ import SpiritExprCommon
 import HSpiceExprSpirit
 
 
+# a token found by find_expr_components(), with the same fields as the
+# ParseExprObject it stands in for
+ExprToken = namedtuple("ExprToken", ["value", "types"])
+
+# parsing an expression does not depend on the state of the parser, so one does
+# for every expression
+_token_parser = None
+
+
+# function to parse an expression (in_expr) into its lexical tokens. Returns the
+# BoostParsedExpr, whose token_text, token_offsets, token_lengths and token_types
+# give the tokens without a Python object for each, or None if the expression
+# does not parse
+def parse_expr_tokens(in_expr):
+    parsed_expr = _expr_parser().parseExpr(in_expr)
+    if parsed_expr.error_type:
+        return None
+
+    return parsed_expr
+
+
+# function to rewrite an HSPICE expression (in_expr) in Xyce syntax: spaces to the
+# left of the colons of ternary operators, curly braces around it if braces is set
+# and it is not a number, and "**" for "^". Returns the rewritten expression, whether
+# it contains the "TEMPER" special variable, and False if its "?" and ":" do not pair
+# up (the ternary operators are then left as they were)
+def hspice_to_xyce(in_expr, braces=False):
+    return _expr_parser().to_xyce(in_expr, braces)
+
+
+def _expr_parser():
+    global _token_parser
+    if _token_parser is None:
+        _token_parser = HSpiceExprSpirit.HSPICEExprBoostParser()
+
+    return _token_parser
+
+
 # function to find certain lexical tokens (defined in the search_expr_list) in an
 # expression (in_expr). The expression elements are saved into an output
 # list (found_list). If search_expr_list is empty, the function returns all
 # lexical tokens found
 def find_expr_components(in_expr, search_expr_list, found_list, debug=False):
-    expr_parser = HSpiceExprSpirit.HSPICEExprBoostParser()
-    parsed_expr = expr_parser.parseExpr(in_expr)
+    parsed_expr = parse_expr_tokens(in_expr)
 
-    if not parsed_expr.error_type:
-        for parsed_expr_object in parsed_expr.parsed_expr_objects:
-            if search_expr_list:
-                if parsed_expr_object.types[0] in search_expr_list:
-                    found_list.append(parsed_expr_object)
+    if parsed_expr is not None:
+        text = parsed_expr.token_text
+        offsets = parsed_expr.token_offsets
+        lengths = parsed_expr.token_lengths
 
-            else:
-                found_list.append(parsed_expr_object)
+        for i, token_type in enumerate(parsed_expr.token_types):
+            if search_expr_list and (token_type < 0 or token_type not in search_expr_list):
+                continue
+
+            value = text[offsets[i]:offsets[i] + lengths[i]]
+            types = [SpiritExprCommon.expr_data_model_type.values[token_type]] if token_type >= 0 else []
+            found_list.append(ExprToken(value, types))
 
             if debug:
-                if parsed_expr_object.types[0] == SpiritExprCommon.expr_data_model_type.FUNC_NAME:
-                    print(parsed_expr_object.value, "FUNC_NAME")
-                elif parsed_expr_object.types[0] == SpiritExprCommon.expr_data_model_type.PARAM_NAME:
-                    print(parsed_expr_object.value, "PARAM_NAME")
-                elif parsed_expr_object.types[0] == SpiritExprCommon.expr_data_model_type.NUMBER:
-                    print(parsed_expr_object.value, "NUMBER")
+                if token_type == SpiritExprCommon.expr_data_model_type.FUNC_NAME:
+                    print(value, "FUNC_NAME")
+                elif token_type == SpiritExprCommon.expr_data_model_type.PARAM_NAME:
+                    print(value, "PARAM_NAME")
+                elif token_type == SpiritExprCommon.expr_data_model_type.NUMBER:
+                    print(value, "NUMBER")
     return
 
 
 # function to export context information for processing the C++ code.
-def expr_spirit_interface(context):
+def expr_spirit_interface(context, num_threads=0):
     expr_parser = HSpiceExprSpirit.HSPICEExprBoostParser()
+    expr_parser.set_num_threads(num_threads)
 
     expr_parser.py_dict = context.func_dict
     expr_parser.import_func_statements(expr_parser.py_dict)
@@ -312,47 +355,11 @@ def update_params(full_hier, param_names, func_calls, eval_result, st_to_process
     return
 
 
-# This is a copy of the hack_ternary_operator method in HSPICENetlistBoostParserInterface.
-# It's needed to put back in a space before the ":" in ternary operators, since spaces need
-# to be eliminated for replacement of functions with their evaluated result
+# Puts back the space before the ":" in ternary operators, the same way the HSPICE
+# reader does when it rewrites expressions for Xyce. It's needed since spaces need to
+# be eliminated for replacement of functions with their evaluated result
 def ternary_clean_up(in_expression):
-    q_list = []
-    out_expression = ""
-
-    # first check ternary operator is in expression
-    if "?" in in_expression and ":" in in_expression:
-
-        # Next, make sure every "?" is followed by a ":" and that there are equal number of each.
-        # If not, give warning, return the expression, and continue translating.
-        # TODO: figure out if it's better to comment out? might not be, since expression may be
-        #       on a line containing multiple expressions, which would end up commenting out everything
-        #       else
-        for char in in_expression:
-            if char == "?":
-                q_list.append(char)
-                out_expression += char
-            elif char == ":":
-                if not q_list:
-                    return in_expression
-                else:
-                    q_list.pop()
-
-                    # if there's an empty space to the left of ":", no need to add another
-                    if out_expression[-1] == " ":
-                        out_expression += char
-                    else:
-                        out_expression += " " + char
-            else:
-                out_expression += char
-
-        if q_list:
-            return in_expression
-
-    # if no ternary operator in expression, return expression unchanged
-    else:
-        return in_expression
-
-    return out_expression
+    return hspice_to_xyce(in_expression)[0]
 
 
 def comment_out_funcs(sli):
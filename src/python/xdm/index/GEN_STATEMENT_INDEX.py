@@ -21,6 +21,8 @@
 #-------------------------------------------------------------------------
 
 
+import XdmScopeTable
+
 from xdm.index.StatementIndex import StatementIndex
 from xdm.exceptions import InvalidTypeException
 from xdm.statements import Statement
@@ -80,10 +82,11 @@ class GEN_STATEMENT_INDEX(StatementIndex):
         if nm not in self._file_dict:
             self._file_dict[nm] = []
 
-        self._file_dict[nm].append(ws)
-
+        # the list stays sorted as it grows, rather than being sorted again on every add
         if self._s is not None:
-            self._file_dict[nm] = sorted(self._file_dict[nm], key=self._s)
+            XdmScopeTable.insert_sorted(self._file_dict[nm], ws, self._s)
+        else:
+            self._file_dict[nm].append(ws)
 
     def get_statements(self, fl):
         """
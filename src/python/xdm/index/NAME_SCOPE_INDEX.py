@@ -23,6 +23,8 @@
 
 import logging
 
+import XdmScopeTable
+
 from xdm import Types
 from xdm.exceptions import InvalidTypeException
 from xdm.exceptions import NameConflictException
@@ -49,7 +51,6 @@ class NAME_SCOPE_INDEX(MasterIndex):
         MasterIndex.__init__(self)
         self._children = []
         self._parent = parent
-        self._statements = {}
         self._all_statements_in_scope = {}
         # only used in child scopes to define subckt name
         self._subckt_command = subckt_command
@@ -57,6 +58,15 @@ class NAME_SCOPE_INDEX(MasterIndex):
         self._child_scope_lib_sects = []
         self._name_to_statement = {}
 
+        # the names of every scope live in one native table shared down the tree, which
+        # refers to this scope by number
+        if parent is not None:
+            self._table = parent._table
+            self._scope = self._table.push_scope(parent._scope)
+        else:
+            self._table = XdmScopeTable.ScopeTable()
+            self._scope = 0
+
         if parent is not None:
             self._lsi = parent.lazy_statement_index
             self._uid = parent.uid_index
@@ -94,7 +104,22 @@ class NAME_SCOPE_INDEX(MasterIndex):
 
     @property
     def statements(self):
-        return self._statements
+        """ returns a copy of the named statements of this scope, as a dict keyed by
+        statement type and name """
+        return dict(self._table.items(self._scope))
+
+    def statements_with_prefix(self, prefix):
+        """
+        Returns the named statements of this scope whose keys start with prefix,
+        in the order they were added, e.g. "__MODELDEF__" for its models.
+
+        Args:
+           prefix (str): Start of the statement type and name keys
+
+        Returns:
+           list. Statements of this scope only, not its ancestors
+        """
+        return self._table.values_with_prefix(self._scope, prefix)
 
     @property
     def all_statements_in_scope(self):
@@ -201,9 +226,9 @@ class NAME_SCOPE_INDEX(MasterIndex):
         if case_insensitive:
             model_name = m.name.upper()
 
-        if ("__MODELDEF__" + model_name) in self._statements and isinstance(
-                self._statements[("__MODELDEF__" + model_name)], MASTER_MODEL):
-            master = self._statements[("__MODELDEF__" + model_name)]
+        existing = self._table.get(self._scope, "__MODELDEF__" + model_name)
+        if isinstance(existing, MASTER_MODEL):
+            master = existing
         else:
             d = self.get_object("__LAZYSTATEMENT__" + model_name)
             master = MASTER_MODEL(m.name)
@@ -217,7 +242,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
                 if self.local_scope_contains("__MODELDEF__" + model_name):
                     raise NameConflictException(model_name + " has already been used in this scope")
 
-            self._statements["__MODELDEF__" + model_name] = master
+            self._table.set(self._scope, "__MODELDEF__" + model_name, master)
             # Put MASTER_MODEL in indexes (if any care to see it)
             self._add_to_indexes(master)
 
@@ -265,16 +290,16 @@ class NAME_SCOPE_INDEX(MasterIndex):
             raise InvalidTypeException(st.name + " is not of type Ref")
 
     def remove_statement(self, st):
-        if st.name in self._statements:
-            del (self._statements[st.name])
-        else:
-            if self._parent is not None:
-                self._parent.remove_statement(st)
+        if st.name is not None:
+            self._table.remove(self._scope, st.name)
 
     def _add_statement(self, st, is_device=False, case_insensitive=False):
         # If it is a named statement, we need to check if there
         # is a name/scope conflict. Directives, for example,
         # do not need to be checked.
+        # The case is folded here rather than by the scope table, since only some
+        # dialects are case insensitive, and the folded name is also used for the keys
+        # of all_statements_in_scope and of lazy statements.
         name = st.name
         if case_insensitive:
             name = name.upper()
@@ -292,7 +317,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
                 if self.contains(st.get_prop(Types.statementType) + st.device_type + name):
                     raise NameConflictException(
                         str(st.device_type + name) + " has already been used in this scope")
-                self._statements[st.get_prop(Types.statementType) + st.device_type + name] = st
+                self._table.set(self._scope, st.get_prop(Types.statementType) + st.device_type + name, st)
 
             elif isinstance(st, ENODE) or (isinstance(st, Command) and st.command_type == ".SUBCKT"):
                 if self.get_object(st.get_prop(Types.statementType) + name):
@@ -303,12 +328,12 @@ class NAME_SCOPE_INDEX(MasterIndex):
                         raise NameConflictException(str(name) + " has already been used in this scope")
                     else:
                         logging.warning(str(name) + " duplicated in a child scope. Continuing.")
-                self._statements[st.get_prop(Types.statementType) + name] = st
+                self._table.set(self._scope, st.get_prop(Types.statementType) + name, st)
 
             elif isinstance(st, Ref):
-                self._statements[st.get_prop(Types.statementType) + str(st.uid)] = st
+                self._table.set(self._scope, st.get_prop(Types.statementType) + str(st.uid), st)
             else:
-                self._statements[st.get_prop(Types.statementType) + name] = st
+                self._table.set(self._scope, st.get_prop(Types.statementType) + name, st)
         else:
             self._all_statements_in_scope[st.get_prop(Types.statementType) + str(st.uid)] = st
 
@@ -320,7 +345,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
 
     @property
     def named_statements(self):
-        return self._statements.values()
+        return self._table.values(self._scope)
 
     def add_device(self, st, case_insensitive=False):
         """
@@ -382,7 +407,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
         Returns:
            bool. True if the name is within scoped node; else false
         """
-        return nm in self._statements
+        return self._table.contains(self._scope, nm)
 
     def get_object(self, nm):
         """
@@ -396,12 +421,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
         Returns:
            Statement.  None if there is no nm within the scope
         """
-        if self.contains(nm):
-            return self._statements[nm]
-        if self._parent is None:
-            return None
-
-        return self._parent.get_object(nm)
+        return self._table.find(self._scope, nm)
 
     def scope_contains(self, nm):
         """
@@ -413,7 +433,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
         Returns:
            bool. True if the name is within scope; else false
         """
-        return self.contains(nm) or self._parent_contains(nm)
+        return self._table.scope_contains(self._scope, nm)
 
     def local_scope_contains(self, nm):
         """
@@ -505,7 +525,7 @@ class NAME_SCOPE_INDEX(MasterIndex):
         # dictionary from lower-cased name list of actual cased names
         upper_to_actual = {}
         warning_message_keys = []
-        for statement in self._statements.keys():
+        for statement in self._table.keys(self._scope):
             if statement.upper() in upper_to_actual:
                 warning_message_keys.append(statement.upper())
                 upper_to_actual[statement.upper()].append(statement)
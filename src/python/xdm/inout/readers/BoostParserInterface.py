@@ -137,3 +137,17 @@ boost_xdm_map_dict = {SpiritCommon.data_model_type.DIRECTIVE_NAME: Types.name,
                       SpiritCommon.data_model_type.VARIABLE_EXPR_OR_VALUE: Types.variableExprValue,
                       SpiritCommon.data_model_type.DATA_TABLE_NAME: Types.dataTableName
                       }
+
+
+def iter_parsed_lines(internal_parser, batch_size=1024):
+    """
+    Iterates over the BoostParsedLines of an open Spirit parser. Lines are fetched
+    batch_size at a time through next_batch(), so that each line does not need its
+    own call into the parser.
+    """
+    while True:
+        batch = internal_parser.next_batch(batch_size)
+        if not batch:
+            return
+        for boost_parsed_line in batch:
+            yield boost_parsed_line
@@ -62,13 +62,20 @@ class GenericReader(object):
 
     """
 
-    def __init__(self, filename, grammar, language_definition, pspice_xml=None, spectre_xml=None, tspice_xml=None, hspice_xml=None, reader_state=None, top_reader_state=None, is_top_level_file=True, append_prefix=False, auto_translate=False, lib_sect_list=[]):
+    def __init__(self, filename, grammar, language_definition, pspice_xml=None, spectre_xml=None, tspice_xml=None, hspice_xml=None, reader_state=None, top_reader_state=None, is_top_level_file=True, append_prefix=False, auto_translate=False, lib_sect_list=[], parse_threads=0, parse_cache_dir=None, lib_sections_only=False):
         self._file = filename
+        self._parse_threads = parse_threads
+        self._parse_cache_dir = parse_cache_dir
+        self._lib_sections_only = lib_sections_only
 
         self._grammar_type = grammar
         self._language_definition = language_definition
         self._is_top_level_file = is_top_level_file
-        self._grammar = self._grammar_type(self._file, self._language_definition, self._is_top_level_file)
+        # the sections of a library file that are not used are skipped, if asked to
+        self._lib_sections = list(lib_sect_list) if lib_sections_only else None
+        self._grammar = self._grammar_type(self._file, self._language_definition, self._is_top_level_file,
+                                           parse_threads=self._parse_threads, parse_cache_dir=self._parse_cache_dir,
+                                           lib_sections=self._lib_sections)
         self._case_insensitive = self._language_definition.is_case_insensitive()
         self._last_line = 0
         self._tspice_xml = tspice_xml
@@ -96,6 +103,74 @@ class GenericReader(object):
     def reader_state(self):
         return self._reader_state
 
+    def include_filename(self, incfile, debug_incfiles=False):
+        """
+        Returns the path of a file included by this file, relative to its directory
+        """
+        import sys
+        platform = sys.platform
+
+        if debug_incfiles is True:
+            print >> sys.stderr, "self._file = '%s'\n" % self._file
+            print >> sys.stderr, "os.path.dirname(self._file) = '%s'\n" % (os.path.dirname(self._file))
+            print >> sys.stderr, "os.path.dirname(os.path.abspath(self._file)) = '%s'\n" % (
+                os.path.dirname(os.path.abspath(self._file)))
+            print >> sys.stderr, "incfile = '%s'\n" % incfile
+
+        # incfile_resolved  = os.path.normpath(os.path.normcase(incfile)).replace('"','')
+        # incfile_case_resolved  = os.path.normcase(incfile)
+        incfile_case_resolved = incfile
+        incfile_quote_resolved = incfile_case_resolved.replace('"', '')
+        incfile_quote_resolved = incfile_quote_resolved.replace("'", '')
+        incfile_path_resolved = os.path.normpath(incfile_quote_resolved)
+        incfile_resolved = incfile_path_resolved
+        if debug_incfiles is True:
+            print >> sys.stderr, "incfile_case_resolved = '%s'\n" % incfile_case_resolved
+            print >> sys.stderr, "incfile_quote_resolved = '%s'\n" % incfile_quote_resolved
+            print >> sys.stderr, "incfile_path_resolved = '%s'\n" % incfile_path_resolved
+
+        dirname_resolved = os.path.normpath(os.path.dirname(os.path.abspath(self._file))).replace('"', '')
+
+        if debug_incfiles:
+            print >> sys.stderr, "incfile_resolved = '%s'\n" % incfile_resolved
+            print >> sys.stderr, "dirname_resolved = '%s'\n" % dirname_resolved
+
+        if platform == "Windows":
+            if debug_incfiles:
+                print >> sys.stderr, "On Windows - pre fixed file string = '%s'\n" % incfile_resolved
+            incfile_resolved_slashes = incfile_resolved.replace('//', '\\')
+            if debug_incfiles:
+                print >> sys.stderr, "On Windows - post fixed file string = '%s'\n" % incfile_resolved
+        else:
+            if debug_incfiles:
+                print >> sys.stderr, "On Linux or OS X - pre fixed file string = '%s'\n" % incfile_resolved
+            incfile_resolved_slashes = incfile_resolved.replace('\\', '/')
+            if debug_incfiles:
+                print >> sys.stderr, "On Linux or OS X - post fixed file string = '%s'\n" % incfile_resolved
+
+        if debug_incfiles:
+            print >> sys.stderr, "incfile_resolved_slashes = '%s'\n" % incfile_resolved_slashes
+
+        inc_path, incfile_resolved2 = os.path.split(incfile_resolved_slashes)
+        incfile_resolved3 = os.path.join(inc_path, incfile_resolved2)
+
+        if debug_incfiles is True:
+            print >> sys.stderr, "incfile2_resolved = '%s'\n" % incfile_resolved2
+            print >> sys.stderr, "incfile3_resolved = '%s'\n" % incfile_resolved3
+
+        filename = os.path.join(dirname_resolved, incfile_resolved3).replace('"', '')
+
+        if debug_incfiles is True:
+            print >> sys.stderr, "filename = '%s'\n" % filename
+
+        return filename
+
+    def library_filename(self, lib_file_name):
+        """
+        Returns the path of a library file read by this file, relative to its directory
+        """
+        return os.path.join(os.path.dirname(self._file), lib_file_name).replace("'", '').replace('"', '')
+
     def read(self):
         """
         .. _reader_read:
@@ -109,7 +184,6 @@ class GenericReader(object):
         lib_files = []  # tuple list (file name, lib name)
         control_device_handling_list = []
         debug_incfiles = False
-        platform = sys.platform
 
         grammar_iter = iter(self._grammar)
         # iterates through each grammar "line"
@@ -124,7 +198,9 @@ class GenericReader(object):
         if self._language_changed:
 
             self._language_changed = False
-            self._grammar = self._grammar_type(self._file, self._language_definition, self._is_top_level_file)
+            self._grammar = self._grammar_type(self._file, self._language_definition, self._is_top_level_file,
+                                               parse_threads=self._parse_threads, parse_cache_dir=self._parse_cache_dir,
+                                               lib_sections=self._lib_sections)
             grammar_iter = iter(self._grammar)
 
             # skip all lines until past simulator statement
@@ -154,62 +230,20 @@ class GenericReader(object):
                 inc_files_and_scopes = []
                 inc_files_and_scopes = top_inc_files_and_scopes + child_inc_files_and_scopes
 
+            # the included and library files are parsed ahead of time, all at once, and
+            # then read one after another in the same order as always
+            prefetch_batch = None
+            if self._parse_threads > 0:
+                prefetch_files = [self.include_filename(incfile, debug_incfiles) for incfile, scope in inc_files_and_scopes]
+                if not self._lib_sections_only:
+                    prefetch_files += [self.library_filename(libfile) for libfile in OrderedDict.fromkeys(libfile for libfile, sect in lib_files)]
+                prefetch_batch = self._grammar_type.prefetch(prefetch_files, self._parse_threads, self._parse_cache_dir)
+
             for incfile_pair in inc_files_and_scopes:
                 incfile = incfile_pair[0]
                 incfile_scope = incfile_pair[1]
 
-                if debug_incfiles is True:
-                    print >> sys.stderr, "self._file = '%s'\n" % self._file
-                    print >> sys.stderr, "os.path.dirname(self._file) = '%s'\n" % (os.path.dirname(self._file))
-                    print >> sys.stderr, "os.path.dirname(os.path.abspath(self._file)) = '%s'\n" % (
-                        os.path.dirname(os.path.abspath(self._file)))
-                    print >> sys.stderr, "incfile = '%s'\n" % incfile
-
-                # incfile_resolved  = os.path.normpath(os.path.normcase(incfile)).replace('"','')
-                # incfile_case_resolved  = os.path.normcase(incfile)
-                incfile_case_resolved = incfile
-                incfile_quote_resolved = incfile_case_resolved.replace('"', '')
-                incfile_quote_resolved = incfile_quote_resolved.replace("'", '')
-                incfile_path_resolved = os.path.normpath(incfile_quote_resolved)
-                incfile_resolved = incfile_path_resolved
-                if debug_incfiles is True:
-                    print >> sys.stderr, "incfile_case_resolved = '%s'\n" % incfile_case_resolved
-                    print >> sys.stderr, "incfile_quote_resolved = '%s'\n" % incfile_quote_resolved
-                    print >> sys.stderr, "incfile_path_resolved = '%s'\n" % incfile_path_resolved
-
-                dirname_resolved = os.path.normpath(os.path.dirname(os.path.abspath(self._file))).replace('"', '')
-
-                if debug_incfiles:
-                    print >> sys.stderr, "incfile_resolved = '%s'\n" % incfile_resolved
-                    print >> sys.stderr, "dirname_resolved = '%s'\n" % dirname_resolved
-
-                if platform == "Windows":
-                    if debug_incfiles:
-                        print >> sys.stderr, "On Windows - pre fixed file string = '%s'\n" % incfile_resolved
-                    incfile_resolved_slashes = incfile_resolved.replace('//', '\\')
-                    if debug_incfiles:
-                        print >> sys.stderr, "On Windows - post fixed file string = '%s'\n" % incfile_resolved
-                else:
-                    if debug_incfiles:
-                        print >> sys.stderr, "On Linux or OS X - pre fixed file string = '%s'\n" % incfile_resolved
-                    incfile_resolved_slashes = incfile_resolved.replace('\\', '/')
-                    if debug_incfiles:
-                        print >> sys.stderr, "On Linux or OS X - post fixed file string = '%s'\n" % incfile_resolved
-
-                if debug_incfiles:
-                    print >> sys.stderr, "incfile_resolved_slashes = '%s'\n" % incfile_resolved_slashes
-
-                inc_path, incfile_resolved2 = os.path.split(incfile_resolved_slashes)
-                incfile_resolved3 = os.path.join(inc_path, incfile_resolved2)
-
-                if debug_incfiles is True:
-                    print >> sys.stderr, "incfile2_resolved = '%s'\n" % incfile_resolved2
-                    print >> sys.stderr, "incfile3_resolved = '%s'\n" % incfile_resolved3
-
-                filename = os.path.join(dirname_resolved, incfile_resolved3).replace('"', '')
-
-                if debug_incfiles is True:
-                    print >> sys.stderr, "filename = '%s'\n" % filename
+                filename = self.include_filename(incfile, debug_incfiles)
 
                 logging.debug("Loading include file \t\t\"" + str(filename) + "\"")
 
@@ -218,7 +252,9 @@ class GenericReader(object):
                 include_file_reader = GenericReader(filename, self._grammar_type, self._language_definition,
                                                     reader_state=self._reader_state, top_reader_state=self._top_reader_state, 
                                                     is_top_level_file=False, tspice_xml=self._tspice_xml, pspice_xml=self._pspice_xml,
-                                                    spectre_xml=self._spectre_xml, auto_translate=self._auto_translate)
+                                                    spectre_xml=self._spectre_xml, auto_translate=self._auto_translate,
+                                                    parse_threads=self._parse_threads, parse_cache_dir=self._parse_cache_dir,
+                                                    lib_sections_only=self._lib_sections_only)
                 include_file_reader.read()
                 self._reader_state.scope_index = curr_scope
 
@@ -239,14 +275,20 @@ class GenericReader(object):
                 lib_names = deepcopy(lib_files_aggregated_sects[libfile])
                 logging.info("Parsing Lib File: " + lib_file_name + " sections: " + ",".join(lib_names))
 
-                filename = os.path.join(os.path.dirname(self._file), lib_file_name).replace("'", '').replace('"', '')
+                filename = self.library_filename(lib_file_name)
                 library_file_reader = GenericReader(filename, self._grammar_type, self._language_definition,
                                                     reader_state=self._reader_state, top_reader_state=self._top_reader_state,
                                                     is_top_level_file=False, tspice_xml=self._tspice_xml, pspice_xml=self._pspice_xml,
                                                     spectre_xml=self._spectre_xml, auto_translate=self._auto_translate, 
-                                                    lib_sect_list=lib_names)
+                                                    lib_sect_list=lib_names, parse_threads=self._parse_threads, parse_cache_dir=self._parse_cache_dir,
+                                                    lib_sections_only=self._lib_sections_only)
                 library_file_reader.read()
 
+            # a file read ahead of time that was never opened would otherwise be held until
+            # the end of the run
+            if prefetch_batch is not None:
+                self._grammar_type.release_prefetched(prefetch_batch)
+
             # translate .lib files that are in child scope
             if self._is_top_level_file:
                 count = 0 
@@ -260,7 +302,8 @@ class GenericReader(object):
                                                         reader_state=self._reader_state, top_reader_state=self._top_reader_state,
                                                         is_top_level_file=False, tspice_xml=self._tspice_xml, pspice_xml=self._pspice_xml,
                                                         spectre_xml=self._spectre_xml, auto_translate=self._auto_translate, 
-                                                        lib_sect_list=[])
+                                                        lib_sect_list=[], parse_threads=self._parse_threads, parse_cache_dir=self._parse_cache_dir,
+                                                        lib_sections_only=self._lib_sections_only)
                     library_file_reader.read()
                     count += 1
 
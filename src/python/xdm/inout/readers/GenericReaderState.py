@@ -88,8 +88,7 @@ class GenericReaderState(object):
             model_key = model_key.upper()
 
         modelDef = ""
-        for key in self._sc.statements:
-            st = self._sc.statements[key]
+        for st in self._sc.statements_with_prefix("__MODELDEF__"):
 
             if isinstance(st, MASTER_MODEL):
                 for m in st.models:
@@ -107,10 +106,8 @@ class GenericReaderState(object):
         # if model definition not found in current scope, check scopes of include files
         if not modelDef:
             for scope in self._master_inc_list_scopes:
-                statements = scope.statements
 
-                for key in statements:
-                    st = statements[key]
+                for st in scope.statements_with_prefix("__MODELDEF__"):
 
                     if isinstance(st, MASTER_MODEL):
                         for m in st.models:
@@ -164,8 +161,7 @@ class GenericReaderState(object):
         if self._case_insensitive:
             model_key = model_key.upper()
 
-        for key in self._sc.statements:
-            st = self._sc.statements[key]
+        for st in self._sc.statements_with_prefix("__DEVICE__"):
 
             if isinstance(st, Device):
                 if st.name == pnl.sweep_param_list[0]:
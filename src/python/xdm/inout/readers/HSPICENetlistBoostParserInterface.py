@@ -20,6 +20,7 @@
 #   If not, see <http://www.gnu.org/licenses/>.
 #-------------------------------------------------------------------------
 
+import atexit
 import logging
 import os
 import re
@@ -37,6 +38,9 @@ from xdm.inout.readers.ParsedNetlistLine import ParsedNetlistLine
 from xdm.inout.readers.XDMFactory import supported_devices
 from xdm.inout.readers.XyceNetlistBoostParserInterface import XyceNetlistBoostParserInterface
 
+# the threads reading files ahead of time have to be joined while the interpreter is still running
+atexit.register(HSpiceSpirit.HSPICENetlistBoostParser.shutdown_prefetch)
+
 
 # maps hspice model types into their ADM (xyce style) model types
 hspice_to_adm_model_type_map = {"RES": "R",
@@ -79,10 +83,15 @@ class HSPICENetlistBoostParserInterface:
     Allows for HSPICE to be read in using the Boost Parser.  Iterates over
     statements within the HSPICE netlist fiAle.
     """
-    def __init__(self, filename, language_definition, top_level_file = True):
+    def __init__(self, filename, language_definition, top_level_file = True, parse_threads=0, parse_cache_dir=None, lib_sections=None):
         self.internal_parser = HSpiceSpirit.HSPICENetlistBoostParser()
+        self.internal_parser.set_num_threads(parse_threads)
+        if parse_cache_dir:
+            self.internal_parser.set_cache_dir(parse_cache_dir)
+        if lib_sections:
+            self.internal_parser.set_lib_sections(lib_sections)
         self.goodfile = self.internal_parser.open(filename, top_level_file)
-        self.line_iter = iter(self.internal_parser)
+        self.line_iter = BoostParserInterface.iter_parsed_lines(self.internal_parser)
         self._filename = filename
         self._language_definition = language_definition
         self._top_level_file = top_level_file
@@ -107,6 +116,22 @@ class HSPICENetlistBoostParserInterface:
     def __del__(self):
         self.internal_parser.close()
 
+    @staticmethod
+    def prefetch(filenames, parse_threads=0, parse_cache_dir=None):
+        """
+        Starts parsing the files a netlist includes on parse_threads threads, so that
+        opening them later does not have to wait for them to be parsed. Returns the
+        batch of the files, for release_prefetched()
+        """
+        return HSpiceSpirit.HSPICENetlistBoostParser.prefetch(filenames, parse_threads, parse_cache_dir or "")
+
+    @staticmethod
+    def release_prefetched(batch):
+        """
+        Drops the files of a batch returned by prefetch() that have not been opened
+        """
+        HSpiceSpirit.HSPICENetlistBoostParser.release_prefetched(batch)
+
     def __iter__(self):
         return self
 
@@ -288,9 +313,7 @@ class HSPICENetlistBoostParserInterface:
                     func_arg_parsed_object = next(parsed_object_iter)
                 func_expression_parsed_object = func_arg_parsed_object
 
-                temper_bool = self.hack_detect_temper(func_expression_parsed_object.value)
-                processed_value = self.hack_ternary_operator(func_expression_parsed_object.value)
-                processed_value = self.hack_exponentiation_symbol(processed_value)
+                processed_value, temper_bool = self.xyce_expression(func_expression_parsed_object.value, pnl)
 
                 pnl_synth.add_known_object(processed_value, BoostParserInterface.boost_xdm_map_dict[func_expression_parsed_object.types[0]])
                 synthesized_pnls.append(pnl_synth)
@@ -304,9 +327,7 @@ class HSPICENetlistBoostParserInterface:
                     func_arg_parsed_object = next(parsed_object_iter)
                 func_expression_parsed_object = func_arg_parsed_object
 
-                temper_bool = self.hack_detect_temper(func_expression_parsed_object.value)
-                processed_value = self.hack_ternary_operator(func_expression_parsed_object.value)
-                processed_value = self.hack_exponentiation_symbol(processed_value)
+                processed_value, temper_bool = self.xyce_expression(func_expression_parsed_object.value, pnl)
 
                 pnl.add_known_object(processed_value, BoostParserInterface.boost_xdm_map_dict[func_expression_parsed_object.types[0]])
 
@@ -324,9 +345,7 @@ class HSPICENetlistBoostParserInterface:
                 # Same as above, for lines with mixed parameter and function statements in HSPICE, separate them out
                 # into different ParsedNetlistLine objects and store it in synthesized pnl 
                 if synthesized_pnls:
-                    temper_bool = self.hack_detect_temper(param_value_parsed_object.value)
-                    processed_value = self.hack_ternary_operator(param_value_parsed_object.value)
-                    processed_value = self.hack_exponentiation_symbol(processed_value)
+                    processed_value, temper_bool = self.xyce_expression(param_value_parsed_object.value, pnl)
 
                     synthesized_pnls[-1].add_param_value_pair(parsed_object.value.upper(), processed_value)
                 else:
@@ -334,18 +353,13 @@ class HSPICENetlistBoostParserInterface:
                     pnl_synth.type = ".PARAM"
                     pnl_synth.local_type = ".PARAM"
 
-                    temper_bool = self.hack_detect_temper(param_value_parsed_object.value)
-                    processed_value = self.hack_ternary_operator(param_value_parsed_object.value)
-                    processed_value = self.hack_exponentiation_symbol(processed_value)
+                    processed_value, temper_bool = self.xyce_expression(param_value_parsed_object.value, pnl)
 
                     pnl_synth.add_param_value_pair(parsed_object.value.upper(), processed_value)
                     synthesized_pnls.append(pnl_synth)
             else:
-                temper_bool = self.hack_detect_temper(param_value_parsed_object.value)
-                processed_value = self.hack_ternary_operator(param_value_parsed_object.value)
-                if pnl.type in [".PARAM", ".SUBCKT", ".MODEL", ".MACRO", ".GLOBAL_PARAM"] or pnl.type in supported_devices:
-                    processed_value = self.curly_braces_for_expressions(processed_value)
-                processed_value = self.hack_exponentiation_symbol(processed_value)
+                braces = pnl.type in [".PARAM", ".SUBCKT", ".MODEL", ".MACRO", ".GLOBAL_PARAM"] or pnl.type in supported_devices
+                processed_value, temper_bool = self.xyce_expression(param_value_parsed_object.value, pnl, braces)
 
                 pnl.add_param_value_pair(parsed_object.value.upper(), processed_value)
 
@@ -356,20 +370,15 @@ class HSPICENetlistBoostParserInterface:
                 last_key = synthesized_pnls[-1].params_dict.keys()[-1]
                 prev_param_value = synthesized_pnls[-1].params_dict[last_key]
 
-                temper_bool = self.hack_detect_temper(parsed_object.value)
-                processed_value = self.hack_ternary_operator(parsed_object.value)
-                processed_value = self.hack_exponentiation_symbol(processed_value)
+                processed_value, temper_bool = self.xyce_expression(parsed_object.value, pnl)
 
                 synthesized_pnls[-1].params_dict[last_key] = prev_param_value+" "+processed_value
             else:
                 last_key = pnl.params_dict.keys()[-1]
                 prev_param_value = pnl.params_dict[last_key]
 
-                temper_bool = self.hack_detect_temper(parsed_object.value)
-                processed_value = self.hack_ternary_operator(parsed_object.value)
-                if pnl.type in [".PARAM", ".SUBCKT", ".MODEL", ".MACRO", ".GLOBAL_PARAM"] or pnl.type in supported_devices:
-                    processed_value = self.curly_braces_for_expressions(processed_value)
-                processed_value = self.hack_exponentiation_symbol(processed_value)
+                braces = pnl.type in [".PARAM", ".SUBCKT", ".MODEL", ".MACRO", ".GLOBAL_PARAM"] or pnl.type in supported_devices
+                processed_value, temper_bool = self.xyce_expression(parsed_object.value, pnl, braces)
 
                 pnl.params_dict[last_key] = prev_param_value+" "+processed_value
 
@@ -387,9 +396,7 @@ class HSPICENetlistBoostParserInterface:
             for typ in parsed_object.types:
                 lst.append(BoostParserInterface.boost_xdm_map_dict[typ])
 
-            temper_bool = self.hack_detect_temper(parsed_object.value)
-            processed_value = self.hack_ternary_operator(parsed_object.value)
-            processed_value = self.hack_exponentiation_symbol(processed_value)
+            processed_value, temper_bool = self.xyce_expression(parsed_object.value, pnl)
 
             pnl.add_lazy_statement(processed_value, lst)
 
@@ -398,14 +405,14 @@ class HSPICENetlistBoostParserInterface:
             if pnl.type == "R" and self.hack_detect_abm(parsed_object.value):
                 pnl.type = "B"
                 pnl.local_type = "B"
-                processed_value = self.hack_exponentiation_symbol(parsed_object.value.strip("'"))
+                processed_value = parsed_object.value.strip("'").replace("^", "**")
                 pnl.add_known_object("{V(%s,%s)/(%s)}"%(pnl.known_objects["POS_NODE_NAME"], pnl.known_objects["NEG_NODE_NAME"], processed_value), Types.expression)
                 pnl.add_known_object("{V(%s,%s)/(%s)}"%(pnl.known_objects["POS_NODE_NAME"], pnl.known_objects["NEG_NODE_NAME"], processed_value), Types.current)
                 pnl.lazy_statement = {}
          
 
         elif parsed_object.types[0] in [SpiritCommon.data_model_type.DC_VALUE_VALUE, SpiritCommon.data_model_type.AC_MAG_VALUE, SpiritCommon.data_model_type.AC_PHASE_VALUE]:
-            processed_value = self.curly_braces_for_expressions(parsed_object.value)
+            processed_value, _ = self.xyce_expression(parsed_object.value, pnl, True)
             
             pnl.add_known_object(processed_value, BoostParserInterface.boost_xdm_map_dict[parsed_object.types[0]])
 
@@ -430,7 +437,7 @@ class HSPICENetlistBoostParserInterface:
 
 
         elif parsed_object.types[0] == SpiritCommon.data_model_type.TRANS_REF_NAME:
-            processed_value = self.curly_braces_for_expressions(parsed_object.value)
+            processed_value, _ = self.xyce_expression(parsed_object.value, pnl, True)
             pnl.add_transient_value(processed_value)
 
 
@@ -466,91 +473,19 @@ class HSPICENetlistBoostParserInterface:
         return out_output_variable
 
     @staticmethod
-    def hack_ternary_operator(in_expression):
-        """
-        Hack to place in empty space to left of colons in presumed ternary operators
-        """
-
-        q_list = []
-        out_expression = ""
-
-        # first check ternary operator is in expression
-        if "?" in in_expression and ":" in in_expression:
-
-            # Next, make sure every "?" is followed by a ":" and that there are equal number of each.
-            # If not, give warning, return the expression, and continue translating. 
-            # TODO: figure out if it's better to comment out? might not be, since expression may be 
-            #       on a line containing multiple expressions, which would end up commenting out everything
-            #       else
-            for char in in_expression:
-                if char == "?":
-                    q_list.append(char)
-                    out_expression += char
-                elif char == ":":
-                    if not q_list:
-                        logging.warning("In file:\"" + str(os.path.basename(pnl.filename)) + "\" at line:" + str(pnl.linenum) + ". Ternary operator cannot be translated. Continuing.")
-                        return in_expression
-                    else:
-                        q_list.pop()
-
-                        # if there's an empty space to the left of ":", no need to add another
-                        if out_expression[-1] == " ":
-                            out_expression += char
-                        else:
-                            out_expression += " "+char
-                else:
-                    out_expression += char
-
-            if q_list:
-                logging.warning("In file:\"" + str(os.path.basename(pnl.filename)) + "\" at line:" + str(pnl.linenum) + ". Ternary operator cannot be translated. Continuing.")
-                return in_expression 
-                
-        # if no ternary operator in expression, return expression unchanged
-        else:
-            return in_expression
-
-        return out_expression
-
-    @staticmethod
-    def curly_braces_for_expressions(in_expression):
-        """
-        Enclose expressions in curly braces for Xyce.
-        """
-
-        # first check if expression is already enclosed in single quotes, which is legal in Xyce.
-        # if so, just return expression
-        if in_expression.startswith("'") and in_expression.endswith("'"):
-            return in_expression
-
-        # remove single quotes that may be around function arguments
-        expression_fields = in_expression.split("'")
-        out_expression = "".join(expression_fields)
-
-        # find expression components. put braces around everything - only exception is if it is a
-        # number
-        expr_components = []
-        expr_utils.find_expr_components(out_expression, [], expr_components)
-
-        if ((len(expr_components) == 1 and expr_components[0].types[0] == SpiritExprCommon.expr_data_model_type.NUMBER) or
-           (len(expr_components) == 2 and (expr_components[0].types[0] == SpiritExprCommon.expr_data_model_type.NUMBER and
-           (expr_components[1].types[0] == SpiritExprCommon.expr_data_model_type.UNARY_NEG or 
-           expr_components[1].types[0] == SpiritExprCommon.expr_data_model_type.UNARY_POS))) or 
-           len(expr_components) == 0):
-            return out_expression
-
-        out_expression = "{" + out_expression + "}"
-
-        return out_expression
-
-    @staticmethod
-    def hack_exponentiation_symbol(in_expression):
+    def xyce_expression(in_expression, pnl, braces=False):
         """
-        Hack to translate "^" math symbol to "**"
+        Rewrites an expression in Xyce syntax: a space to the left of the colons of ternary
+        operators, curly braces around it if braces is set and it is not a number, and "**"
+        for "^". Returns the expression, and whether it contains the "TEMPER" special variable,
+        in which case a .GLOBAL_PARAM statement for it is added at the top circuit level.
         """
 
-        out_expression = in_expression.replace("^", "**")
+        out_expression, temper_bool, ternary_ok = expr_utils.hspice_to_xyce(in_expression, braces)
+        if not ternary_ok:
+            logging.warning("In file:\"" + str(os.path.basename(pnl.filename)) + "\" at line:" + str(pnl.linenum) + ". Ternary operator cannot be translated. Continuing.")
 
-        return out_expression
+        return out_expression, temper_bool
 
     @staticmethod
     def hack_detect_abm(in_expression):
@@ -575,26 +510,6 @@ class HSPICENetlistBoostParserInterface:
 
         return abm_bool
 
-    @staticmethod
-    def hack_detect_temper(in_expression):
-        """
-        Hack to dectect if an expression contains the "TEMPER" special variable in HSPICE.
-        If it does, add an unknown pnl to top file scope to add in .GLOBAL_PARAM statement later.
-        """
-
-        temper_bool = False
-
-        # split an expression into it's component parts
-        expression_split = re.split("(\*|/|\+|-|\(|\)| |')", in_expression)
-
-        for expression in expression_split:
-            # detects if expression component contains the "TEMPER" special variable
-            if expression.upper() == "TEMPER":
-                temper_bool = True
-                break
-
-        return temper_bool
-
     @staticmethod
     def hack_packages_bugzilla_2020(param, pkgs):
         """
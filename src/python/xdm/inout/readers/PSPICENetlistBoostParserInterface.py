@@ -21,6 +21,7 @@
 #-------------------------------------------------------------------------
 
 
+import atexit
 import logging
 import os
 import sys
@@ -33,6 +34,9 @@ from xdm.inout.readers import BoostParserInterface
 from xdm.inout.readers.ParsedNetlistLine import ParsedNetlistLine
 from xdm.inout.readers.XyceNetlistBoostParserInterface import XyceNetlistBoostParserInterface
 
+# the threads reading files ahead of time have to be joined while the interpreter is still running
+atexit.register(PSpiceSpirit.PSPICENetlistBoostParser.shutdown_prefetch)
+
 
 # maps pspice model types into their ADM (xyce style) model types
 pspice_to_adm_model_type_map = {"RES": "R",
@@ -75,10 +79,15 @@ class PSPICENetlistBoostParserInterface(object):
     Allows for PSPICE to be read in using the Boost Parser.  Iterates over
     statements within the PSPICE netlist fiAle.
     """
-    def __init__(self, filename, language_definition, top_level_file=True):
+    def __init__(self, filename, language_definition, top_level_file=True, parse_threads=0, parse_cache_dir=None, lib_sections=None):
         self.internal_parser = PSpiceSpirit.PSPICENetlistBoostParser()
+        self.internal_parser.set_num_threads(parse_threads)
+        if parse_cache_dir:
+            self.internal_parser.set_cache_dir(parse_cache_dir)
+        if lib_sections:
+            self.internal_parser.set_lib_sections(lib_sections)
         self.goodfile = self.internal_parser.open(filename, top_level_file)
-        self.line_iter = iter(self.internal_parser)
+        self.line_iter = BoostParserInterface.iter_parsed_lines(self.internal_parser)
         self._filename = filename
         self._language_definition = language_definition
         self._top_level_file = top_level_file
@@ -103,6 +112,22 @@ class PSPICENetlistBoostParserInterface(object):
     def __del__(self):
         self.internal_parser.close()
 
+    @staticmethod
+    def prefetch(filenames, parse_threads=0, parse_cache_dir=None):
+        """
+        Starts parsing the files a netlist includes on parse_threads threads, so that
+        opening them later does not have to wait for them to be parsed. Returns the
+        batch of the files, for release_prefetched()
+        """
+        return PSpiceSpirit.PSPICENetlistBoostParser.prefetch(filenames, parse_threads, parse_cache_dir or "")
+
+    @staticmethod
+    def release_prefetched(batch):
+        """
+        Drops the files of a batch returned by prefetch() that have not been opened
+        """
+        PSpiceSpirit.PSPICENetlistBoostParser.release_prefetched(batch)
+
     def __iter__(self):
         return self
 
@@ -20,6 +20,7 @@
 #   If not, see <http://www.gnu.org/licenses/>.
 #-------------------------------------------------------------------------
 
+import atexit
 import logging
 import os
 import re
@@ -32,6 +33,9 @@ from xdm import Types
 from xdm.inout.readers import BoostParserInterface
 from xdm.inout.readers.ParsedNetlistLine import ParsedNetlistLine
 
+# the threads reading files ahead of time have to be joined while the interpreter is still running
+atexit.register(SpectreSpirit.SpectreNetlistBoostParser.shutdown_prefetch)
+
 spectre_to_adm_model_type_map = {"resistor": "R", "capacitor": "C", "diode": "D", "inductor": "L",
                                  "mutual_inductor": "K", "gaas": "Z", "tline": "T", "vcvs": "E", "vccs": "G",
                                  "pvcvs": "E", "pvccs": "G", "vsource": "V", "isource": "I", "jfet": "J", "mos1": "M",
@@ -185,10 +189,14 @@ class SpectreNetlistBoostParserInterface(object):
     statements within the Spectre netlist file.
     """
 
-    def __init__(self, filename, language_definition, top_level_file=True):
+    def __init__(self, filename, language_definition, top_level_file=True, parse_threads=0, parse_cache_dir=None, lib_sections=None):
         self.internal_parser = SpectreSpirit.SpectreNetlistBoostParser()
+        self.internal_parser.set_num_threads(parse_threads)
+        if parse_cache_dir:
+            self.internal_parser.set_cache_dir(parse_cache_dir)
+        # only .lib/.endl sections are indexed, so the whole of a Spectre library is read
         self.goodfile = self.internal_parser.open(filename, top_level_file)
-        self.line_iter = iter(self.internal_parser)
+        self.line_iter = BoostParserInterface.iter_parsed_lines(self.internal_parser)
         self._filename = filename
         self._language_definition = language_definition
         self._top_level_file = top_level_file
@@ -203,6 +211,22 @@ class SpectreNetlistBoostParserInterface(object):
     def __del__(self):
         self.internal_parser.close()
 
+    @staticmethod
+    def prefetch(filenames, parse_threads=0, parse_cache_dir=None):
+        """
+        Starts parsing the files a netlist includes on parse_threads threads, so that
+        opening them later does not have to wait for them to be parsed. Returns the
+        batch of the files, for release_prefetched()
+        """
+        return SpectreSpirit.SpectreNetlistBoostParser.prefetch(filenames, parse_threads, parse_cache_dir or "")
+
+    @staticmethod
+    def release_prefetched(batch):
+        """
+        Drops the files of a batch returned by prefetch() that have not been opened
+        """
+        SpectreSpirit.SpectreNetlistBoostParser.release_prefetched(batch)
+
     def __iter__(self):
         return self
 
@@ -20,6 +20,7 @@
 #   If not, see <http://www.gnu.org/licenses/>.
 #-------------------------------------------------------------------------
 
+import atexit
 import logging
 import sys
 import os
@@ -32,6 +33,9 @@ import xdm.Types as Types
 from xdm.inout.readers import BoostParserInterface
 from xdm.inout.readers.ParsedNetlistLine import ParsedNetlistLine
 
+# the threads reading files ahead of time have to be joined while the interpreter is still running
+atexit.register(XyceSpirit.XyceNetlistBoostParser.shutdown_prefetch)
+
 
 class XyceNetlistBoostParserInterface(object):
     """
@@ -39,10 +43,15 @@ class XyceNetlistBoostParserInterface(object):
     statements within the Xyce netlist file.
     """
 
-    def __init__(self, filename, language_definition, top_level_file=True):
+    def __init__(self, filename, language_definition, top_level_file=True, parse_threads=0, parse_cache_dir=None, lib_sections=None):
         self.internal_parser = XyceSpirit.XyceNetlistBoostParser()
+        self.internal_parser.set_num_threads(parse_threads)
+        if parse_cache_dir:
+            self.internal_parser.set_cache_dir(parse_cache_dir)
+        if lib_sections:
+            self.internal_parser.set_lib_sections(lib_sections)
         self.goodfile = self.internal_parser.open(filename, top_level_file)
-        self.line_iter = iter(self.internal_parser)
+        self.line_iter = BoostParserInterface.iter_parsed_lines(self.internal_parser)
         self._filename = filename
         self._language_definition = language_definition
         self._top_level_file = top_level_file
@@ -58,6 +67,22 @@ class XyceNetlistBoostParserInterface(object):
     def __del__(self):
         self.internal_parser.close()
 
+    @staticmethod
+    def prefetch(filenames, parse_threads=0, parse_cache_dir=None):
+        """
+        Starts parsing the files a netlist includes on parse_threads threads, so that
+        opening them later does not have to wait for them to be parsed. Returns the
+        batch of the files, for release_prefetched()
+        """
+        return XyceSpirit.XyceNetlistBoostParser.prefetch(filenames, parse_threads, parse_cache_dir or "")
+
+    @staticmethod
+    def release_prefetched(batch):
+        """
+        Drops the files of a batch returned by prefetch() that have not been opened
+        """
+        XyceSpirit.XyceNetlistBoostParser.release_prefetched(batch)
+
     def __iter__(self):
         return self
 
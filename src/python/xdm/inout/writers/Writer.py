@@ -92,7 +92,7 @@ class Writer(object):
             self._f = dir_name
         self.log = log
 
-        self._output_language_factory = XmlFactory(xml_lang_file)
+        self._output_language_factory = XmlFactory(xml_lang_file, lazy=True)
         self._output_language = self._output_language_factory.language_definition
         self._input_language_factory = input_language_definition
         self._input_language = input_language_definition
@@ -121,12 +121,11 @@ class Writer(object):
 
         self._device_dict = {}
 
-        self._device_writer = {}
-        self._model_writer = {}
+        # the writers are looked up when a device is written, so that only the devices
+        # actually used are loaded from a lazily read language definition
+        self._output_device_types = {}
         for device_type in self._output_language_factory.language_definition.device_types:
-            self._device_writer[device_type.device_level_key] = device_type.writer.token_list
-            if device_type.model:
-                self._model_writer[device_type.device_level_key] = device_type.model.writer
+            self._output_device_types.setdefault(device_type.device_level_key, []).append(device_type)
 
         self._directive_writer = {}
         for directive_type in self._output_language_factory.language_definition.directive_types:
@@ -168,6 +167,15 @@ class Writer(object):
                 if option[0] == "combinePrint":
                     self._combine_print_flag = option[1] == "true"
 
+    def _device_writer(self, device_level_key):
+        return self._output_device_types[device_level_key][-1].writer.token_list
+
+    def _model_writer(self, device_level_key):
+        for device_type in reversed(self._output_device_types[device_level_key]):
+            if device_type.model:
+                return device_type.model.writer
+        raise KeyError(device_level_key)
+
     def _write_line(self, ws, xdm_version, from_version, to_version):
         """ Writes a line to the file.  This is a protected
         function call and should only be called by children
@@ -214,7 +222,7 @@ class Writer(object):
 
         if isinstance(ws, Device):
             can_convert_special_var, unsupported_var, conflicting_var = handle_special_variables(ws, self._input_admin_writer, self._admin_writer)
-            d = self._device_writer[ws.device_level_key]
+            d = self._device_writer(ws.device_level_key)
             lang = self._output_language.get_device_by_name_level_key(ws.device_level_key, ws.device_version_key)
 
             # match existing params to new params
@@ -276,7 +284,7 @@ class Writer(object):
                     can_translate_output_var, unsupported_output_vars = handle_output_variables(ws, self._input_admin_writer, self._admin_writer)
                 d = self._directive_writer[ws.command_type]
         elif isinstance(ws, ModelDef):
-            d = self._model_writer[ws.device_level_key].token_list[:]
+            d = self._model_writer(ws.device_level_key).token_list[:]
             level_token = XmlDeviceToken(999, "model_level", self._output_language_factory.language_definition.get_device_by_name_level_key(ws.device_level_key, ws.device_version_key).device_level, None, None)
             d.append(level_token)
             lang = self._output_language.get_device_by_name_level_key(ws.device_level_key, ws.device_version_key).model
@@ -659,7 +667,7 @@ class Writer(object):
         """
 
         if isinstance(ws, Device):
-            return ws.device_level_key in self._device_writer
+            return ws.device_level_key in self._output_device_types
         else:
             return isinstance(ws, Statement)
 
@@ -59,6 +59,9 @@ class XmlDeviceType(object):
         writer (XmlWriter for this device)
 
         ambiguity_token_list (list of tokens that define possible props/params for ambiguous statements)
+
+        loader (if set, called with this device the first time its props, params, model, writer or
+        ambiguity tokens are needed, to fill them in from a lazily read language definition)
     """
     def __init__(self, name, level, levelKey, version, versionKey, default=False, local_name=""):
         self.name = name
@@ -76,6 +79,7 @@ class XmlDeviceType(object):
         self._model = None
         self._writer = None
         self._ambiguity_token_list = None
+        self._loader = None
 
     def __hash__(self):
         return hash((self.name, self.level, self.levelKey, self.version))
@@ -83,6 +87,19 @@ class XmlDeviceType(object):
     def __eq__(self, other):
         return (self.name, self.level, self.levelKey, self.version) == (other.name, other.level, other.levelKey, other.version)
 
+    @property
+    def loader(self):
+        return self._loader
+
+    @loader.setter
+    def loader(self, loader):
+        self._loader = loader
+
+    def _load(self):
+        if self._loader:
+            loader, self._loader = self._loader, None
+            loader(self)
+
     def add_prop(self, prop):
         self._props[prop.label] = prop
         if prop.label_key:
@@ -97,23 +114,29 @@ class XmlDeviceType(object):
 
     @property
     def props(self):
+        self._load()
         return self._props
 
     @property
     def params(self):
+        self._load()
         return self._params
 
     @property
     def key_params(self):
+        self._load()
         return self._key_params
 
     def get_param(self, param):
+        self._load()
         return self._params.get(param)
 
     def get_prop(self, prop):
+        self._load()
         return self._props.get(prop)
 
     def get_prop_value(self, label, prop_type=None):
+        self._load()
         value_counter = Counter()
         for prop in self._props:
             if label == prop.prop_type:
@@ -127,6 +150,7 @@ class XmlDeviceType(object):
 
     @property
     def model(self):
+        self._load()
         return self._model
 
     @model.setter
@@ -135,6 +159,7 @@ class XmlDeviceType(object):
 
     @property
     def writer(self):
+        self._load()
         return self._writer
 
     @writer.setter
@@ -143,6 +168,7 @@ class XmlDeviceType(object):
 
     @property
     def ambiguity_token_list(self):
+        self._load()
         return self._ambiguity_token_list
 
     @ambiguity_token_list.setter
@@ -175,6 +201,7 @@ class XmlDeviceType(object):
 
     @property
     def m_flag(self):
+        self._load()
         return self._m_flag
 
     @m_flag.setter
@@ -211,6 +238,7 @@ class XmlDeviceType(object):
 
     @property
     def node_types(self):
+        self._load()
         node_types = []
         for key, value in self._props.items():
             if "node" == value.prop_type:
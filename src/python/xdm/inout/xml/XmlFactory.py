@@ -30,6 +30,8 @@ from xdm.inout.xml.XmlParam import XmlParam
 from xdm.inout.xml.XmlProp import XmlProp
 from xdm.inout.xml.XmlWriter import XmlWriter
 
+from functools import partial
+
 import XdmRapidXmlReader
 
 
@@ -50,10 +52,14 @@ class XmlFactory(object):
         language_definition (XmlLanguageDefinition)
 
         directiveList (list of directives...does not look like it gets used)
+
+        lazy (bool whether each device is only filled in the first time it is used)
     """
-    def __init__(self, xml_file=None):
+    def __init__(self, xml_file=None, lazy=False):
         self._xml_file = xml_file
         self._reader = XdmRapidXmlReader.XmlLineReader()
+        self._lazy = lazy
+        self._reader.lazy = lazy
         self._language_definition = None
         # TODO: Figure out whether we can get rid of self._directiveList
         self._directiveList = []
@@ -73,38 +79,54 @@ class XmlFactory(object):
             else:
                 newDevice = XmlDeviceType(nameLevelTuple[0], nameLevelTuple[1], nameLevelTuple[2], nameLevelTuple[3], nameLevelTuple[4], nameLevelTuple[5], nameLevelTuple[6])
 
-            for propTuple in self._reader.devicePropListDict[nameLevelTuple]:
-                newProp = XmlProp(propTuple[0], propTuple[1], propTuple[2], propTuple[3], output_alias=propTuple[7])
-                newDevice.add_prop(newProp)
-
-            for paramTuple in self._reader.deviceParamListDict[nameLevelTuple]:
-                newParam = XmlParam(paramTuple[0], paramTuple[1], paramTuple[2], paramTuple[3], paramTuple[6])
-                newDevice.add_param(newParam)
-
-            device_writer = create_writer(self._reader.deviceWriterTokenList, nameLevelTuple)
-            newDevice.writer = device_writer
-
-            ambiguity_token_list = []
-            if self._reader.ambiguityResolutionListDict.get(nameLevelTuple):
-                for token in self._reader.ambiguityResolutionListDict.get(nameLevelTuple):
-                    newToken = XmlDeviceToken(token[0], token[1], token[2], None, None)
-                    ambiguity_token_list.append(newToken)
-            newDevice.ambiguity_token_list = ambiguity_token_list
-
-            if self._reader.modelPropListDict.get(nameLevelTuple):
-                newModel = XmlDeviceModel()
-                for modelPropTuple in self._reader.modelPropListDict[nameLevelTuple]:
-                    newModelProp = XmlProp(modelPropTuple[0], modelPropTuple[1], modelPropTuple[2], modelPropTuple[3])
-                    newModel.add_prop(newModelProp)
-                for modelParamTuple in self._reader.modelParamListDict[nameLevelTuple]:
-                    newModelParam = XmlParam(modelParamTuple[0], modelParamTuple[1], modelParamTuple[2], modelParamTuple[3])
-                    newModel.add_param(newModelParam)
-                newDevice.model = newModel
-                newModel.device_type = newDevice
-                model_writer = create_writer(self._reader.modelWriterTokenList, nameLevelTuple)
-                newModel.writer = model_writer
+            if self._lazy:
+                newDevice.loader = partial(self._load_device, nameLevelTuple)
+            else:
+                self._load_device(nameLevelTuple, newDevice)
+
             self._language_definition.add_device_type(newDevice)
 
+    def _load_device(self, nameLevelTuple, newDevice):
+        """
+        Adds the props, params, writer, ambiguity tokens and model of a device.
+
+        :param nameLevelTuple: tuple of the device in the reader's nameLevelTupleList
+        :param newDevice: XmlDeviceType to fill in
+        :return:
+        """
+        self._reader.load_device(nameLevelTuple)
+
+        for propTuple in self._reader.devicePropListDict[nameLevelTuple]:
+            newProp = XmlProp(propTuple[0], propTuple[1], propTuple[2], propTuple[3], output_alias=propTuple[7])
+            newDevice.add_prop(newProp)
+
+        for paramTuple in self._reader.deviceParamListDict[nameLevelTuple]:
+            newParam = XmlParam(paramTuple[0], paramTuple[1], paramTuple[2], paramTuple[3], paramTuple[6])
+            newDevice.add_param(newParam)
+
+        device_writer = create_writer(self._reader.deviceWriterTokenList, nameLevelTuple)
+        newDevice.writer = device_writer
+
+        ambiguity_token_list = []
+        if self._reader.ambiguityResolutionListDict.get(nameLevelTuple):
+            for token in self._reader.ambiguityResolutionListDict.get(nameLevelTuple):
+                newToken = XmlDeviceToken(token[0], token[1], token[2], None, None)
+                ambiguity_token_list.append(newToken)
+        newDevice.ambiguity_token_list = ambiguity_token_list
+
+        if self._reader.modelPropListDict.get(nameLevelTuple):
+            newModel = XmlDeviceModel()
+            for modelPropTuple in self._reader.modelPropListDict[nameLevelTuple]:
+                newModelProp = XmlProp(modelPropTuple[0], modelPropTuple[1], modelPropTuple[2], modelPropTuple[3])
+                newModel.add_prop(newModelProp)
+            for modelParamTuple in self._reader.modelParamListDict[nameLevelTuple]:
+                newModelParam = XmlParam(modelParamTuple[0], modelParamTuple[1], modelParamTuple[2], modelParamTuple[3])
+                newModel.add_param(newModelParam)
+            newDevice.model = newModel
+            newModel.device_type = newDevice
+            model_writer = create_writer(self._reader.modelWriterTokenList, nameLevelTuple)
+            newModel.writer = model_writer
+
     @property
     def language_definition(self):
         return self._language_definition